@@ -61,19 +61,6 @@ int main(void) {
 #include "types.h"
 #include <stdlib.h>
 
-#if defined _MSC_VER
-    #include <intrin.h>
-    #define c_atomic_inc(v) (void)_InterlockedIncrement(v)
-    #define c_atomic_dec_and_test(v) !_InterlockedDecrement(v)
-#elif defined __GNUC__ || defined __clang__
-    #define c_atomic_inc(v) (void)__atomic_add_fetch(v, 1, __ATOMIC_SEQ_CST)
-    #define c_atomic_dec_and_test(v) !__atomic_sub_fetch(v, 1, __ATOMIC_SEQ_CST)
-#else
-    #include <stdatomic.h>
-    #define c_atomic_inc(v) (void)atomic_fetch_add(v, 1)
-    #define c_atomic_dec_and_test(v) (atomic_fetch_sub(v, 1) == 1)
-#endif
-
 #define carc_null {0}
 #endif // STC_ARC_H_INCLUDED
 
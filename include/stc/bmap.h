@@ -0,0 +1,760 @@
+/* MIT License
+ *
+ * Copyright (c) 2023 Tyge Løvset
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Sorted/Ordered set and map - implemented as a B+-tree. The elements are stored in linked
+// leaf nodes of i_node_size bytes, and the inner nodes hold only keys and child pointers.
+/*
+#include <stdio.h>
+#define i_implement
+#include "stc/cstr.h"
+
+#define i_type bmap_sd  // Sorted map<cstr, double>
+#define i_key_str
+#define i_val double
+#include "stc/bmap.h"
+
+int main(void) {
+    bmap_sd m = {0};
+    bmap_sd_emplace(&m, "Testing one", 1.234);
+    bmap_sd_emplace(&m, "Testing two", 12.34);
+    bmap_sd_emplace(&m, "Testing three", 123.4);
+
+    bmap_sd_value *v = bmap_sd_get(&m, "Testing five"); // NULL
+    double num = *bmap_sd_at(&m, "Testing one");
+    bmap_sd_emplace_or_assign(&m, "Testing three", 1000.0); // update
+    bmap_sd_erase(&m, "Testing two");
+
+    c_foreach (i, bmap_sd, m)
+        printf("map %s: %g\n", cstr_str(&i.ref->first), i.ref->second);
+
+    bmap_sd_drop(&m);
+}
+*/
+#include "priv/linkage.h"
+
+#ifndef STC_BMAP_H_INCLUDED
+#define STC_BMAP_H_INCLUDED
+#include "common.h"
+#include "types.h"
+#include <stdlib.h>
+#include <string.h>
+// Inner nodes other than the root have at least 4 children, so 32 levels covers any size.
+#define _bmap_MAXHEIGHT 32
+#endif // STC_BMAP_H_INCLUDED
+
+#ifndef _i_prefix
+  #define _i_prefix bmap_
+#endif
+#ifndef _i_isset
+  #define _i_ismap
+  #define _i_MAP_ONLY c_true
+  #define _i_SET_ONLY c_false
+  #define _i_keyref(vp) (&(vp)->first)
+#else
+  #define _i_MAP_ONLY c_false
+  #define _i_SET_ONLY c_true
+  #define _i_keyref(vp) (vp)
+#endif
+#define _i_sorted
+#include "priv/template.h"
+#ifndef i_is_forward
+  _c_DEFTYPES(_c_btree_types, i_type, i_key, i_val, _i_MAP_ONLY, _i_SET_ONLY);
+#endif
+#ifndef i_node_size
+  #define i_node_size 512
+#endif
+#define _m_inner _c_MEMB(_inner)
+
+// Elements per leaf and children per inner node that fit in i_node_size bytes, at least 4 and 8.
+#define _i_LEAF_N ((int)((i_node_size - 16)/sizeof(_m_value) < 4 ? 4 : \
+                         (i_node_size - 16)/sizeof(_m_value)))
+#define _i_INNER_N ((int)((i_node_size - 8 + sizeof(_m_key))/(sizeof(_m_key) + sizeof(void*)) < 8 ? 8 : \
+                          (i_node_size - 8 + sizeof(_m_key))/(sizeof(_m_key) + sizeof(void*))))
+#define _i_LEAF_MIN (_i_LEAF_N/2)
+#define _i_INNER_MIN ((_i_INNER_N - 1)/2)
+
+_i_MAP_ONLY( struct _m_value {
+    _m_key first;
+    _m_mapped second;
+}; )
+struct _m_node { // leaf
+    _m_node *next;
+    int32_t n;
+    _m_value data[_i_LEAF_N];
+};
+typedef struct _m_inner {
+    int32_t n; // number of keys; n + 1 children
+    void* child[_i_INNER_N];
+    _m_key key[_i_INNER_N - 1]; // not owned: key[i] is a bitwise copy of the first key under child[i + 1]
+} _m_inner;
+
+typedef i_keyraw _m_keyraw;
+typedef i_valraw _m_rmapped;
+typedef _i_SET_ONLY( _m_keyraw )
+        _i_MAP_ONLY( struct { _m_keyraw first; _m_rmapped second; } )
+        _m_raw;
+
+#if !defined i_no_emplace
+STC_API _m_result       _c_MEMB(_emplace)(i_type* self, _m_keyraw rkey _i_MAP_ONLY(, _m_rmapped rmapped));
+#endif // !i_no_emplace
+#if !defined i_no_clone
+STC_API i_type          _c_MEMB(_clone)(i_type tree);
+#endif // !i_no_clone
+STC_API void            _c_MEMB(_drop)(const i_type* cself);
+STC_API _m_value*       _c_MEMB(_find_it)(const i_type* self, _m_keyraw rkey, _m_iter* out);
+STC_API _m_iter         _c_MEMB(_lower_bound)(const i_type* self, _m_keyraw rkey);
+STC_API _m_value*       _c_MEMB(_front)(const i_type* self);
+STC_API _m_value*       _c_MEMB(_back)(const i_type* self);
+STC_API int             _c_MEMB(_erase)(i_type* self, _m_keyraw rkey);
+STC_API _m_iter         _c_MEMB(_erase_at)(i_type* self, _m_iter it);
+STC_API _m_iter         _c_MEMB(_erase_range)(i_type* self, _m_iter it1, _m_iter it2);
+STC_API _m_iter         _c_MEMB(_begin)(const i_type* self);
+
+STC_INLINE i_type       _c_MEMB(_init)(void) { i_type tree = {0}; return tree; }
+STC_INLINE bool         _c_MEMB(_empty)(const i_type* cx) { return cx->size == 0; }
+STC_INLINE intptr_t     _c_MEMB(_size)(const i_type* cx) { return cx->size; }
+STC_INLINE _m_iter      _c_MEMB(_find)(const i_type* self, _m_keyraw rkey)
+                            { _m_iter it; _c_MEMB(_find_it)(self, rkey, &it); return it; }
+STC_INLINE bool         _c_MEMB(_contains)(const i_type* self, _m_keyraw rkey)
+                            { _m_iter it; return _c_MEMB(_find_it)(self, rkey, &it) != NULL; }
+STC_INLINE const _m_value* _c_MEMB(_get)(const i_type* self, _m_keyraw rkey)
+                            { _m_iter it; return _c_MEMB(_find_it)(self, rkey, &it); }
+STC_INLINE _m_value*    _c_MEMB(_get_mut)(i_type* self, _m_keyraw rkey)
+                            { _m_iter it; return _c_MEMB(_find_it)(self, rkey, &it); }
+
+STC_INLINE void
+_c_MEMB(_clear)(i_type* self)
+    { _c_MEMB(_drop)(self); *self = _c_MEMB(_init)(); }
+
+STC_INLINE _m_raw
+_c_MEMB(_value_toraw)(const _m_value* val) {
+    return _i_SET_ONLY( i_keyto(val) )
+           _i_MAP_ONLY( c_LITERAL(_m_raw){i_keyto((&val->first)),
+                                        i_valto((&val->second))} );
+}
+
+STC_INLINE void
+_c_MEMB(_value_drop)(_m_value* val) {
+    i_keydrop(_i_keyref(val));
+    _i_MAP_ONLY( i_valdrop((&val->second)); )
+}
+
+#if !defined i_no_clone
+STC_INLINE _m_value
+_c_MEMB(_value_clone)(_m_value _val) {
+    *_i_keyref(&_val) = i_keyclone((*_i_keyref(&_val)));
+    _i_MAP_ONLY( _val.second = i_valclone(_val.second); )
+    return _val;
+}
+
+STC_INLINE void
+_c_MEMB(_copy)(i_type *self, const i_type* other) {
+    if (self->root == other->root)
+        return;
+    _c_MEMB(_drop)(self);
+    *self = _c_MEMB(_clone)(*other);
+}
+#endif // !i_no_clone
+
+STC_API _m_result _c_MEMB(_insert_entry_)(i_type* self, _m_keyraw rkey);
+
+#ifdef _i_ismap
+    STC_API _m_result _c_MEMB(_insert_or_assign)(i_type* self, _m_key key, _m_mapped mapped);
+    #if !defined i_no_emplace
+        STC_API _m_result  _c_MEMB(_emplace_or_assign)(i_type* self, _m_keyraw rkey, _m_rmapped rmapped);
+
+        STC_INLINE _m_result
+        _c_MEMB(_emplace_key)(i_type* self, _m_keyraw rkey) {
+            _m_result res = _c_MEMB(_insert_entry_)(self, rkey);
+            if (res.inserted)
+                res.ref->first = i_keyfrom(rkey);
+            return res;
+        }
+    #endif
+    STC_INLINE const _m_mapped*
+    _c_MEMB(_at)(const i_type* self, _m_keyraw rkey)
+        { _m_iter it; return &_c_MEMB(_find_it)(self, rkey, &it)->second; }
+
+    STC_INLINE _m_mapped*
+    _c_MEMB(_at_mut)(i_type* self, _m_keyraw rkey)
+        { _m_iter it; return &_c_MEMB(_find_it)(self, rkey, &it)->second; }
+#endif // _i_ismap
+
+STC_INLINE _m_iter
+_c_MEMB(_end)(const i_type* self) {
+    _m_iter it; (void)self;
+    it.ref = it._end = NULL, it._leaf = NULL;
+    return it;
+}
+
+STC_INLINE void
+_c_MEMB(_next)(_m_iter* it) {
+    if (++it->ref == it->_end) {
+        if ((it->_leaf = it->_leaf->next))
+            it->ref = it->_leaf->data, it->_end = it->ref + it->_leaf->n;
+        else
+            it->ref = NULL;
+    }
+}
+
+STC_INLINE _m_iter
+_c_MEMB(_advance)(_m_iter it, size_t n) {
+    while (n-- && it.ref)
+        _c_MEMB(_next)(&it);
+    return it;
+}
+
+#if defined _i_has_eq
+STC_INLINE bool
+_c_MEMB(_eq)(const i_type* self, const i_type* other) {
+    if (_c_MEMB(_size)(self) != _c_MEMB(_size)(other)) return false;
+    _m_iter i = _c_MEMB(_begin)(self), j = _c_MEMB(_begin)(other);
+    for (; i.ref; _c_MEMB(_next)(&i), _c_MEMB(_next)(&j)) {
+        const _m_keyraw _rx = i_keyto(_i_keyref(i.ref)), _ry = i_keyto(_i_keyref(j.ref));
+        if (!(i_eq((&_rx), (&_ry)))) return false;
+    }
+    return true;
+}
+#endif
+
+STC_INLINE _m_result
+_c_MEMB(_insert)(i_type* self, _m_key _key _i_MAP_ONLY(, _m_mapped _mapped)) {
+    _m_result _res = _c_MEMB(_insert_entry_)(self, i_keyto((&_key)));
+    if (_res.inserted)
+        { *_i_keyref(_res.ref) = _key; _i_MAP_ONLY( _res.ref->second = _mapped; )}
+    else
+        { i_keydrop((&_key)); _i_MAP_ONLY( i_valdrop((&_mapped)); )}
+    return _res;
+}
+
+STC_INLINE _m_value*
+_c_MEMB(_push)(i_type* self, _m_value _val) {
+    _m_result _res = _c_MEMB(_insert_entry_)(self, i_keyto(_i_keyref(&_val)));
+    if (_res.inserted)
+        *_res.ref = _val;
+    else
+        _c_MEMB(_value_drop)(&_val);
+    return _res.ref;
+}
+
+STC_INLINE void
+_c_MEMB(_put_n)(i_type* self, const _m_raw* raw, intptr_t n) {
+    while (n--)
+#if defined _i_isset && defined i_no_emplace
+        _c_MEMB(_insert)(self, *raw++);
+#elif defined _i_isset
+        _c_MEMB(_emplace)(self, *raw++);
+#elif defined i_no_emplace
+        _c_MEMB(_insert_or_assign)(self, raw->first, raw->second), ++raw;
+#else
+        _c_MEMB(_emplace_or_assign)(self, raw->first, raw->second), ++raw;
+#endif
+}
+
+STC_INLINE i_type
+_c_MEMB(_from_n)(const _m_raw* raw, intptr_t n)
+    { i_type cx = {0}; _c_MEMB(_put_n)(&cx, raw, n); return cx; }
+
+/* -------------------------- IMPLEMENTATION ------------------------- */
+#if defined(i_implement) || defined(i_static)
+
+static _m_iter
+_c_MEMB(_iter_at_)(_m_node* leaf, int32_t pos) {
+    _m_iter it = {NULL};
+    if (pos == leaf->n)
+        leaf = leaf->next, pos = 0;
+    if (leaf) {
+        it.ref = leaf->data + pos;
+        it._end = leaf->data + leaf->n;
+        it._leaf = leaf;
+    }
+    return it;
+}
+
+STC_DEF _m_iter
+_c_MEMB(_begin)(const i_type* self) {
+    void* nd = self->root;
+    for (int32_t h = self->height; h--; )
+        nd = ((_m_inner*)nd)->child[0];
+    if (!nd)
+        return _c_MEMB(_end)(self);
+    return _c_MEMB(_iter_at_)((_m_node*)nd, 0);
+}
+
+STC_DEF _m_value*
+_c_MEMB(_front)(const i_type* self) {
+    _m_iter it = _c_MEMB(_begin)(self);
+    return it.ref;
+}
+
+STC_DEF _m_value*
+_c_MEMB(_back)(const i_type* self) {
+    void* nd = self->root;
+    for (int32_t h = self->height; h--; )
+        nd = ((_m_inner*)nd)->child[((_m_inner*)nd)->n];
+    return nd ? &((_m_node*)nd)->data[((_m_node*)nd)->n - 1] : NULL;
+}
+
+// Index of the child of nd whose subtree may hold rkey: the number of separator keys <= rkey.
+static int32_t
+_c_MEMB(_child_index_)(const _m_inner* nd, const _m_keyraw* rkey) {
+    int32_t lo = 0, hi = nd->n;
+    while (lo < hi) {
+        const int32_t mid = (lo + hi)/2;
+        const _m_keyraw _raw = i_keyto((&nd->key[mid]));
+        if (i_cmp((&_raw), rkey) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Index of the first element in leaf with key >= rkey.
+static int32_t
+_c_MEMB(_leaf_index_)(const _m_node* leaf, const _m_keyraw* rkey) {
+    int32_t lo = 0, hi = leaf->n;
+    while (lo < hi) {
+        const int32_t mid = (lo + hi)/2;
+        const _m_keyraw _raw = i_keyto(_i_keyref(&leaf->data[mid]));
+        if (i_cmp((&_raw), rkey) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Find the leaf which holds or should hold rkey. Optionally record the path of inner nodes.
+static _m_node*
+_c_MEMB(_descend_)(const i_type* self, const _m_keyraw* rkey, _m_inner** up, int32_t* ix) {
+    void* nd = self->root;
+    for (int32_t h = 0; h < self->height; ++h) {
+        const int32_t i = _c_MEMB(_child_index_)((_m_inner*)nd, rkey);
+        if (up) up[h] = (_m_inner*)nd, ix[h] = i;
+        nd = ((_m_inner*)nd)->child[i];
+    }
+    return (_m_node*)nd;
+}
+
+#ifdef _i_ismap
+    STC_DEF _m_result
+    _c_MEMB(_insert_or_assign)(i_type* self, _m_key _key, _m_mapped _mapped) {
+        _m_result _res = _c_MEMB(_insert_entry_)(self, i_keyto((&_key)));
+        _m_mapped* _mp = _res.ref ? &_res.ref->second : &_mapped;
+        if (_res.inserted)
+            _res.ref->first = _key;
+        else
+            { i_keydrop((&_key)); i_valdrop(_mp); }
+        *_mp = _mapped;
+        return _res;
+    }
+
+    #if !defined i_no_emplace
+    STC_DEF _m_result
+    _c_MEMB(_emplace_or_assign)(i_type* self, _m_keyraw rkey, _m_rmapped rmapped) {
+        _m_result _res = _c_MEMB(_insert_entry_)(self, rkey);
+        if (_res.inserted)
+            _res.ref->first = i_keyfrom(rkey);
+        else {
+            if (!_res.ref) return _res;
+            i_valdrop((&_res.ref->second));
+        }
+        _res.ref->second = i_valfrom(rmapped);
+        return _res;
+    }
+    #endif // !i_no_emplace
+#endif // !_i_ismap
+
+STC_DEF _m_value*
+_c_MEMB(_find_it)(const i_type* self, _m_keyraw rkey, _m_iter* out) {
+    _m_node* leaf = _c_MEMB(_descend_)(self, &rkey, NULL, NULL);
+    if (leaf) {
+        const int32_t pos = _c_MEMB(_leaf_index_)(leaf, &rkey);
+        if (pos < leaf->n) {
+            const _m_keyraw _raw = i_keyto(_i_keyref(&leaf->data[pos]));
+            if (i_cmp((&_raw), (&rkey)) == 0)
+                return (*out = _c_MEMB(_iter_at_)(leaf, pos)).ref;
+        }
+    }
+    *out = _c_MEMB(_end)(self);
+    return NULL;
+}
+
+STC_DEF _m_iter
+_c_MEMB(_lower_bound)(const i_type* self, _m_keyraw rkey) {
+    _m_node* leaf = _c_MEMB(_descend_)(self, &rkey, NULL, NULL);
+    if (!leaf)
+        return _c_MEMB(_end)(self);
+    return _c_MEMB(_iter_at_)(leaf, _c_MEMB(_leaf_index_)(leaf, &rkey));
+}
+
+// Insert (key, child) after child[i] in the non-full inner node nd.
+static void
+_c_MEMB(_inner_insert_)(_m_inner* nd, int32_t i, const _m_key* key, void* child) {
+    memmove(nd->key + i + 1, nd->key + i, (size_t)(nd->n - i)*sizeof(_m_key));
+    memmove(nd->child + i + 2, nd->child + i + 1, (size_t)(nd->n - i)*sizeof(void*));
+    nd->key[i] = *key;
+    nd->child[i + 1] = child;
+    ++nd->n;
+}
+
+STC_DEF _m_result
+_c_MEMB(_insert_entry_)(i_type* self, _m_keyraw rkey) {
+    _m_result res = {NULL};
+    _m_inner* up[_bmap_MAXHEIGHT]; int32_t ix[_bmap_MAXHEIGHT];
+    if (!self->root) {
+        _m_node* leaf = _i_alloc(_m_node);
+        if (!leaf) return res;
+        leaf->next = NULL, leaf->n = 0;
+        self->root = leaf;
+    }
+    _m_node* leaf = _c_MEMB(_descend_)(self, &rkey, up, ix);
+    int32_t pos = _c_MEMB(_leaf_index_)(leaf, &rkey);
+    if (pos < leaf->n) {
+        const _m_keyraw _raw = i_keyto(_i_keyref(&leaf->data[pos]));
+        if (i_cmp((&_raw), (&rkey)) == 0)
+            { res.ref = &leaf->data[pos]; return res; }
+    }
+    if (leaf->n < _i_LEAF_N) {
+        memmove(leaf->data + pos + 1, leaf->data + pos, (size_t)(leaf->n - pos)*sizeof(_m_value));
+        ++leaf->n;
+        res.ref = &leaf->data[pos];
+    } else {
+        // Allocate the nodes for all the splits up front, so that failure leaves the tree intact.
+        void* fresh[_bmap_MAXHEIGHT + 2];
+        int32_t h = self->height, nfresh = 0, k;
+        fresh[nfresh++] = _i_alloc(_m_node);
+        while (h-- && up[h]->n == _i_INNER_N - 1)
+            fresh[nfresh++] = _i_alloc(_m_inner);
+        if (h < 0)
+            fresh[nfresh++] = _i_alloc(_m_inner); // new root
+        for (k = 0; k < nfresh && fresh[k]; ++k) ;
+        if (k < nfresh) {
+            for (k = 0; k < nfresh; ++k)
+                if (fresh[k]) i_free(fresh[k], k ? c_sizeof(_m_inner) : c_sizeof(_m_node));
+            return res;
+        }
+        // Split the leaf, and let the new element go where the new leaf gets an existing first key.
+        _m_node* right = (_m_node*)fresh[0];
+        const int32_t half = (_i_LEAF_N + 1)/2, split = pos < half ? half - 1 : half;
+        right->n = _i_LEAF_N - split;
+        memcpy(right->data, leaf->data + split, (size_t)right->n*sizeof(_m_value));
+        leaf->n = split;
+        right->next = leaf->next, leaf->next = right;
+        _m_node* dst = leaf;
+        if (pos > split)
+            dst = right, pos -= split;
+        memmove(dst->data + pos + 1, dst->data + pos, (size_t)(dst->n - pos)*sizeof(_m_value));
+        ++dst->n;
+        res.ref = &dst->data[pos];
+
+        // Insert the separator and new node into the parents, splitting the full ones.
+        _m_key sep = *_i_keyref(&right->data[0]);
+        void* child = right;
+        for (h = self->height, k = 1; h-- && child; ) {
+            _m_inner* nd = up[h];
+            const int32_t i = ix[h];
+            if (nd->n < _i_INNER_N - 1) {
+                _c_MEMB(_inner_insert_)(nd, i, &sep, child);
+                child = NULL;
+                break;
+            }
+            enum { K = _i_INNER_N - 1 };
+            _m_key keys[_i_INNER_N]; void* kids[_i_INNER_N + 1];
+            memcpy(keys, nd->key, (size_t)i*sizeof(_m_key));
+            memcpy(keys + i + 1, nd->key + i, (size_t)(K - i)*sizeof(_m_key));
+            memcpy(kids, nd->child, (size_t)(i + 1)*sizeof(void*));
+            memcpy(kids + i + 2, nd->child + i + 1, (size_t)(K - i)*sizeof(void*));
+            keys[i] = sep, kids[i + 1] = child;
+
+            _m_inner* nr = (_m_inner*)fresh[k++];
+            const int32_t m = (K + 1)/2; // keys[m] moves up
+            nd->n = m;
+            memcpy(nd->key, keys, (size_t)m*sizeof(_m_key));
+            memcpy(nd->child, kids, (size_t)(m + 1)*sizeof(void*));
+            nr->n = K - m;
+            memcpy(nr->key, keys + m + 1, (size_t)nr->n*sizeof(_m_key));
+            memcpy(nr->child, kids + m + 1, (size_t)(nr->n + 1)*sizeof(void*));
+            sep = keys[m], child = nr;
+        }
+        if (child) {
+            _m_inner* root = (_m_inner*)fresh[k];
+            root->n = 1;
+            root->key[0] = sep;
+            root->child[0] = self->root, root->child[1] = child;
+            self->root = root;
+            ++self->height;
+        }
+    }
+    res.inserted = true;
+    ++self->size;
+    return res;
+}
+
+// Rebalance the inner node up[h] after it lost a key, and continue upwards while needed.
+static void
+_c_MEMB(_fix_inner_)(i_type* self, _m_inner** up, const int32_t* ix, int32_t h) {
+    for (;; --h) {
+        _m_inner *nd = up[h], *sib;
+        if (h == 0) {
+            if (nd->n == 0) {
+                self->root = nd->child[0];
+                --self->height;
+                i_free(nd, c_sizeof(_m_inner));
+            }
+            return;
+        }
+        if (nd->n >= _i_INNER_MIN)
+            return;
+        _m_inner* p = up[h - 1];
+        int32_t i = ix[h - 1];
+        if (i > 0 && (sib = (_m_inner*)p->child[i - 1])->n > _i_INNER_MIN) { // rotate right
+            memmove(nd->key + 1, nd->key, (size_t)nd->n*sizeof(_m_key));
+            memmove(nd->child + 1, nd->child, (size_t)(nd->n + 1)*sizeof(void*));
+            nd->key[0] = p->key[i - 1];
+            nd->child[0] = sib->child[sib->n];
+            p->key[i - 1] = sib->key[--sib->n];
+            ++nd->n;
+            return;
+        }
+        if (i < p->n && (sib = (_m_inner*)p->child[i + 1])->n > _i_INNER_MIN) { // rotate left
+            nd->key[nd->n] = p->key[i];
+            nd->child[++nd->n] = sib->child[0];
+            p->key[i] = sib->key[0];
+            memmove(sib->key, sib->key + 1, (size_t)(sib->n - 1)*sizeof(_m_key));
+            memmove(sib->child, sib->child + 1, (size_t)sib->n*sizeof(void*));
+            --sib->n;
+            return;
+        }
+        if (i > 0) --i; // merge child[i + 1] into child[i]
+        _m_inner *l = (_m_inner*)p->child[i], *r = (_m_inner*)p->child[i + 1];
+        l->key[l->n] = p->key[i];
+        memcpy(l->key + l->n + 1, r->key, (size_t)r->n*sizeof(_m_key));
+        memcpy(l->child + l->n + 1, r->child, (size_t)(r->n + 1)*sizeof(void*));
+        l->n += r->n + 1;
+        i_free(r, c_sizeof(_m_inner));
+        memmove(p->key + i, p->key + i + 1, (size_t)(p->n - i - 1)*sizeof(_m_key));
+        memmove(p->child + i + 1, p->child + i + 2, (size_t)(p->n - i - 1)*sizeof(void*));
+        --p->n;
+    }
+}
+
+// Remove the (dropped) element at pos from leaf, found by a descent which recorded the path.
+static void
+_c_MEMB(_remove_)(i_type* self, _m_inner** up, const int32_t* ix, _m_node* leaf, int32_t pos) {
+    memmove(leaf->data + pos, leaf->data + pos + 1, (size_t)(--leaf->n - pos)*sizeof(_m_value));
+    --self->size;
+    const int32_t h = self->height;
+    if (h == 0) {
+        if (leaf->n == 0) {
+            i_free(leaf, c_sizeof(_m_node));
+            self->root = NULL;
+        }
+        return;
+    }
+    if (pos == 0) { // update the separator copy of the first key, in the nearest ancestor having it
+        int32_t k = h - 1;
+        while (k >= 0 && ix[k] == 0) --k;
+        if (k >= 0) up[k]->key[ix[k] - 1] = *_i_keyref(&leaf->data[0]);
+    }
+    if (leaf->n >= _i_LEAF_MIN)
+        return;
+    _m_inner* p = up[h - 1];
+    int32_t i = ix[h - 1];
+    _m_node* sib;
+    if (i > 0 && (sib = (_m_node*)p->child[i - 1])->n > _i_LEAF_MIN) { // borrow from left
+        memmove(leaf->data + 1, leaf->data, (size_t)leaf->n*sizeof(_m_value));
+        leaf->data[0] = sib->data[--sib->n];
+        ++leaf->n;
+        p->key[i - 1] = *_i_keyref(&leaf->data[0]);
+        return;
+    }
+    if (i < p->n && (sib = (_m_node*)p->child[i + 1])->n > _i_LEAF_MIN) { // borrow from right
+        leaf->data[leaf->n++] = sib->data[0];
+        memmove(sib->data, sib->data + 1, (size_t)--sib->n*sizeof(_m_value));
+        p->key[i] = *_i_keyref(&sib->data[0]);
+        return;
+    }
+    if (i > 0) --i; // merge child[i + 1] into child[i]
+    _m_node *l = (_m_node*)p->child[i], *r = (_m_node*)p->child[i + 1];
+    memcpy(l->data + l->n, r->data, (size_t)r->n*sizeof(_m_value));
+    l->n += r->n;
+    l->next = r->next;
+    i_free(r, c_sizeof(_m_node));
+    memmove(p->key + i, p->key + i + 1, (size_t)(p->n - i - 1)*sizeof(_m_key));
+    memmove(p->child + i + 1, p->child + i + 2, (size_t)(p->n - i - 1)*sizeof(void*));
+    --p->n;
+    _c_MEMB(_fix_inner_)(self, up, ix, h - 1);
+}
+
+STC_DEF int
+_c_MEMB(_erase)(i_type* self, _m_keyraw rkey) {
+    _m_inner* up[_bmap_MAXHEIGHT]; int32_t ix[_bmap_MAXHEIGHT];
+    _m_node* leaf = _c_MEMB(_descend_)(self, &rkey, up, ix);
+    if (!leaf)
+        return 0;
+    const int32_t pos = _c_MEMB(_leaf_index_)(leaf, &rkey);
+    if (pos == leaf->n)
+        return 0;
+    const _m_keyraw _raw = i_keyto(_i_keyref(&leaf->data[pos]));
+    if (i_cmp((&_raw), (&rkey)) != 0)
+        return 0;
+    _c_MEMB(_value_drop)(&leaf->data[pos]);
+    _c_MEMB(_remove_)(self, up, ix, leaf, pos);
+    return 1;
+}
+
+STC_DEF _m_iter
+_c_MEMB(_erase_at)(i_type* self, _m_iter it) {
+    _m_node* leaf = it._leaf;
+    if (it.ref != leaf->data && (self->height == 0 || leaf->n > _i_LEAF_MIN)) {
+        // no separator or rebalancing changes: remove in place
+        _c_MEMB(_value_drop)(it.ref);
+        memmove(it.ref, it.ref + 1, (size_t)(--it._end - it.ref)*sizeof(_m_value));
+        --leaf->n, --self->size;
+        if (it.ref == it._end)
+            it = _c_MEMB(_iter_at_)(leaf, leaf->n);
+        return it;
+    }
+    _m_keyraw raw = i_keyto(_i_keyref(it.ref));
+    _c_MEMB(_next)(&it);
+    if (it.ref) {
+        _m_key nxt = *_i_keyref(it.ref); // bitwise copy of a key that stays alive
+        _c_MEMB(_erase)(self, raw);
+        return _c_MEMB(_lower_bound)(self, i_keyto((&nxt)));
+    }
+    _c_MEMB(_erase)(self, raw);
+    return it;
+}
+
+STC_DEF _m_iter
+_c_MEMB(_erase_range)(i_type* self, _m_iter it1, _m_iter it2) {
+    if (!it2.ref) {
+        while (it1.ref)
+            it1 = _c_MEMB(_erase_at)(self, it1);
+        return it1;
+    }
+    // it2.ref may move when nodes are rebalanced, so track the end by its key.
+    const _m_key k2 = *_i_keyref(it2.ref); // bitwise copy of a key that stays alive
+    const _m_keyraw r2 = i_keyto((&k2));
+    while (it1.ref) {
+        const _m_keyraw _raw = i_keyto(_i_keyref(it1.ref));
+        if (i_cmp((&_raw), (&r2)) == 0)
+            break;
+        it1 = _c_MEMB(_erase_at)(self, it1);
+    }
+    return it1;
+}
+
+#if !defined i_no_clone
+static void _c_MEMB(_drop_r_)(void* nd, int32_t h);
+
+// Returns NULL when out of memory, after freeing the part of the subtree it cloned.
+static void*
+_c_MEMB(_clone_r_)(const void* src, int32_t h, _m_node** last, _m_key* first) {
+    if (h == 0) {
+        const _m_node* s = (const _m_node*)src;
+        _m_node* leaf = _i_alloc(_m_node);
+        if (!leaf) return NULL;
+        for (int32_t j = 0; j < s->n; ++j)
+            leaf->data[j] = _c_MEMB(_value_clone)(s->data[j]);
+        leaf->n = s->n, leaf->next = NULL;
+        if (*last) (*last)->next = leaf;
+        *last = leaf;
+        *first = *_i_keyref(&leaf->data[0]);
+        return leaf;
+    }
+    const _m_inner* s = (const _m_inner*)src;
+    _m_inner* nd = _i_alloc(_m_inner);
+    if (!nd) return NULL;
+    if (!(nd->child[0] = _c_MEMB(_clone_r_)(s->child[0], h - 1, last, first)))
+        { i_free(nd, c_sizeof(_m_inner)); return NULL; }
+    for (nd->n = 0; nd->n < s->n; ++nd->n) { // separators must refer to the cloned keys
+        void* child = _c_MEMB(_clone_r_)(s->child[nd->n + 1], h - 1, last, &nd->key[nd->n]);
+        if (!child)
+            { _c_MEMB(_drop_r_)(nd, h); return NULL; }
+        nd->child[nd->n + 1] = child;
+    }
+    return nd;
+}
+
+// Returns an empty tree when out of memory.
+STC_DEF i_type
+_c_MEMB(_clone)(i_type tree) {
+    i_type clone = tree;
+    if (tree.root) {
+        _m_node* last = NULL; _m_key first;
+        clone.root = _c_MEMB(_clone_r_)(tree.root, tree.height, &last, &first);
+        if (!clone.root)
+            clone = _c_MEMB(_init)();
+    }
+    return clone;
+}
+#endif // !i_no_clone
+
+#if !defined i_no_emplace
+STC_DEF _m_result
+_c_MEMB(_emplace)(i_type* self, _m_keyraw rkey _i_MAP_ONLY(, _m_rmapped rmapped)) {
+    _m_result res = _c_MEMB(_insert_entry_)(self, rkey);
+    if (res.inserted) {
+        *_i_keyref(res.ref) = i_keyfrom(rkey);
+        _i_MAP_ONLY(res.ref->second = i_valfrom(rmapped);)
+    }
+    return res;
+}
+#endif // i_no_emplace
+
+static void
+_c_MEMB(_drop_r_)(void* nd, int32_t h) {
+    if (h == 0) {
+        _m_node* leaf = (_m_node*)nd;
+        for (int32_t j = 0; j < leaf->n; ++j)
+            _c_MEMB(_value_drop)(&leaf->data[j]);
+        i_free(leaf, c_sizeof(_m_node));
+        return;
+    }
+    _m_inner* in = (_m_inner*)nd;
+    for (int32_t j = 0; j <= in->n; ++j)
+        _c_MEMB(_drop_r_)(in->child[j], h - 1);
+    i_free(in, c_sizeof(_m_inner));
+}
+
+STC_DEF void
+_c_MEMB(_drop)(const i_type* cself) {
+    i_type* self = (i_type*)cself;
+    if (self->root)
+        _c_MEMB(_drop_r_)(self->root, self->height);
+}
+
+#endif // i_implement
+#undef _i_isset
+#undef _i_ismap
+#undef _i_sorted
+#undef _i_keyref
+#undef _i_MAP_ONLY
+#undef _i_SET_ONLY
+#undef _i_LEAF_N
+#undef _i_INNER_N
+#undef _i_LEAF_MIN
+#undef _i_INNER_MIN
+#undef _m_inner
+#undef i_node_size
+#include "priv/template2.h"
+#include "priv/linkage2.h"
@@ -0,0 +1,46 @@
+/* MIT License
+ *
+ * Copyright (c) 2023 Tyge Løvset
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Sorted set - implemented as a B+-tree.
+/*
+#include <stdio.h>
+
+#define i_TYPE bset_i,int
+#include "stc/bset.h" // sorted set of int
+
+int main(void) {
+    bset_i s = {0};
+    bset_i_insert(&s, 5);
+    bset_i_insert(&s, 8);
+    bset_i_insert(&s, 3);
+    bset_i_insert(&s, 5);
+
+    c_foreach (k, bset_i, s)
+        printf("set %d\n", *k.ref);
+    bset_i_drop(&s);
+}
+*/
+
+#define _i_prefix bset_
+#define _i_isset
+#include "bmap.h"
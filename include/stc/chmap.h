@@ -0,0 +1,320 @@
+/* MIT License
+ *
+ * Copyright (c) 2023 Tyge Løvset
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Concurrent unordered map - i_shards hmaps, each guarded by its own reader-writer lock.
+// The shard is selected by the middle bits of the key hash, the bucket by the lower bits
+// (with i_compact, by the upper bits).
+/*
+#include <stdio.h>
+#define i_TYPE CImap,int,int
+#include "stc/chmap.h"
+
+int main(void) {
+    CImap m;
+    CImap_init(&m);
+    CImap_insert(&m, 5, 50); // may be called from multiple threads
+    CImap_insert(&m, 8, 80);
+    int val;
+    if (CImap_get(&m, 5, &val))
+        printf("5: %d\n", val);
+
+    c_forrange (i, CImap_shard_count(&m)) {
+        const CImap_shard* s = CImap_read_lock(&m, i);
+        c_foreach (j, CImap_shard, *s)
+            printf("%d: %d\n", j.ref->first, j.ref->second);
+        CImap_read_unlock(&m, i);
+    }
+    CImap_drop(&m);
+}
+*/
+#ifndef STC_CHMAP_H_INCLUDED
+#define STC_CHMAP_H_INCLUDED
+#include "common.h"
+#if defined _WIN32
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+  typedef SRWLOCK chmap_rwlock;
+  #define chmap_rwlock_init(l) InitializeSRWLock(l)
+  #define chmap_rwlock_destroy(l) ((void)(l))
+  #define chmap_rdlock(l) AcquireSRWLockShared(l)
+  #define chmap_rdunlock(l) ReleaseSRWLockShared(l)
+  #define chmap_wrlock(l) AcquireSRWLockExclusive(l)
+  #define chmap_wrunlock(l) ReleaseSRWLockExclusive(l)
+#else // pthread_rwlock_t requires _POSIX_C_SOURCE >= 200112L, e.g. -std=gnu11
+  #include <pthread.h>
+  typedef pthread_rwlock_t chmap_rwlock;
+  #define chmap_rwlock_init(l) pthread_rwlock_init(l, NULL)
+  #define chmap_rwlock_destroy(l) pthread_rwlock_destroy(l)
+  #define chmap_rdlock(l) pthread_rwlock_rdlock(l)
+  #define chmap_rdunlock(l) pthread_rwlock_unlock(l)
+  #define chmap_wrlock(l) pthread_rwlock_wrlock(l)
+  #define chmap_wrunlock(l) pthread_rwlock_unlock(l)
+#endif
+#endif // STC_CHMAP_H_INCLUDED
+
+// The map type name must be reachable without i_type, as i_type names the shard type below.
+#if defined i_soa
+  #error "chmap.h: i_soa is not supported"
+#elif defined i_stats
+  #error "chmap.h: i_stats is not supported, as lookups under a shared lock would write the counters"
+#elif defined i_type && !defined i_TYPE
+  #error "chmap.h: name the map type with i_TYPE, or by i_tag (type name: chmap_{i_tag})"
+#elif defined i_TYPE
+  #define _i_chtype _c_SEL(_c_SEL31, i_TYPE)
+#else
+  #define _i_chtype c_JOIN(chmap_, i_tag)
+#endif
+#ifndef i_shards
+  #define i_shards 64
+#endif
+#if defined i_static
+  #define _i_chstatic
+#endif
+#if defined i_header
+  #define _i_chheader
+#endif
+#if defined i_implement
+  #define _i_chimplement
+#endif
+#if defined i_import
+  #define _i_chimport
+#endif
+#if defined i_compact // undefined by hmap.h
+  #define _i_chcompact
+#endif
+
+// Instantiate the shard hmap, and keep the template parameters (i_more) for the chmap.
+#define i_type c_JOIN(_i_chtype, _shard)
+#define i_more
+#include "hmap.h"
+#undef i_type
+#define i_type _i_chtype
+#ifdef _i_chstatic
+  #define i_static
+#endif
+#ifdef _i_chheader
+  #define i_header
+#endif
+#ifdef _i_chimplement
+  #define i_implement
+#endif
+#ifdef _i_chimport
+  #define i_import
+#endif
+#include "priv/linkage.h"
+
+#define _m_shard _c_MEMB(_shard)
+#define _c_SHARD(name) c_JOIN(_m_shard, name)
+
+typedef _c_SHARD(_key) _m_key;
+typedef _c_SHARD(_mapped) _m_mapped;
+typedef _c_SHARD(_keyraw) _m_keyraw;
+typedef _c_SHARD(_rmapped) _m_rmapped;
+typedef _c_SHARD(_value) _m_value;
+typedef struct { chmap_rwlock lock; _m_shard map; } _c_MEMB(_part_);
+
+typedef struct i_type {
+    union { // pad each shard to whole cache lines to avoid false sharing
+        _c_MEMB(_part_) p;
+        char _pad[(sizeof(_c_MEMB(_part_)) + 63) & ~(size_t)63];
+    } _shard[i_shards];
+} i_type;
+
+STC_API void        _c_MEMB(_init)(i_type* self);
+STC_API void        _c_MEMB(_drop)(i_type* self);
+STC_API void        _c_MEMB(_clear)(i_type* self);
+STC_API intptr_t    _c_MEMB(_size)(i_type* self);
+STC_API bool        _c_MEMB(_reserve)(i_type* self, intptr_t capacity);
+
+STC_INLINE intptr_t _c_MEMB(_shard_count)(const i_type* self) { (void)self; return i_shards; }
+
+// The shard is taken from hash bits that neither the buckets nor the tags of the shard read, else
+// the keys of a shard would share those bits. i_compact buckets use the high 32 bits and the tags the
+// low 7: take bits 8..31. Otherwise buckets use the low bits and the tags bits 0..6 and 57..63: take
+// bits 32..56.
+#if defined _i_chcompact
+STC_INLINE _c_MEMB(_part_)* _c_MEMB(_part_of_)(i_type* self, uint64_t hash)
+    { return &self->_shard[(((uint32_t)hash >> 8)*(uint64_t)(i_shards)) >> 24].p; }
+#else
+STC_INLINE _c_MEMB(_part_)* _c_MEMB(_part_of_)(i_type* self, uint64_t hash)
+    { return &self->_shard[((hash >> 32 & 0x1ffffff)*(uint64_t)(i_shards)) >> 25].p; }
+#endif
+
+// Lock a shard for iteration with c_foreach or for compound operations with the hmap API.
+STC_INLINE const _m_shard* _c_MEMB(_read_lock)(i_type* self, intptr_t idx)
+    { chmap_rdlock(&self->_shard[idx].p.lock); return &self->_shard[idx].p.map; }
+
+STC_INLINE void _c_MEMB(_read_unlock)(i_type* self, intptr_t idx)
+    { chmap_rdunlock(&self->_shard[idx].p.lock); }
+
+STC_INLINE _m_shard* _c_MEMB(_write_lock)(i_type* self, intptr_t idx)
+    { chmap_wrlock(&self->_shard[idx].p.lock); return &self->_shard[idx].p.map; }
+
+STC_INLINE void _c_MEMB(_write_unlock)(i_type* self, intptr_t idx)
+    { chmap_wrunlock(&self->_shard[idx].p.lock); }
+
+STC_INLINE bool
+_c_MEMB(_contains)(i_type* self, _m_keyraw rkey) {
+    const uint64_t _hash = i_hash((&rkey));
+    _c_MEMB(_part_)* p = _c_MEMB(_part_of_)(self, _hash);
+    chmap_rdlock(&p->lock);
+    const bool found = p->map.size && !_c_SHARD(_bucket_hashed_)(&p->map, &rkey, _hash).inserted;
+    chmap_rdunlock(&p->lock);
+    return found;
+}
+
+#if !defined i_no_clone
+// Copies (clones) the mapped value to *out, as the entry may be erased once the lock is released.
+STC_INLINE bool
+_c_MEMB(_get)(i_type* self, _m_keyraw rkey, _m_mapped* out) {
+    const uint64_t _hash = i_hash((&rkey));
+    _c_MEMB(_part_)* p = _c_MEMB(_part_of_)(self, _hash);
+    _c_SHARD(_result) b = {NULL, true};
+    chmap_rdlock(&p->lock);
+    if (p->map.size && !(b = _c_SHARD(_bucket_hashed_)(&p->map, &rkey, _hash)).inserted)
+        *out = i_valclone(b.ref->second);
+    chmap_rdunlock(&p->lock);
+    return !b.inserted;
+}
+#endif
+
+STC_INLINE bool
+_c_MEMB(_insert)(i_type* self, _m_key _key, _m_mapped _mapped) {
+    const _m_keyraw _raw = i_keyto((&_key));
+    const uint64_t _hash = i_hash((&_raw));
+    _c_MEMB(_part_)* p = _c_MEMB(_part_of_)(self, _hash);
+    chmap_wrlock(&p->lock);
+    _c_SHARD(_result) _res = _c_SHARD(_insert_hashed_)(&p->map, &_raw, _hash);
+    if (_res.inserted)
+        _res.ref->first = _key, _res.ref->second = _mapped;
+    chmap_wrunlock(&p->lock);
+    if (!_res.inserted)
+        { i_keydrop((&_key)); i_valdrop((&_mapped)); }
+    return _res.inserted;
+}
+
+STC_INLINE bool
+_c_MEMB(_insert_or_assign)(i_type* self, _m_key _key, _m_mapped _mapped) {
+    const _m_keyraw _raw = i_keyto((&_key));
+    const uint64_t _hash = i_hash((&_raw));
+    _c_MEMB(_part_)* p = _c_MEMB(_part_of_)(self, _hash);
+    chmap_wrlock(&p->lock);
+    _c_SHARD(_result) _res = _c_SHARD(_insert_hashed_)(&p->map, &_raw, _hash);
+    if (_res.inserted)
+        _res.ref->first = _key, _res.ref->second = _mapped;
+    else if (_res.ref)
+        c_swap(_m_mapped, &_res.ref->second, &_mapped); // old mapped is dropped after unlock
+    chmap_wrunlock(&p->lock);
+    if (!_res.inserted)
+        { i_keydrop((&_key)); i_valdrop((&_mapped)); }
+    return _res.inserted;
+}
+
+#if !defined i_no_emplace
+STC_INLINE bool
+_c_MEMB(_emplace)(i_type* self, _m_keyraw rkey, _m_rmapped rmapped) {
+    const uint64_t _hash = i_hash((&rkey));
+    _c_MEMB(_part_)* p = _c_MEMB(_part_of_)(self, _hash);
+    chmap_wrlock(&p->lock);
+    _c_SHARD(_result) _res = _c_SHARD(_insert_hashed_)(&p->map, &rkey, _hash);
+    if (_res.inserted) {
+        _res.ref->first = i_keyfrom(rkey);
+        _res.ref->second = i_valfrom(rmapped);
+    }
+    chmap_wrunlock(&p->lock);
+    return _res.inserted;
+}
+#endif
+
+STC_INLINE int
+_c_MEMB(_erase)(i_type* self, _m_keyraw rkey) {
+    const uint64_t _hash = i_hash((&rkey));
+    _c_MEMB(_part_)* p = _c_MEMB(_part_of_)(self, _hash);
+    _c_SHARD(_result) b = {NULL, true};
+    chmap_wrlock(&p->lock);
+    if (p->map.size && !(b = _c_SHARD(_bucket_hashed_)(&p->map, &rkey, _hash)).inserted)
+        _c_SHARD(_erase_entry)(&p->map, b.ref);
+    chmap_wrunlock(&p->lock);
+    return !b.inserted;
+}
+
+/* -------------------------- IMPLEMENTATION ------------------------- */
+#if defined(i_implement) || defined(i_static)
+
+STC_DEF void _c_MEMB(_init)(i_type* self) {
+    c_memset(self, 0, c_sizeof *self);
+    c_forrange (i, i_shards)
+        chmap_rwlock_init(&self->_shard[i].p.lock);
+}
+
+STC_DEF void _c_MEMB(_drop)(i_type* self) {
+    c_forrange (i, i_shards) {
+        _c_SHARD(_drop)(&self->_shard[i].p.map);
+        chmap_rwlock_destroy(&self->_shard[i].p.lock);
+    }
+}
+
+STC_DEF void _c_MEMB(_clear)(i_type* self) {
+    c_forrange (i, i_shards) {
+        _c_MEMB(_part_)* p = &self->_shard[i].p;
+        chmap_wrlock(&p->lock);
+        _c_SHARD(_clear)(&p->map);
+        chmap_wrunlock(&p->lock);
+    }
+}
+
+STC_DEF intptr_t _c_MEMB(_size)(i_type* self) {
+    intptr_t n = 0;
+    c_forrange (i, i_shards) {
+        _c_MEMB(_part_)* p = &self->_shard[i].p;
+        chmap_rdlock(&p->lock);
+        n += p->map.size;
+        chmap_rdunlock(&p->lock);
+    }
+    return n;
+}
+
+STC_DEF bool _c_MEMB(_reserve)(i_type* self, const intptr_t capacity) {
+    bool ok = true;
+    c_forrange (i, i_shards) {
+        _c_MEMB(_part_)* p = &self->_shard[i].p;
+        chmap_wrlock(&p->lock);
+        ok &= _c_SHARD(_reserve)(&p->map, capacity/(i_shards) + 1);
+        chmap_wrunlock(&p->lock);
+    }
+    return ok;
+}
+#endif // i_implement
+#undef _i_chtype
+#undef _i_chstatic
+#undef _i_chheader
+#undef _i_chimplement
+#undef _i_chimport
+#undef _i_chcompact
+#undef _m_shard
+#undef _c_SHARD
+#undef i_shards
+#include "priv/template2.h"
+#include "priv/linkage2.h"
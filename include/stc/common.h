@@ -127,24 +127,85 @@ typedef const char* ccharptr;
 #define ccharptr_clone(s) (s)
 #define ccharptr_drop(p) ((void)p)
 
+#define c_hash_version 2 // incremented when the built-in hash functions change
+
 #define c_ROTL(x, k) (x << (k) | x >> (8*sizeof(x) - (k)))
 
+#if defined(__SIZEOF_INT128__)
+    #define c_umul128(a, b, lo, hi) \
+        do { __uint128_t _z = (__uint128_t)(a)*(b); \
+             *(lo) = (uint64_t)_z, *(hi) = (uint64_t)(_z >> 64U); } while(0)
+#elif defined(_MSC_VER) && defined(_WIN64)
+    #include <intrin.h>
+    #define c_umul128(a, b, lo, hi) ((void)(*(lo) = _umul128(a, b, hi)))
+#elif defined(__x86_64__)
+    #define c_umul128(a, b, lo, hi) \
+        asm("mulq %3" : "=a"(*(lo)), "=d"(*(hi)) : "a"(a), "rm"(b))
+#endif
+
+// 64x64 => 128 bit multiply: *a = low, *b = high 64 bits.
+STC_INLINE void _c_hash_mul(uint64_t* a, uint64_t* b) {
+#ifdef c_umul128
+    const uint64_t _x = *a, _y = *b;
+    c_umul128(_x, _y, a, b);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha*hb, rm0 = ha*lb, rm1 = hb*la, rl = la*lb, t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo, *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+// Multiply and fold: the high bits of the product mix into the low bits.
+STC_INLINE uint64_t _c_hash_mum(uint64_t a, uint64_t b)
+    { _c_hash_mul(&a, &b); return a ^ b; }
+
+STC_INLINE uint64_t _c_hash_r8(const uint8_t* p) { uint64_t u; memcpy(&u, p, 8); return u; }
+STC_INLINE uint64_t _c_hash_r4(const uint8_t* p) { uint32_t u; memcpy(&u, p, 4); return u; }
+
+// wyhash (final4) with seed 0: 48 bytes per step in three independent lanes. Keys up to 16 bytes
+// and the tail are read as two overlapping words, so there are no byte loops. 4 and 8 byte keys
+// take one folded multiply, as in ankerl::unordered_dense: good bucket spread, weaker avalanche.
 STC_INLINE uint64_t c_hash_n(const void* key, intptr_t len) {
-    uint32_t u4; uint64_t u8;
-    switch (len) {
-        case 8: memcpy(&u8, key, 8); return u8*0xc6a4a7935bd1e99d;
-        case 4: memcpy(&u4, key, 4); return u4*0xc6a4a7935bd1e99d;
-        case 0: return 1;
+    static const uint64_t s[4] = {0x2d358dccaa6c78a5, 0x8bb84b93962eacc9,
+                                  0x4b33a62ed433d4a3, 0x4d5a2da51de1aa47};
+    const uint8_t *p = (const uint8_t*)key;
+    uint64_t a, b, seed = 0xca813bf4c7abf0a9; // _c_hash_mum(s[0], s[1])
+    switch (len) { // integral keys: a single multiply, folded
+        case 8: return _c_hash_mum(_c_hash_r8(p), 0x9e3779b97f4a7c15);
+        case 4: return _c_hash_mum(_c_hash_r4(p), 0x9e3779b97f4a7c15);
     }
-    const uint8_t *x = (const uint8_t*)key;
-    uint64_t h = (uint64_t)*x << 7, n = (uint64_t)len >> 3;
-    len &= 7;
-    while (n--) {
-        memcpy(&u8, x, 8), x += 8;
-        h = (h ^ u8)*0xc6a4a7935bd1e99d;
+    if (len <= 16) {
+        if (len >= 4) {
+            const intptr_t m = (len >> 3) << 2;
+            a = _c_hash_r4(p) << 32 | _c_hash_r4(p + m);
+            b = _c_hash_r4(p + len - 4) << 32 | _c_hash_r4(p + len - 4 - m);
+        } else if (len > 0) {
+            a = (uint64_t)p[0] << 16 | (uint64_t)p[len >> 1] << 8 | p[len - 1];
+            b = 0;
+        } else
+            a = b = 0;
+    } else {
+        intptr_t i = len;
+        if (i >= 48) {
+            uint64_t seed1 = seed, seed2 = seed;
+            do {
+                seed = _c_hash_mum(_c_hash_r8(p) ^ s[1], _c_hash_r8(p + 8) ^ seed);
+                seed1 = _c_hash_mum(_c_hash_r8(p + 16) ^ s[2], _c_hash_r8(p + 24) ^ seed1);
+                seed2 = _c_hash_mum(_c_hash_r8(p + 32) ^ s[3], _c_hash_r8(p + 40) ^ seed2);
+                p += 48, i -= 48;
+            } while (i >= 48);
+            seed ^= seed1 ^ seed2;
+        }
+        for (; i > 16; i -= 16, p += 16)
+            seed = _c_hash_mum(_c_hash_r8(p) ^ s[1], _c_hash_r8(p + 8) ^ seed);
+        a = _c_hash_r8(p + i - 16);
+        b = _c_hash_r8(p + i - 8);
     }
-    while (len--) h = (h ^ *x++)*0x100000001b3;
-    return h ^ c_ROTL(h, 26);
+    a ^= s[1], b ^= seed;
+    _c_hash_mul(&a, &b);
+    return _c_hash_mum(a ^ s[0] ^ (uint64_t)len, b ^ s[1]);
 }
 
 #define c_hash_pod(pod) c_hash_n(pod, sizeof *(pod))
@@ -198,6 +259,9 @@ STC_INLINE intptr_t c_next_pow2(intptr_t n) {
     for (C##_iter _start = C##_begin(&cnt), it = {.ref=_start.ref ? _start.end - 1 : NULL, .end=_start.ref - 1} \
          ; it.ref ; --it.ref == it.end ? it.ref = NULL : NULL)
 
+#define c_foreach_reverse(it, C, cnt) /* with C_rbegin() and C_prev(): smap, sset with i_parent */ \
+    for (C##_iter it = C##_rbegin(&cnt); it.ref; C##_prev(&it))
+
 #define c_foreach_n(it, C, cnt, N) /* iterate up to N items */ \
     for (struct {C##_iter iter; C##_value* ref; intptr_t index, n;} it = {.iter=C##_begin(&cnt), .n=N} \
          ; (it.ref = it.iter.ref) && it.index < it.n; C##_next(&it.iter), ++it.index)
@@ -256,16 +320,13 @@ STC_INLINE intptr_t c_next_pow2(intptr_t n) {
 #define c_drop(C, ...) \
     do { c_forlist (_i, C*, {__VA_ARGS__}) C##_drop(*_i.ref); } while(0)
 
-#if defined(__SIZEOF_INT128__)
-    #define c_umul128(a, b, lo, hi) \
-        do { __uint128_t _z = (__uint128_t)(a)*(b); \
-             *(lo) = (uint64_t)_z, *(hi) = (uint64_t)(_z >> 64U); } while(0)
-#elif defined(_MSC_VER) && defined(_WIN64)
+#if defined __GNUC__ || defined __clang__
+    #define c_prefetch(p) __builtin_prefetch(p)
+#elif defined _MSC_VER && (defined _M_X64 || defined _M_IX86)
     #include <intrin.h>
-    #define c_umul128(a, b, lo, hi) ((void)(*(lo) = _umul128(a, b, hi)))
-#elif defined(__x86_64__)
-    #define c_umul128(a, b, lo, hi) \
-        asm("mulq %3" : "=a"(*(lo)), "=d"(*(hi)) : "a"(a), "rm"(b))
+    #define c_prefetch(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+    #define c_prefetch(p) ((void)(p))
 #endif
 
 #endif // STC_COMMON_H_INCLUDED
@@ -127,6 +127,10 @@ _c_MEMB(_get_mut)(i_type* self, _m_raw raw)
     { return (_m_value *) _c_MEMB(_get)(self, raw); }
 #endif
 
+#if defined _i_has_cmp
+STC_API void _c_MEMB(_sort)(i_type* self);
+#endif
+
 /* -------------------------- IMPLEMENTATION ------------------------- */
 #if defined(i_implement) || defined(i_static)
 
@@ -202,6 +206,34 @@ _c_MEMB(_find_in)(_m_iter i1, _m_iter i2, _m_raw raw) {
     return i1;
 }
 #endif
+
+#if defined _i_has_cmp
+#include "priv/sort_prv.h"
+
+static void
+_c_MEMB(_reverse_n_)(_m_value* p, intptr_t n) {
+    for (_m_value* q = p + n - 1; p < q; ++p, --q)
+        c_swap(_m_value, p, q);
+}
+
+// Make the elements contiguous if they wrap around the end of the buffer, and sort them in place.
+STC_DEF void
+_c_MEMB(_sort)(i_type* self) {
+    const intptr_t len = _c_MEMB(_size)(self), head = self->capmask + 1 - self->start;
+    if (len < 2)
+        return;
+    if (self->start > self->end && self->end) { // buffer: [tail | free | head] => [free | head tail]
+        _m_value* d = self->cbuf + self->start - self->end;
+        c_memmove(d, self->cbuf, self->end*c_sizeof *d);
+        _c_MEMB(_reverse_n_)(d, self->end);
+        _c_MEMB(_reverse_n_)(d + self->end, head);
+        _c_MEMB(_reverse_n_)(d, len);
+        self->start -= self->end;
+        self->end = 0;
+    }
+    _c_MEMB(_sort_n_)(self->cbuf + self->start, len);
+}
+#endif
 #endif // IMPLEMENTATION
 #include "priv/template2.h"
 #include "priv/linkage2.h"
@@ -0,0 +1,348 @@
+/* MIT License
+ *
+ * Copyright (c) 2023 Tyge Løvset
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Frozen (read-only) map - minimal perfect hashing with one pilot per bucket of keys (PTHash style).
+// Elements are pushed, then freeze() places them in a contiguous array: lookups probe one element.
+/*
+#include <stdio.h>
+#define i_TYPE Fmap,int,int
+#include "stc/fmap.h"
+
+int main(void) {
+    Fmap m = {0};
+    c_forrange (i, 100)
+        Fmap_insert(&m, (int)i*i, (int)i);
+    Fmap_freeze(&m);
+
+    const Fmap_value* v = Fmap_get(&m, 49); // {49, 7}
+    printf("%d: %d\n", v->first, v->second);
+    Fmap_drop(&m);
+}
+*/
+#include "priv/linkage.h"
+
+#ifndef STC_FMAP_H_INCLUDED
+#define STC_FMAP_H_INCLUDED
+#include "common.h"
+#include "types.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct { uint64_t hash; intptr_t idx; } _fmap_entry;
+
+STC_INLINE uint64_t _fmap_mix(uint64_t x) { // murmur3 finalizer
+    x ^= x >> 33; x *= 0xff51afd7ed558ccd;
+    x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53;
+    return x ^ (x >> 33);
+}
+
+STC_INLINE intptr_t _fmap_bucket(uint64_t hash, intptr_t nbuckets)
+    { return (intptr_t)(((hash >> 32)*(uint64_t)nbuckets) >> 32); }
+
+// The bucket is given by the high 32 hash bits. The position mixes in the bucket's (hashed) pilot
+// with a multiply by the odd high bits, so keys in a bucket never collide for all pilots.
+STC_INLINE intptr_t _fmap_pos(uint64_t hash, uint32_t hpilot, intptr_t n)
+    { return (intptr_t)((((uint32_t)hash ^ (uint32_t)((hash >> 32 | 1)*hpilot))*(uint64_t)n) >> 32); }
+
+STC_INLINE int _fmap_entry_cmp(const void* x, const void* y) {
+    const _fmap_entry *a = (const _fmap_entry*)x, *b = (const _fmap_entry*)y;
+    if (a->hash != b->hash) return a->hash < b->hash ? -1 : 1;
+    return (a->idx > b->idx) - (a->idx < b->idx);
+}
+#endif // STC_FMAP_H_INCLUDED
+
+#ifndef _i_prefix
+  #define _i_prefix fmap_
+#endif
+#define _i_ismap
+#define _i_ishash
+#include "priv/template.h"
+#ifndef i_is_forward
+  _c_DEFTYPES(_c_fmap_types, i_type, i_key, i_val);
+#endif
+
+struct _m_value {
+    _m_key first;
+    _m_mapped second;
+};
+
+typedef i_keyraw _m_keyraw;
+typedef i_valraw _m_rmapped;
+typedef struct { _m_keyraw first; _m_rmapped second; } _m_raw;
+
+STC_API void            _c_MEMB(_drop)(const i_type* cself);
+STC_API void            _c_MEMB(_clear)(i_type* self);
+STC_API bool            _c_MEMB(_reserve)(i_type* self, intptr_t cap);
+STC_API bool            _c_MEMB(_freeze)(i_type* self);
+#if !defined i_no_clone
+STC_API i_type          _c_MEMB(_clone)(i_type map);
+#endif
+
+STC_INLINE i_type       _c_MEMB(_init)(void) { i_type map = {0}; return map; }
+STC_INLINE intptr_t     _c_MEMB(_size)(const i_type* map) { return map->size; }
+STC_INLINE bool         _c_MEMB(_empty)(const i_type* map) { return !map->size; }
+STC_INLINE intptr_t     _c_MEMB(_bucket_count)(const i_type* map) { return map->bucket_count; }
+STC_INLINE bool         _c_MEMB(_is_frozen)(const i_type* map) { return map->pilot || !map->size; }
+
+STC_INLINE void _c_MEMB(_value_drop)(_m_value* _val) {
+    i_keydrop((&_val->first));
+    i_valdrop((&_val->second));
+}
+
+STC_INLINE void _c_MEMB(_thaw_)(i_type* self) {
+    if (self->pilot) {
+        i_free(self->pilot, self->bucket_count*c_sizeof *self->pilot);
+        self->pilot = NULL, self->bucket_count = 0;
+    }
+}
+
+// Adding elements unfreezes the map. Duplicate keys are removed by freeze(), the first added is kept.
+STC_INLINE _m_value* _c_MEMB(_push)(i_type* self, _m_value _val) {
+    _c_MEMB(_thaw_)(self);
+    if (self->size == self->capacity)
+        if (!_c_MEMB(_reserve)(self, self->size*2 + 4))
+            return NULL;
+    _m_value* v = self->data + self->size++;
+    *v = _val;
+    return v;
+}
+
+STC_INLINE _m_value* _c_MEMB(_insert)(i_type* self, _m_key _key, _m_mapped _mapped) {
+    _m_value _val = {_key, _mapped};
+    return _c_MEMB(_push)(self, _val);
+}
+
+#if !defined i_no_emplace
+STC_INLINE _m_value* _c_MEMB(_emplace)(i_type* self, _m_keyraw rkey, _m_rmapped rmapped) {
+    _m_value _val = {i_keyfrom(rkey), i_valfrom(rmapped)};
+    return _c_MEMB(_push)(self, _val);
+}
+#endif
+
+STC_INLINE void _c_MEMB(_put_n)(i_type* self, const _m_raw* raw, intptr_t n) {
+    while (n--)
+#if defined i_no_emplace
+        _c_MEMB(_insert)(self, raw->first, raw->second), ++raw;
+#else
+        _c_MEMB(_emplace)(self, raw->first, raw->second), ++raw;
+#endif
+}
+
+STC_INLINE i_type _c_MEMB(_from_n)(const _m_raw* raw, intptr_t n) {
+    i_type cx = {0};
+    _c_MEMB(_reserve)(&cx, n);
+    _c_MEMB(_put_n)(&cx, raw, n);
+    _c_MEMB(_freeze)(&cx);
+    return cx;
+}
+
+// Lookups require a frozen map: exactly one element is examined.
+STC_INLINE const _m_value*
+_c_MEMB(_get)(const i_type* self, _m_keyraw rkey) {
+    c_assert(_c_MEMB(_is_frozen)(self));
+    if (!self->bucket_count)
+        return NULL;
+    const uint64_t _hash = _fmap_mix(i_hash((&rkey)));
+    const uint32_t _pilot = self->pilot[_fmap_bucket(_hash, self->bucket_count)];
+    const _m_value* _v = self->data + _fmap_pos(_hash, _pilot, self->size);
+    const _m_keyraw _raw = i_keyto((&_v->first));
+    return i_eq((&_raw), (&rkey)) ? _v : NULL;
+}
+
+STC_INLINE _m_value*
+_c_MEMB(_get_mut)(i_type* self, _m_keyraw rkey)
+    { return (_m_value*)_c_MEMB(_get)(self, rkey); }
+
+STC_INLINE bool
+_c_MEMB(_contains)(const i_type* self, _m_keyraw rkey)
+    { return _c_MEMB(_get)(self, rkey) != NULL; }
+
+STC_INLINE const _m_mapped*
+_c_MEMB(_at)(const i_type* self, _m_keyraw rkey) {
+    const _m_value* _v = _c_MEMB(_get)(self, rkey);
+    c_assert(_v != NULL);
+    return &_v->second;
+}
+
+STC_INLINE _m_iter _c_MEMB(_begin)(const i_type* self) {
+    _m_value* d = (_m_value*)self->data;
+    return c_LITERAL(_m_iter){self->size ? d : NULL, d + self->size};
+}
+
+STC_INLINE _m_iter _c_MEMB(_end)(const i_type* self)
+    { (void)self; return c_LITERAL(_m_iter){NULL}; }
+
+STC_INLINE void _c_MEMB(_next)(_m_iter* it)
+    { if (++it->ref == it->end) it->ref = NULL; }
+
+/* -------------------------- IMPLEMENTATION ------------------------- */
+#if defined(i_implement) || defined(i_static)
+
+STC_DEF void _c_MEMB(_clear)(i_type* self) {
+    for (intptr_t i = 0; i < self->size; ++i)
+        _c_MEMB(_value_drop)(self->data + i);
+    _c_MEMB(_thaw_)(self);
+    self->size = 0;
+}
+
+STC_DEF void _c_MEMB(_drop)(const i_type* cself) {
+    i_type* self = (i_type*)cself;
+    _c_MEMB(_clear)(self);
+    i_free(self->data, self->capacity*c_sizeof *self->data);
+}
+
+STC_DEF bool _c_MEMB(_reserve)(i_type* self, const intptr_t cap) {
+    if (cap > self->capacity) {
+        _m_value* d = (_m_value*)i_realloc(self->data, self->capacity*c_sizeof *d,
+                                                       cap*c_sizeof *d);
+        if (!d)
+            return false;
+        self->data = d;
+        self->capacity = cap;
+    }
+    return true;
+}
+
+#if !defined i_no_clone
+STC_DEF i_type _c_MEMB(_clone)(i_type map) {
+    i_type out = {0};
+    if (!_c_MEMB(_reserve)(&out, map.size))
+        return out;
+    out.pilot = map.bucket_count ? (uint32_t*)i_malloc(map.bucket_count*c_sizeof *map.pilot) : NULL;
+    if (out.pilot) {
+        c_memcpy(out.pilot, map.pilot, map.bucket_count*c_sizeof *map.pilot);
+        out.bucket_count = map.bucket_count;
+    }
+    for (; out.size < map.size; ++out.size) {
+        out.data[out.size].first = i_keyclone(map.data[out.size].first);
+        out.data[out.size].second = i_valclone(map.data[out.size].second);
+    }
+    return out;
+}
+#endif
+
+// Build the minimal perfect hash. Keys are hashed and sorted, which groups them into buckets of
+// avg. 3 keys. Largest buckets first, each bucket gets the first pilot value that maps all its
+// keys to free slots. Finally, the elements are moved to their slots.
+STC_DEF bool _c_MEMB(_freeze)(i_type* self) {
+    if (self->pilot || !self->size)
+        return true;
+    const intptr_t n0 = self->size;
+    intptr_t n, nb, i, j, maxlen = 0;
+    _fmap_entry* e = (_fmap_entry*)i_malloc(n0*c_sizeof *e);
+    if (!e) return false;
+    for (i = 0; i < n0; ++i) {
+        const _m_keyraw _raw = i_keyto((&self->data[i].first));
+        e[i].hash = _fmap_mix(i_hash((&_raw)));
+        e[i].idx = i;
+    }
+    qsort(e, (size_t)n0, sizeof *e, _fmap_entry_cmp);
+
+    // Remove duplicate keys. Fails if two different keys have the same 64-bit hash.
+    bool ok = true;
+    for (i = n = 0; i < n0; ++i) {
+        if (n && e[i].hash == e[n - 1].hash) {
+            const _m_keyraw _ra = i_keyto((&self->data[e[n - 1].idx].first));
+            const _m_keyraw _rb = i_keyto((&self->data[e[i].idx].first));
+            if (!(i_eq((&_ra), (&_rb)))) { ok = false; break; }
+            continue;
+        }
+        e[n++] = e[i];
+    }
+    nb = n/3 + 1;
+    uint32_t* pilot = (uint32_t*)i_calloc(nb, c_sizeof *pilot);
+    intptr_t* bstart = (intptr_t*)i_malloc((nb + 1)*c_sizeof *bstart);
+    intptr_t* order = (intptr_t*)i_malloc(nb*c_sizeof *order);
+    const intptr_t nwords = (n0 + 63)/64;
+    uint64_t* taken = (uint64_t*)i_calloc(nwords, c_sizeof *taken);
+    _m_value* data = (_m_value*)i_malloc(n*c_sizeof *data);
+    ok = ok && pilot && bstart && order && taken && data;
+    if (ok) {
+        // Sorted hashes => buckets are contiguous runs. Order buckets by size, largest first.
+        for (i = 0, j = 0; i < nb; ++i) {
+            bstart[i] = j;
+            while (j < n && _fmap_bucket(e[j].hash, nb) == i) ++j;
+            if (j - bstart[i] > maxlen) maxlen = j - bstart[i];
+        }
+        bstart[nb] = n;
+        intptr_t nused = 0; // non-empty buckets
+        for (intptr_t len = maxlen; len > 0; --len)
+            for (i = 0; i < nb; ++i)
+                if (bstart[i + 1] - bstart[i] == len) order[nused++] = i;
+
+        // Keys of a bucket with the same low 32 bits and the same odd high bits (hash >> 32 | 1)
+        // collide for every pilot. Fails on these, and when no pilot is found in 2^32 tries.
+        for (intptr_t k = 0; ok && k < nused; ++k) {
+            const intptr_t b = order[k], s = bstart[b], len = bstart[b + 1] - s;
+            for (i = 1; ok && i < len; ++i)
+                for (j = 0; j < i; ++j)
+                    if ((e[s + i].hash | (uint64_t)1 << 32) == (e[s + j].hash | (uint64_t)1 << 32))
+                        { ok = false; break; }
+            for (uint64_t p = 0; ok; ++p) {
+                if (p == (uint64_t)1 << 32)
+                    { ok = false; break; }
+                const uint32_t hp = (uint32_t)(_fmap_mix(p) >> 32);
+                for (i = 0; i < len; ++i) {
+                    const intptr_t pos = _fmap_pos(e[s + i].hash, hp, n);
+                    if (taken[pos >> 6] >> (pos & 63) & 1) break;
+                    taken[pos >> 6] |= (uint64_t)1 << (pos & 63);
+                }
+                if (i == len) {
+                    pilot[b] = hp;
+                    break;
+                }
+                while (i--) { // undo
+                    const intptr_t pos = _fmap_pos(e[s + i].hash, hp, n);
+                    taken[pos >> 6] &= ~((uint64_t)1 << (pos & 63));
+                }
+            }
+        }
+    }
+    if (ok) {
+        if (n < n0) { // drop the duplicates: mark kept elements, then sweep.
+            c_memset(taken, 0, nwords*c_sizeof *taken);
+            for (i = 0; i < n; ++i) taken[e[i].idx >> 6] |= (uint64_t)1 << (e[i].idx & 63);
+            for (i = 0; i < n0; ++i)
+                if (!(taken[i >> 6] >> (i & 63) & 1)) _c_MEMB(_value_drop)(self->data + i);
+        }
+        for (i = 0; i < n; ++i) // move elements into their slots
+            data[_fmap_pos(e[i].hash, pilot[_fmap_bucket(e[i].hash, nb)], n)] = self->data[e[i].idx];
+
+        i_free(self->data, self->capacity*c_sizeof *self->data);
+        self->data = data, self->capacity = self->size = n;
+        self->pilot = pilot, self->bucket_count = nb;
+        data = NULL, pilot = NULL;
+    }
+    if (data) i_free(data, n*c_sizeof *data);
+    if (pilot) i_free(pilot, nb*c_sizeof *pilot);
+    if (taken) i_free(taken, nwords*c_sizeof *taken);
+    if (order) i_free(order, nb*c_sizeof *order);
+    if (bstart) i_free(bstart, (nb + 1)*c_sizeof *bstart);
+    i_free(e, n0*c_sizeof *e);
+    return ok;
+}
+#endif // i_implement
+#undef _i_ismap
+#undef _i_ishash
+#include "priv/template2.h"
+#include "priv/linkage2.h"
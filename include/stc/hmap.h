@@ -52,11 +52,136 @@ int main(void) {
 #define STC_HMAP_H_INCLUDED
 #include "common.h"
 #include "types.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 struct hmap_slot { uint8_t hashx; };
+#define hmap_BATCH 32 // keys hashed and prefetched ahead in the _n batch functions
+
+// File format of hmap_X_write(): the header, followed by the slot array and the table,
+// each at a 64-byte aligned offset. Loaded read-only by hmap_X_map_view() without copying.
+typedef struct {
+    uint32_t magic, version;        // magic is also the byte order mark
+    uint32_t key_size, value_size;
+    uint32_t slot_pad, flags;       // extra slots after bucket_count; flags: 1 = i_store_hash, 2 = i_robinhood,
+                                    // 4 = i_compact
+    uint64_t hash_id;               // i_hash_id, or derived from the i_hash name
+    int64_t size, bucket_count;
+    int64_t slot_offset, table_offset;
+} hmap_file_header;
+#define hmap_FILE_MAGIC 0x48435453 // "STCH"
+#define hmap_FILE_VERSION 2 // 2: tags of power of 2 tables mix in the top hash bits
+#define _hmap_stringify(x) #x
+#define _hmap_xstringify(x) _hmap_stringify(x)
+
+// hmap_X_stats(): computed by a scan of the table. Probe lengths count the buckets examined.
+enum {hmap_STATS_BINS = 12};
+typedef struct {
+    intptr_t size, bucket_count;
+    double load_factor;
+    intptr_t probe_hist[hmap_STATS_BINS]; // present keys, bin k: probe length in [2^k, 2^(k+1)), last: above
+    intptr_t max_probe;             // longest probe length of a present key
+    intptr_t longest_cluster;       // longest run of occupied buckets
+    double hit_cost;                // mean probe length of present keys
+    double miss_cost;               // mean probe length of missing keys, over all home buckets
+    double tag_collisions;          // mean tag matches with other keys, per lookup of a present key
+    hmap_counters counters;         // zero unless i_stats
+} hmap_stats;
+
+STC_INLINE uint64_t _hmap_name_id(const char* name) { // FNV-1a: independent of c_hash_n()
+    uint64_t h = 0xcbf29ce484222325;
+    while (*name) h = (h ^ (uint8_t)*name++)*0x100000001b3;
+    return h ^ c_hash_version;
+}
 #endif // STC_HMAP_H_INCLUDED
 
+// i_simd: probe 16 (SSE2) or 32 (AVX2) slots per step. Scalar probing if unavailable or i_robinhood.
+#if defined i_simd && !defined i_robinhood && (defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2))
+  #define _i_simd
+  #ifndef STC_HMAP_SIMD_INCLUDED
+  #define STC_HMAP_SIMD_INCLUDED
+  #if defined __AVX2__
+    #include <immintrin.h>
+    #define hmap_GROUP 32
+  #else
+    #include <emmintrin.h>
+    #define hmap_GROUP 16
+  #endif
+  #if defined _MSC_VER && !defined __clang__
+    #include <intrin.h>
+    STC_INLINE int _hmap_ctz(uint32_t x) { unsigned long i; _BitScanForward(&i, x); return (int)i; }
+  #else
+    #define _hmap_ctz(x) __builtin_ctz(x)
+  #endif
+
+  // Returns bitmask of slots in group matching tag, and sets *empty to bitmask of empty slots.
+  STC_INLINE uint32_t _hmap_group_scan(const struct hmap_slot* s, uint8_t tag, uint32_t* empty) {
+  #if hmap_GROUP == 32
+    const __m256i g = _mm256_loadu_si256((const __m256i*)s);
+    *empty = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(g, _mm256_setzero_si256()));
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(g, _mm256_set1_epi8((char)tag)));
+  #else
+    const __m128i g = _mm_loadu_si128((const __m128i*)s);
+    *empty = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_setzero_si128()));
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)tag)));
+  #endif
+  }
+  #endif // STC_HMAP_SIMD_INCLUDED
+  #define _i_slots(n) ((n) + hmap_GROUP) // group loads may read past last bucket
+#else
+  #define _i_slots(n) ((n) + 1) // includes end sentinel
+#endif
+// i_store_hash: keep the low 32 bits of each hash in an array after the slots, so that
+// resize and erase never re-hash keys. Limits the table to 2^32 buckets.
+#ifdef i_store_hash
+  #define _i_hashpos(n) ((_i_slots(n) + 3) & ~(intptr_t)3)
+  #define _i_hashes(s, n) ((uint32_t*)((s) + _i_hashpos(n)))
+  #define _i_distpos(n) (_i_hashpos(n) + (n)*c_sizeof(uint32_t))
+#else
+  #define _i_distpos(n) _i_slots(n)
+#endif
+// i_robinhood: keep each entry's probe distance in a byte array after the slots (and hashes).
+// Entries in a cluster are ordered by home bucket: lookups of missing keys stop at the first entry
+// closer to its home than the probe, and erase shifts back only displaced entries. Saturates at 255.
+#ifdef i_robinhood
+  #define _i_dists(s, n) ((uint8_t*)((s) + _i_distpos(n)))
+  #define _i_slotbytes(n) (_i_distpos(n)*c_sizeof(struct hmap_slot) + (n))
+#else
+  #define _i_slotbytes(n) (_i_distpos(n)*c_sizeof(struct hmap_slot))
+#endif
+// i_stats: count probes, i_eq calls and resizes in the map. Lookups update the counters of a const map.
+// The counters are not atomic: a map with i_stats is not safe for concurrent lookups.
+#ifdef i_stats
+  #define _i_counters(self) ((hmap_counters*)&(self)->_counters)
+  #define _i_count(cnt, field) ((cnt)->field += 1)
+  #define _i_STATS c_true
+#else
+  #define _i_counters(self) ((hmap_counters*)NULL)
+  #define _i_count(cnt, field) ((void)(cnt))
+  #define _i_STATS c_false
+#endif
+// i_compact: any bucket count, not only powers of 2, so that the table size stays close to
+// size/i_max_load_factor. The bucket is the high 32 bits of the hash scaled to the bucket count
+// (fastrange), and the tag is taken from the low bits. Limits the table to 2^32 buckets.
+// Otherwise the bucket is the low bits of the hash, and the tag mixes in the top bits.
+#ifdef i_compact
+  #define _i_bucket(hash, n) (intptr_t)(((uint64_t)(hash) >> 32)*(uint64_t)(n) >> 32)
+  #define _i_wrap(i, n) ((i) < 0 ? (i) + (n) : (i) >= (n) ? (i) - (n) : (i)) // i in (-n, 2n)
+  #define _i_tag(hash) (uint8_t)((hash) | 0x80)
+  #define _i_hash32(hash) (uint32_t)((uint64_t)(hash) >> 32)
+  #define _i_unhash32(h) ((uint64_t)(h) << 32)
+#else
+  #define _i_bucket(hash, n) fastrange_2(hash, n)
+  #define _i_wrap(i, n) ((i) & ((n) - 1))
+  #define _i_tag(hash) (uint8_t)(((hash) ^ (hash) >> 57) | 0x80)
+  #define _i_hash32(hash) (uint32_t)(hash)
+  #define _i_unhash32(h) ((uint64_t)(h))
+#endif
+// i_incremental: grow by migrating a bounded number of buckets per insert/erase.
+#if defined i_incremental && !defined i_incremental_step
+  #define i_incremental_step 8
+#endif
+
 #ifndef _i_prefix
   #define _i_prefix hmap_
 #endif
@@ -64,19 +189,44 @@ struct hmap_slot { uint8_t hashx; };
   #define _i_ismap
   #define _i_MAP_ONLY c_true
   #define _i_SET_ONLY c_false
-  #define _i_keyref(vp) (&(vp)->first)
 #else
   #define _i_MAP_ONLY c_false
   #define _i_SET_ONLY c_true
+#endif
+// i_soa: store the keys in the table, and the mapped values in an array after the keys, in the same
+// allocation. Probing touches only the slots and keys. _m_value is the key, and _i_mapref(r) is the
+// mapped value of a result or an iterator.
+#if defined i_soa && defined _i_ismap
+  #define _i_soa
+  #define _i_SOA c_true
+  #define _i_PAIR_ONLY c_false
+  #define _i_KEY_ONLY c_true
   #define _i_keyref(vp) (vp)
+  #define _i_mapref(r) ((r).val)
+  #define _i_valpos(n) (((n)*c_sizeof(_m_key) + 63) & ~(intptr_t)63)
+  #define _i_vals(table, n) ((_m_mapped*)((char*)(table) + _i_valpos(n)))
+  #define _i_tablebytes(n) (_i_valpos(n) + (n)*c_sizeof(_m_mapped))
+#else
+  #define _i_SOA c_false
+  #define _i_PAIR_ONLY _i_MAP_ONLY
+  #define _i_KEY_ONLY _i_SET_ONLY
+  #define _i_mapref(r) (&(r).ref->second)
+  #define _i_tablebytes(n) ((n)*c_sizeof(_m_value))
+  #ifdef _i_ismap
+    #define _i_keyref(vp) (&(vp)->first)
+  #else
+    #define _i_keyref(vp) (vp)
+  #endif
 #endif
 #define _i_ishash
 #include "priv/template.h"
-#ifndef i_is_forward
-  _c_DEFTYPES(_c_htable_types, i_type, i_key, i_val, _i_MAP_ONLY, _i_SET_ONLY);
+#if !defined i_is_forward && defined i_incremental
+  _c_DEFTYPES(_c_htable_types_x, i_type, i_key, i_val, _i_PAIR_ONLY, _i_KEY_ONLY, c_true, _i_STATS, _i_SOA);
+#elif !defined i_is_forward
+  _c_DEFTYPES(_c_htable_types_x, i_type, i_key, i_val, _i_PAIR_ONLY, _i_KEY_ONLY, c_false, _i_STATS, _i_SOA);
 #endif
 
-_i_MAP_ONLY( struct _m_value {
+_i_PAIR_ONLY( struct _m_value {
     _m_key first;
     _m_mapped second;
 }; )
@@ -95,11 +245,51 @@ STC_API i_type          _c_MEMB(_clone)(i_type map);
 STC_API void            _c_MEMB(_drop)(const i_type* cself);
 STC_API void            _c_MEMB(_clear)(i_type* self);
 STC_API bool            _c_MEMB(_reserve)(i_type* self, intptr_t capacity);
-STC_API _m_result       _c_MEMB(_bucket_)(const i_type* self, const _m_keyraw* rkeyptr);
-STC_API _m_result       _c_MEMB(_insert_entry_)(i_type* self, _m_keyraw rkey);
+STC_API _m_result       _c_MEMB(_bucket_hashed_)(const i_type* self, const _m_keyraw* rkeyptr, uint64_t hash);
+STC_API _m_result       _c_MEMB(_insert_hashed_)(i_type* self, const _m_keyraw* rkeyptr, uint64_t hash);
 STC_API void            _c_MEMB(_erase_entry)(i_type* self, _m_value* val);
+// Erase the elements for which keep() is false in one pass. Returns the number erased.
+STC_API intptr_t        _c_MEMB(_retain)(i_type* self, bool (*keep)(const _m_value* val
+                                         _i_SOA(, const _m_mapped* mapped), void* ctx), void* ctx);
+// Remove the elements for which take() is true, without dropping them: take() moves them out.
+STC_API intptr_t        _c_MEMB(_drain_if)(i_type* self, bool (*take)(_m_value* val
+                                           _i_SOA(, _m_mapped* mapped), void* ctx), void* ctx);
 STC_API float           _c_MEMB(_max_load_factor)(const i_type* self);
 STC_API intptr_t        _c_MEMB(_capacity)(const i_type* map);
+STC_API hmap_stats      _c_MEMB(_stats)(const i_type* self);
+#ifdef i_stats
+STC_INLINE void         _c_MEMB(_reset_counters)(i_type* self)
+                            { c_memset(&self->_counters, 0, c_sizeof self->_counters); }
+#endif
+#ifdef i_incremental
+STC_API void            _c_MEMB(_migrate_)(i_type* self, intptr_t nbuckets);
+
+STC_INLINE bool _c_MEMB(_in_old_)(const i_type* self, const _m_value* ref) {
+    return self->_old.table && ref >= self->_old.table
+                            && ref < self->_old.table + self->_old.bucket_count;
+}
+#endif
+
+STC_API intptr_t        _c_MEMB(_get_n)(const i_type* self, const _m_keyraw rkeys[], intptr_t n,
+                                        const _m_value* out[]);
+STC_API intptr_t        _c_MEMB(_contains_n)(const i_type* self, const _m_keyraw rkeys[], intptr_t n,
+                                             bool out[]);
+STC_API intptr_t        _c_MEMB(_emplace_n)(i_type* self, const _m_raw raw[], intptr_t n);
+
+// Bitwise copyable elements, i.e. no i_keydrop/i_valdrop: cloned by memcpy, and serializable (not with i_soa).
+#if defined _i_trivial_key && (defined _i_isset || defined _i_trivial_val)
+  #define _i_trivial
+  #ifndef _i_soa
+  STC_API bool          _c_MEMB(_write)(const i_type* self, FILE* fp);
+  STC_API bool          _c_MEMB(_map_view)(i_type* view, const void* mem, intptr_t size);
+  #endif
+#endif
+
+STC_INLINE _m_result _c_MEMB(_bucket_)(const i_type* self, const _m_keyraw* rkeyptr)
+    { return _c_MEMB(_bucket_hashed_)(self, rkeyptr, i_hash(rkeyptr)); }
+
+STC_INLINE _m_result _c_MEMB(_insert_entry_)(i_type* self, _m_keyraw rkey)
+    { return _c_MEMB(_insert_hashed_)(self, &rkey, i_hash((&rkey))); }
 
 STC_INLINE i_type       _c_MEMB(_init)(void) { i_type map = {0}; return map; }
 STC_INLINE void         _c_MEMB(_shrink_to_fit)(i_type* self) { _c_MEMB(_reserve)(self, (intptr_t)self->size); }
@@ -119,7 +309,7 @@ STC_INLINE bool         _c_MEMB(_contains)(const i_type* self, _m_keyraw rkey)
     _c_MEMB(_at)(const i_type* self, _m_keyraw rkey) {
         _m_result b = _c_MEMB(_bucket_)(self, &rkey);
         c_assert(!b.inserted);
-        return &b.ref->second;
+        return _i_mapref(b);
     }
 
     STC_INLINE _m_mapped*
@@ -131,6 +321,22 @@ STC_INLINE bool         _c_MEMB(_contains)(const i_type* self, _m_keyraw rkey)
 STC_INLINE void _c_MEMB(_copy)(i_type *self, const i_type* other) {
     if (self->table == other->table)
         return;
+#ifdef _i_trivial
+    // Same bucket count: copy into the existing buffers, which are likely warm in memory.
+    if (self->bucket_count && self->bucket_count == other->bucket_count
+    #ifdef i_incremental
+        && !self->_old.table && !other->_old.table
+    #endif
+    ) {
+        _m_value* t = self->table;
+        struct hmap_slot* s = self->slot;
+        c_memcpy(s, other->slot, _i_slotbytes(other->bucket_count));
+        c_memcpy(t, other->table, _i_tablebytes(other->bucket_count));
+        *self = *other;
+        self->table = t, self->slot = s;
+        return;
+    }
+#endif
     _c_MEMB(_drop)(self);
     *self = _c_MEMB(_clone)(*other);
 }
@@ -138,7 +344,7 @@ STC_INLINE void _c_MEMB(_copy)(i_type *self, const i_type* other) {
 STC_INLINE _m_value
 _c_MEMB(_value_clone)(_m_value _val) {
     *_i_keyref(&_val) = i_keyclone((*_i_keyref(&_val)));
-    _i_MAP_ONLY( _val.second = i_valclone(_val.second); )
+    _i_PAIR_ONLY( _val.second = i_valclone(_val.second); )
     return _val;
 }
 #endif // !i_no_clone
@@ -149,7 +355,7 @@ _c_MEMB(_emplace)(i_type* self, _m_keyraw rkey _i_MAP_ONLY(, _m_rmapped rmapped)
     _m_result _res = _c_MEMB(_insert_entry_)(self, rkey);
     if (_res.inserted) {
         *_i_keyref(_res.ref) = i_keyfrom(rkey);
-        _i_MAP_ONLY( _res.ref->second = i_valfrom(rmapped); )
+        _i_MAP_ONLY( *_i_mapref(_res) = i_valfrom(rmapped); )
     }
     return _res;
 }
@@ -159,32 +365,35 @@ _c_MEMB(_emplace)(i_type* self, _m_keyraw rkey _i_MAP_ONLY(, _m_rmapped rmapped)
     _c_MEMB(_emplace_key)(i_type* self, _m_keyraw rkey) {
         _m_result _res = _c_MEMB(_insert_entry_)(self, rkey);
         if (_res.inserted)
-            _res.ref->first = i_keyfrom(rkey);
+            *_i_keyref(_res.ref) = i_keyfrom(rkey);
         return _res;
     }
 #endif // _i_ismap
 #endif // !i_no_emplace
 
+#ifndef _i_soa
 STC_INLINE _m_raw _c_MEMB(_value_toraw)(const _m_value* val) {
     return _i_SET_ONLY( i_keyto(val) )
            _i_MAP_ONLY( c_LITERAL(_m_raw){i_keyto((&val->first)), i_valto((&val->second))} );
 }
+#endif
 
 STC_INLINE void _c_MEMB(_value_drop)(_m_value* _val) {
     i_keydrop(_i_keyref(_val));
-    _i_MAP_ONLY( i_valdrop((&_val->second)); )
+    _i_PAIR_ONLY( i_valdrop((&_val->second)); )
 }
 
 STC_INLINE _m_result
 _c_MEMB(_insert)(i_type* self, _m_key _key _i_MAP_ONLY(, _m_mapped _mapped)) {
     _m_result _res = _c_MEMB(_insert_entry_)(self, i_keyto((&_key)));
     if (_res.inserted)
-        { *_i_keyref(_res.ref) = _key; _i_MAP_ONLY( _res.ref->second = _mapped; )}
+        { *_i_keyref(_res.ref) = _key; _i_MAP_ONLY( *_i_mapref(_res) = _mapped; )}
     else
         { i_keydrop((&_key)); _i_MAP_ONLY( i_valdrop((&_mapped)); )}
     return _res;
 }
 
+#ifndef _i_soa
 STC_INLINE _m_value* _c_MEMB(_push)(i_type* self, _m_value _val) {
     _m_result _res = _c_MEMB(_insert_entry_)(self, i_keyto(_i_keyref(&_val)));
     if (_res.inserted)
@@ -193,6 +402,7 @@ STC_INLINE _m_value* _c_MEMB(_push)(i_type* self, _m_value _val) {
         _c_MEMB(_value_drop)(&_val);
     return _res.ref;
 }
+#endif
 
 STC_INLINE void _c_MEMB(_put_n)(i_type* self, const _m_raw* raw, intptr_t n) {
     while (n--)
@@ -215,9 +425,42 @@ STC_API _m_iter _c_MEMB(_begin)(const i_type* self);
 STC_INLINE _m_iter _c_MEMB(_end)(const i_type* self)
     { (void)self; return c_LITERAL(_m_iter){NULL}; }
 
+STC_INLINE _m_iter
+_c_MEMB(_iter_at_)(const i_type* self, _m_value* table, struct hmap_slot* slot, intptr_t n, _m_value* ref) {
+    _m_iter it = {ref, table + n, slot + (ref - table)};
+#ifdef i_incremental
+    it._map = self;
+#else
+    (void)self;
+#endif
+#ifdef _i_soa
+    it.val = _i_vals(table, n) + (ref - table);
+#endif
+    return it;
+}
+
+STC_INLINE _m_iter
+_c_MEMB(_begin_at_)(const i_type* self, _m_value* table, struct hmap_slot* slot, intptr_t n) {
+    _m_iter it = _c_MEMB(_iter_at_)(self, table, slot, n, table);
+    if (it._sref)
+        while (it._sref->hashx == 0)
+            ++it.ref, ++it._sref _i_SOA(, ++it.val);
+    if (it.ref == it._end) it.ref = NULL;
+    return it;
+}
+
 STC_INLINE void _c_MEMB(_next)(_m_iter* it) {
-    while ((++it->ref, (++it->_sref)->hashx == 0)) ;
-    if (it->ref == it->_end) it->ref = NULL;
+    while ((++it->ref _i_SOA(, ++it->val), (++it->_sref)->hashx == 0)) ;
+    if (it->ref == it->_end) {
+#ifdef i_incremental
+        const i_type* m = it->_map;
+        if (it->_end != m->table + m->bucket_count) { // done with old table, continue in new
+            *it = _c_MEMB(_begin_at_)(m, m->table, m->slot, m->bucket_count);
+            return;
+        }
+#endif
+        it->ref = NULL;
+    }
 }
 
 STC_INLINE _m_iter _c_MEMB(_advance)(_m_iter it, size_t n) {
@@ -228,10 +471,14 @@ STC_INLINE _m_iter _c_MEMB(_advance)(_m_iter it, size_t n) {
 STC_INLINE _m_iter
 _c_MEMB(_find)(const i_type* self, _m_keyraw rkey) {
     _m_result b;
-    if (self->size && !(b = _c_MEMB(_bucket_)(self, &rkey)).inserted)
-        return c_LITERAL(_m_iter){b.ref,
-                                  self->table + self->bucket_count,
-                                  self->slot + (b.ref - self->table)};
+    if (self->size && !(b = _c_MEMB(_bucket_)(self, &rkey)).inserted) {
+#ifdef i_incremental
+        if (_c_MEMB(_in_old_)(self, b.ref))
+            return _c_MEMB(_iter_at_)(self, self->_old.table, self->_old.slot,
+                                      self->_old.bucket_count, b.ref);
+#endif
+        return _c_MEMB(_iter_at_)(self, self->table, self->slot, self->bucket_count, b.ref);
+    }
     return _c_MEMB(_end)(self);
 }
 
@@ -250,6 +497,10 @@ _c_MEMB(_get_mut)(i_type* self, _m_keyraw rkey)
 STC_INLINE int
 _c_MEMB(_erase)(i_type* self, _m_keyraw rkey) {
     _m_result b;
+#ifdef i_incremental
+    if (self->_old.table)
+        _c_MEMB(_migrate_)(self, i_incremental_step);
+#endif
     if (self->size && !(b = _c_MEMB(_bucket_)(self, &rkey)).inserted)
         { _c_MEMB(_erase_entry)(self, b.ref); return 1; }
     return 0;
@@ -278,15 +529,31 @@ _c_MEMB(_eq)(const i_type* self, const i_type* other) {
 #ifndef i_max_load_factor
   #define i_max_load_factor 0.80f
 #endif
+#ifndef i_growth_factor
+  #ifdef i_compact
+    #define i_growth_factor 1.25f
+  #else
+    #define i_growth_factor 1.5f
+  #endif
+#endif
 #define fastrange_2(x, n) (intptr_t)((x) & (size_t)((n) - 1)) // n power of 2.
 
+// Number of buckets for capacity cap.
+STC_INLINE intptr_t _c_MEMB(_buckets_for_)(const intptr_t cap) {
+    const intptr_t n = (intptr_t)((float)cap / (i_max_load_factor)) + 4;
+#ifdef i_compact
+    return n;
+#else
+    return c_next_pow2(n);
+#endif
+}
+
 STC_DEF _m_iter _c_MEMB(_begin)(const i_type* self) {
-    _m_iter it = {self->table, self->table+self->bucket_count, self->slot};
-    if (it._sref)
-        while (it._sref->hashx == 0)
-            ++it.ref, ++it._sref;
-    if (it.ref == it._end) it.ref = NULL;
-    return it;
+#ifdef i_incremental
+    if (self->_old.size) // visit the table under migration first
+        return _c_MEMB(_begin_at_)(self, self->_old.table, self->_old.slot, self->_old.bucket_count);
+#endif
+    return _c_MEMB(_begin_at_)(self, self->table, self->slot, self->bucket_count);
 }
 
 STC_DEF float _c_MEMB(_max_load_factor)(const i_type* self) {
@@ -306,35 +573,49 @@ STC_DEF i_type _c_MEMB(_with_capacity)(const intptr_t cap) {
 STC_INLINE void _c_MEMB(_wipe_)(i_type* self) {
     if (self->size == 0)
         return;
-    _m_value* d = self->table, *_end = d + self->bucket_count;
-    struct hmap_slot* s = self->slot;
-    for (; d != _end; ++d)
-        if ((s++)->hashx)
-            _c_MEMB(_value_drop)(d);
+    for (_m_iter it = _c_MEMB(_begin)(self); it.ref; _c_MEMB(_next)(&it)) {
+        _c_MEMB(_value_drop)(it.ref);
+        _i_SOA( i_valdrop(it.val); )
+    }
+}
+
+STC_INLINE void _c_MEMB(_free_buckets_)(_m_value* table, struct hmap_slot* slot, intptr_t n) {
+    i_free(slot, _i_slotbytes(n));
+    i_free(table, _i_tablebytes(n));
 }
 
 STC_DEF void _c_MEMB(_drop)(const i_type* cself) {
     i_type* self = (i_type*)cself;
     if (self->bucket_count > 0) {
         _c_MEMB(_wipe_)(self);
-        i_free(self->slot, (self->bucket_count + 1)*c_sizeof *self->slot);
-        i_free(self->table, self->bucket_count*c_sizeof *self->table);
+        _c_MEMB(_free_buckets_)(self->table, self->slot, self->bucket_count);
     }
+#ifdef i_incremental
+    if (self->_old.table)
+        _c_MEMB(_free_buckets_)(self->_old.table, self->_old.slot, self->_old.bucket_count);
+#endif
 }
 
 STC_DEF void _c_MEMB(_clear)(i_type* self) {
     _c_MEMB(_wipe_)(self);
     self->size = 0;
-    c_memset(self->slot, 0, c_sizeof(struct hmap_slot)*self->bucket_count);
+    if (self->bucket_count)
+        c_memset(self->slot, 0, c_sizeof(struct hmap_slot)*self->bucket_count);
+#ifdef i_incremental
+    if (self->_old.table) {
+        _c_MEMB(_free_buckets_)(self->_old.table, self->_old.slot, self->_old.bucket_count);
+        c_memset(&self->_old, 0, c_sizeof self->_old);
+    }
+#endif
 }
 
 #ifdef _i_ismap
     STC_DEF _m_result
     _c_MEMB(_insert_or_assign)(i_type* self, _m_key _key, _m_mapped _mapped) {
         _m_result _res = _c_MEMB(_insert_entry_)(self, i_keyto((&_key)));
-        _m_mapped* _mp = _res.ref ? &_res.ref->second : &_mapped;
+        _m_mapped* _mp = _res.ref ? _i_mapref(_res) : &_mapped;
         if (_res.inserted)
-            _res.ref->first = _key;
+            *_i_keyref(_res.ref) = _key;
         else
             { i_keydrop((&_key)); i_valdrop(_mp); }
         *_mp = _mapped;
@@ -346,84 +627,427 @@ STC_DEF void _c_MEMB(_clear)(i_type* self) {
     _c_MEMB(_emplace_or_assign)(i_type* self, _m_keyraw rkey, _m_rmapped rmapped) {
         _m_result _res = _c_MEMB(_insert_entry_)(self, rkey);
         if (_res.inserted)
-            _res.ref->first = i_keyfrom(rkey);
+            *_i_keyref(_res.ref) = i_keyfrom(rkey);
         else {
             if (!_res.ref) return _res;
-            i_valdrop((&_res.ref->second));
+            i_valdrop(_i_mapref(_res));
         }
-        _res.ref->second = i_valfrom(rmapped);
+        *_i_mapref(_res) = i_valfrom(rmapped);
         return _res;
     }
     #endif // !i_no_emplace
 #endif // _i_ismap
 
-STC_DEF _m_result
-_c_MEMB(_bucket_)(const i_type* self, const _m_keyraw* rkeyptr) {
-    const uint64_t _hash = i_hash(rkeyptr);
-    intptr_t _cap = self->bucket_count;
-    intptr_t _idx = fastrange_2(_hash, _cap);
-    _m_result b = {NULL, true, (uint8_t)(_hash | 0x80)};
-    const struct hmap_slot* s = self->slot;
+// Hash of the occupied bucket i: the stored hash, or re-hashed from the key.
+STC_INLINE uint64_t
+_c_MEMB(_hash_at_)(const _m_value* table, const struct hmap_slot* slot, intptr_t _cap, intptr_t i) {
+#ifdef i_store_hash
+    (void)table; return _i_unhash32(_i_hashes(slot, _cap)[i]);
+#else
+    (void)slot; (void)_cap;
+    const _m_keyraw _raw = i_keyto(_i_keyref(table + i));
+    return i_hash((&_raw));
+#endif
+}
+
+STC_INLINE void
+_c_MEMB(_set_hash_)(struct hmap_slot* slot, intptr_t _cap, intptr_t i, uint64_t hash) {
+#ifdef i_store_hash
+    _i_hashes(slot, _cap)[i] = _i_hash32(hash);
+#else
+    (void)slot; (void)_cap; (void)i; (void)hash;
+#endif
+}
+
+#ifdef i_robinhood
+// Probe distance of the occupied bucket i. Computed from the hash if the stored distance is saturated.
+STC_INLINE intptr_t
+_c_MEMB(_dist_at_)(const _m_value* table, const struct hmap_slot* slot, intptr_t _cap, intptr_t i) {
+    const uint8_t _d = _i_dists(slot, _cap)[i];
+    if (_d < 255) return _d;
+    return _i_wrap(i - _i_bucket(_c_MEMB(_hash_at_)(table, slot, _cap, i), _cap), _cap);
+}
+
+// Shift the entries from bucket i up to the next empty bucket one step forward.
+STC_INLINE void
+_c_MEMB(_make_room_)(_m_value* table, struct hmap_slot* slot, const intptr_t _cap, const intptr_t i) {
+    uint8_t* _dist = _i_dists(slot, _cap);
+    _i_SOA( _m_mapped* _v = _i_vals(table, _cap); )
+    intptr_t j = i, p;
+    while (slot[j].hashx)
+        if (++j == _cap) j = 0;
+    for (; j != i; j = p) {
+        p = (j ? j : _cap) - 1;
+        table[j] = table[p];
+        _i_SOA( _v[j] = _v[p]; )
+        slot[j] = slot[p];
+        _dist[j] = (uint8_t)(_dist[p] + (_dist[p] < 255));
+        #ifdef i_store_hash
+        _i_hashes(slot, _cap)[j] = _i_hashes(slot, _cap)[p];
+        #endif
+    }
+}
+#endif
+
+// Occupy the bucket i found by probing, or by _move_to_().
+STC_INLINE void
+_c_MEMB(_place_)(_m_value* table, struct hmap_slot* slot, const intptr_t _cap, const intptr_t i,
+                 const uint8_t hashx, const uint64_t hash) {
+#ifdef i_robinhood
+    if (slot[i].hashx)
+        _c_MEMB(_make_room_)(table, slot, _cap, i);
+    const intptr_t _d = _i_wrap(i - _i_bucket(hash, _cap), _cap);
+    _i_dists(slot, _cap)[i] = (uint8_t)(_d < 255 ? _d : 255);
+#else
+    (void)table;
+#endif
+    slot[i].hashx = hashx;
+    _c_MEMB(_set_hash_)(slot, _cap, i, hash);
+}
+
+STC_INLINE _m_result
+_c_MEMB(_probe_)(_m_value* table, const struct hmap_slot* s, const intptr_t _cap,
+                 const _m_keyraw* rkeyptr, const uint64_t _hash, hmap_counters* _cnt) {
+    intptr_t _idx = _i_bucket(_hash, _cap);
+    _m_result b = {NULL, true, _i_tag(_hash)};
+    _i_count(_cnt, lookups);
+#ifdef i_store_hash
+    const uint32_t* _h = _i_hashes(s, _cap);
+    #define _i_hashok(i) (_h[i] == _i_hash32(_hash))
+#else
+    #define _i_hashok(i) true
+#endif
+#ifdef _i_simd
+    _i_count(_cnt, probes);
+    if (s[_idx].hashx == b.hashx && _i_hashok(_idx)) { // check home slot first: most hits are resolved here
+        const _m_keyraw _raw = i_keyto(_i_keyref(table + _idx));
+        _i_count(_cnt, eq_calls);
+        if (i_eq((&_raw), rkeyptr)) {
+            b.ref = table + _idx;
+            b.inserted = false;
+            return b;
+        }
+        _i_count(_cnt, eq_fails);
+    } else if (s[_idx].hashx == 0) {
+        b.ref = table + _idx;
+        return b;
+    }
+    for (uint32_t _home = ~1U; ; _home = ~0U) { // the home slot was checked above
+        uint32_t _empty, _match = _hmap_group_scan(s + _idx, b.hashx, &_empty) & _home;
+        _i_count(_cnt, probes);
+        const intptr_t _rem = _cap - _idx;
+        if (_rem < hmap_GROUP) { // mask off slots past the last bucket
+            const uint32_t _lim = ((uint32_t)1 << _rem) - 1;
+            _match &= _lim, _empty &= _lim;
+        }
+        if (_empty) // only candidates before the first empty slot
+            _match &= (_empty & (0U - _empty)) - 1;
+        for (; _match; _match &= _match - 1) {
+            const intptr_t _i = _idx + _hmap_ctz(_match);
+            if (!_i_hashok(_i)) continue;
+            const _m_keyraw _raw = i_keyto(_i_keyref(table + _i));
+            _i_count(_cnt, eq_calls);
+            if (i_eq((&_raw), rkeyptr)) {
+                b.ref = table + _i;
+                b.inserted = false;
+                return b;
+            }
+            _i_count(_cnt, eq_fails);
+        }
+        if (_empty) {
+            b.ref = table + _idx + _hmap_ctz(_empty);
+            return b;
+        }
+        _idx += _rem < hmap_GROUP ? _rem : hmap_GROUP;
+        if (_idx == _cap) _idx = 0;
+    }
+#elif defined i_robinhood
+    const uint8_t* _dist = _i_dists(s, _cap);
+    for (intptr_t _d = 0; s[_idx].hashx; ++_d) {
+        _i_count(_cnt, probes);
+        if (s[_idx].hashx == b.hashx && _i_hashok(_idx)) {
+            const _m_keyraw _raw = i_keyto(_i_keyref(table + _idx));
+            _i_count(_cnt, eq_calls);
+            if (i_eq((&_raw), rkeyptr)) {
+                b.inserted = false;
+                break;
+            }
+            _i_count(_cnt, eq_fails);
+        }
+        if (_dist[_idx] < _d && (_dist[_idx] < 255 || _c_MEMB(_dist_at_)(table, s, _cap, _idx) < _d))
+            break; // the resident is closer to its home: rkey is not in the table
+        if (++_idx == _cap) _idx = 0;
+    }
+    b.ref = table + _idx;
+    return b;
+#else
     while (s[_idx].hashx) {
-        if (s[_idx].hashx == b.hashx) {
-            const _m_keyraw _raw = i_keyto(_i_keyref(self->table + _idx));
+        _i_count(_cnt, probes);
+        if (s[_idx].hashx == b.hashx && _i_hashok(_idx)) {
+            const _m_keyraw _raw = i_keyto(_i_keyref(table + _idx));
+            _i_count(_cnt, eq_calls);
             if (i_eq((&_raw), rkeyptr)) {
                 b.inserted = false;
                 break;
             }
+            _i_count(_cnt, eq_fails);
         }
         if (++_idx == _cap) _idx = 0;
     }
-    b.ref = self->table + _idx;
+    b.ref = table + _idx;
     return b;
+#endif
+    #undef _i_hashok
 }
 
+// Move *val and, with i_soa, *mval into a table known not to hold
+// its key: find its bucket without key compares.
+STC_INLINE void
+_c_MEMB(_move_to_)(_m_value* table, struct hmap_slot* slot, const intptr_t _cap,
+                   const _m_value* val _i_SOA(, const _m_mapped* mval), const uint8_t hashx, const uint64_t hash) {
+    intptr_t _idx = _i_bucket(hash, _cap);
+#ifdef i_robinhood
+    for (intptr_t _d = 0; slot[_idx].hashx && _c_MEMB(_dist_at_)(table, slot, _cap, _idx) >= _d; ++_d)
+#else
+    while (slot[_idx].hashx)
+#endif
+        if (++_idx == _cap) _idx = 0;
+    _c_MEMB(_place_)(table, slot, _cap, _idx, hashx, hash);
+    table[_idx] = *val;
+    _i_SOA( _i_vals(table, _cap)[_idx] = *mval; )
+}
+
+STC_DEF _m_result
+_c_MEMB(_bucket_hashed_)(const i_type* self, const _m_keyraw* rkeyptr, const uint64_t _hash) {
+    _m_result b;
+#ifdef i_incremental
+    if (self->_old.size) {
+        b = _c_MEMB(_probe_)(self->_old.table, self->_old.slot,
+                             self->_old.bucket_count, rkeyptr, _hash, _i_counters(self));
+        if (!b.inserted) {
+            _i_SOA( b.val = _i_vals(self->_old.table, self->_old.bucket_count) + (b.ref - self->_old.table); )
+            return b;
+        }
+    }
+#endif
+    _i_SOA( c_prefetch(_i_vals(self->table, self->bucket_count) + _i_bucket(_hash, self->bucket_count)); )
+    b = _c_MEMB(_probe_)(self->table, self->slot, self->bucket_count, rkeyptr, _hash, _i_counters(self));
+    _i_SOA( b.val = _i_vals(self->table, self->bucket_count) + (b.ref - self->table); )
+    return b;
+}
+
+#ifdef i_incremental
+STC_DEF void
+_c_MEMB(_migrate_)(i_type* self, intptr_t n) {
+    _m_value* d = self->_old.table;
+    struct hmap_slot* s = self->_old.slot;
+    const intptr_t _cap = self->_old.bucket_count;
+    intptr_t pos = self->_old.pos, left = self->_old.left;
+    // Move whole clusters only, so that lookups in the old table remain valid.
+    for (; left && self->_old.size; --left, --n) {
+        if (s[pos].hashx) {
+            _c_MEMB(_move_to_)(self->table, self->slot, self->bucket_count,
+                               d + pos _i_SOA(, _i_vals(d, _cap) + pos),
+                               s[pos].hashx, _c_MEMB(_hash_at_)(d, s, _cap, pos));
+            s[pos].hashx = 0;
+            --self->_old.size;
+        } else if (n <= 0)
+            break;
+        if (++pos == _cap) pos = 0;
+    }
+    self->_old.pos = pos, self->_old.left = left;
+    if (left == 0 || self->_old.size == 0) {
+        _c_MEMB(_free_buckets_)(d, s, _cap);
+        c_memset(&self->_old, 0, c_sizeof self->_old);
+    }
+}
+
+static bool
+_c_MEMB(_grow_)(i_type* self) {
+    const intptr_t _newcap = (intptr_t)((float)self->size*(i_growth_factor)) + 2;
+    if (self->_old.table)
+        _c_MEMB(_migrate_)(self, self->_old.left);
+    if (self->size == 0)
+        return _c_MEMB(_reserve)(self, _newcap);
+    const intptr_t _newbucks = _c_MEMB(_buckets_for_)(_newcap);
+    _m_value* t = (_m_value *)i_malloc(_i_tablebytes(_newbucks));
+    struct hmap_slot* s = (struct hmap_slot *)i_calloc(_i_slotbytes(_newbucks), 1);
+    if (!(t && s)) {
+        if (t) i_free(t, _i_tablebytes(_newbucks));
+        if (s) i_free(s, _i_slotbytes(_newbucks));
+        return false;
+    }
+    s[_newbucks].hashx = 0xff;
+    _i_count(_i_counters(self), resizes);
+    intptr_t e = 0; // start migration after an empty slot, i.e. at a cluster boundary.
+    while (self->slot[e].hashx) ++e;
+    self->_old.table = self->table, self->_old.slot = self->slot;
+    self->_old.size = self->size, self->_old.bucket_count = self->bucket_count;
+    self->_old.pos = _i_wrap(e + 1, self->bucket_count);
+    self->_old.left = self->bucket_count - 1;
+    self->table = t, self->slot = s, self->bucket_count = _newbucks;
+    return true;
+}
+#endif // i_incremental
+
 STC_DEF _m_result
-_c_MEMB(_insert_entry_)(i_type* self, _m_keyraw rkey) {
+_c_MEMB(_insert_hashed_)(i_type* self, const _m_keyraw* rkeyptr, const uint64_t _hash) {
+#ifdef i_incremental
+    if (self->_old.table)
+        _c_MEMB(_migrate_)(self, i_incremental_step);
     if (self->size >= (intptr_t)((float)self->bucket_count * (i_max_load_factor)))
-        if (!_c_MEMB(_reserve)(self, (intptr_t)(self->size*3/2 + 2)))
+        if (!_c_MEMB(_grow_)(self))
             return c_LITERAL(_m_result){NULL};
+#else
+    if (self->size >= (intptr_t)((float)self->bucket_count * (i_max_load_factor)))
+        if (!_c_MEMB(_reserve)(self, (intptr_t)((float)self->size*(i_growth_factor)) + 2))
+            return c_LITERAL(_m_result){NULL};
+#endif
 
-    _m_result b = _c_MEMB(_bucket_)(self, &rkey);
+    _m_result b = _c_MEMB(_bucket_hashed_)(self, rkeyptr, _hash);
     if (b.inserted) {
-        self->slot[b.ref - self->table].hashx = b.hashx;
+        _c_MEMB(_place_)(self->table, self->slot, self->bucket_count, b.ref - self->table, b.hashx, _hash);
         ++self->size;
     }
     return b;
 }
 
+// Batch functions: hash a group of keys and prefetch their home buckets before probing,
+// so that the cache misses of the group overlap.
+STC_INLINE void
+_c_MEMB(_prefetch_n_)(const i_type* self, const _m_keyraw* rkeys, intptr_t n, uint64_t hash[]) {
+    for (intptr_t i = 0; i < n; ++i) {
+        const intptr_t _idx = _i_bucket(hash[i] = i_hash((rkeys + i)), self->bucket_count);
+        c_prefetch(self->slot + _idx);
+        c_prefetch(self->table + _idx);
+    }
+}
+
+STC_DEF intptr_t
+_c_MEMB(_get_n)(const i_type* self, const _m_keyraw rkeys[], intptr_t n, const _m_value* out[]) {
+    uint64_t hash[hmap_BATCH];
+    intptr_t found = 0;
+    if (self->size == 0) {
+        c_memset(out, 0, n*c_sizeof *out);
+        return 0;
+    }
+    for (intptr_t i = 0; i < n; i += hmap_BATCH) {
+        const intptr_t m = n - i < hmap_BATCH ? n - i : hmap_BATCH;
+        _c_MEMB(_prefetch_n_)(self, rkeys + i, m, hash);
+        for (intptr_t j = 0; j < m; ++j) {
+            _m_result b = _c_MEMB(_bucket_hashed_)(self, rkeys + i + j, hash[j]);
+            out[i + j] = b.inserted ? NULL : b.ref;
+            found += !b.inserted;
+        }
+    }
+    return found;
+}
+
+STC_DEF intptr_t
+_c_MEMB(_contains_n)(const i_type* self, const _m_keyraw rkeys[], intptr_t n, bool out[]) {
+    uint64_t hash[hmap_BATCH];
+    intptr_t found = 0;
+    if (self->size == 0) {
+        c_memset(out, 0, n*c_sizeof *out);
+        return 0;
+    }
+    for (intptr_t i = 0; i < n; i += hmap_BATCH) {
+        const intptr_t m = n - i < hmap_BATCH ? n - i : hmap_BATCH;
+        _c_MEMB(_prefetch_n_)(self, rkeys + i, m, hash);
+        for (intptr_t j = 0; j < m; ++j)
+            found += (out[i + j] = !_c_MEMB(_bucket_hashed_)(self, rkeys + i + j, hash[j]).inserted);
+    }
+    return found;
+}
+
+STC_DEF intptr_t
+_c_MEMB(_emplace_n)(i_type* self, const _m_raw raw[], intptr_t n) {
+    _m_keyraw rkeys[hmap_BATCH];
+    uint64_t hash[hmap_BATCH];
+    intptr_t inserted = 0;
+    if (!_c_MEMB(_reserve)(self, self->size + n)) // no rehash while prefetched
+        return 0;
+    for (intptr_t i = 0; i < n; i += hmap_BATCH) {
+        const intptr_t m = n - i < hmap_BATCH ? n - i : hmap_BATCH;
+        for (intptr_t j = 0; j < m; ++j)
+            rkeys[j] = _i_SET_ONLY( raw[i + j] ) _i_MAP_ONLY( raw[i + j].first );
+        _c_MEMB(_prefetch_n_)(self, rkeys, m, hash);
+        for (intptr_t j = 0; j < m; ++j) {
+            _m_result _res = _c_MEMB(_insert_hashed_)(self, rkeys + j, hash[j]);
+            if (_res.inserted) {
+                *_i_keyref(_res.ref) = i_keyfrom(rkeys[j]);
+                _i_MAP_ONLY( *_i_mapref(_res) = i_valfrom(raw[i + j].second); )
+                ++inserted;
+            }
+        #if defined i_no_emplace // raw is the value type: consume it, like _insert()
+            else {
+                _m_key _key = rkeys[j];
+                i_keydrop((&_key));
+                _i_MAP_ONLY( _m_mapped _mapped = raw[i + j].second; i_valdrop((&_mapped)); )
+            }
+        #endif
+        }
+    }
+    return inserted;
+}
+
 #if !defined i_no_clone
+STC_INLINE bool
+_c_MEMB(_clone_buckets_)(_m_value** table, struct hmap_slot** slot, const intptr_t n) {
+    _m_value *d = (_m_value *)i_malloc(_i_tablebytes(n)), *_dst = d, *_src = *table, *_end = _src + n;
+    const intptr_t _sbytes = _i_slotbytes(n);
+    struct hmap_slot *s = (struct hmap_slot *)i_malloc(_sbytes), *_sp = *slot;
+    bool ok = d && s;
+    if (!ok) {
+        if (d) i_free(d, _i_tablebytes(n));
+        if (s) i_free(s, _sbytes);
+        d = 0, s = 0;
+    } else {
+        c_memcpy(s, _sp, _sbytes);
+    #ifdef _i_trivial
+        (void)_dst, (void)_end;
+        c_memcpy(d, _src, _i_tablebytes(n)); // including the unused buckets: one sequential copy
+    #else
+        _i_SOA( _m_mapped *_vdst = _i_vals(d, n), *_vsrc = _i_vals(*table, n); )
+        for (; _src != _end; ++_src, ++_sp, ++_dst _i_SOA(, ++_vsrc, ++_vdst))
+            if (_sp->hashx) {
+                *_dst = _c_MEMB(_value_clone)(*_src);
+                _i_SOA( *_vdst = i_valclone((*_vsrc)); )
+            }
+    #endif
+    }
+    *table = d, *slot = s;
+    return ok;
+}
+
 STC_DEF i_type
 _c_MEMB(_clone)(i_type m) {
-    if (m.bucket_count) {
-        _m_value *d = (_m_value *)i_malloc(m.bucket_count*c_sizeof *d),
-                 *_dst = d, *_end = m.table + m.bucket_count;
-        const intptr_t _sbytes = (m.bucket_count + 1)*c_sizeof *m.slot;
-        struct hmap_slot *s = (struct hmap_slot *)c_memcpy(i_malloc(_sbytes), m.slot, _sbytes);
-        if (!(d && s)) {
-            i_free(d, m.bucket_count*c_sizeof *d);
-            if (s) i_free(s, _sbytes);
-            d = 0, s = 0, m.bucket_count = 0;
-        } else
-            for (; m.table != _end; ++m.table, ++m.slot, ++_dst)
-                if (m.slot->hashx)
-                    *_dst = _c_MEMB(_value_clone)(*m.table);
-        m.table = d, m.slot = s;
-    }
+    if (m.bucket_count && !_c_MEMB(_clone_buckets_)(&m.table, &m.slot, m.bucket_count))
+        m.bucket_count = 0;
+#ifdef i_incremental
+    if (m._old.table && !_c_MEMB(_clone_buckets_)(&m._old.table, &m._old.slot, m._old.bucket_count))
+        m._old.bucket_count = 0;
+#endif
     return m;
 }
 #endif
 
 STC_DEF bool
 _c_MEMB(_reserve)(i_type* self, const intptr_t _newcap) {
+#ifdef i_incremental
+    if (self->_old.table)
+        _c_MEMB(_migrate_)(self, self->_old.left);
+#endif
     const intptr_t _oldbucks = self->bucket_count;
     if (_newcap != self->size && _newcap <= _oldbucks)
         return true;
-    intptr_t _newbucks = (intptr_t)((float)_newcap / (i_max_load_factor)) + 4;
-    _newbucks = c_next_pow2(_newbucks);
+    const intptr_t _newbucks = _c_MEMB(_buckets_for_)(_newcap);
+#if defined i_store_hash || defined i_compact
+    c_assert((uint64_t)_newbucks <= (uint64_t)UINT32_MAX + 1);
+#endif
     i_type m = {
-        (_m_value *)i_malloc(_newbucks*c_sizeof(_m_value)),
-        (struct hmap_slot *)i_calloc(_newbucks + 1, c_sizeof(struct hmap_slot)),
+        (_m_value *)i_malloc(_i_tablebytes(_newbucks)),
+        (struct hmap_slot *)i_calloc(_i_slotbytes(_newbucks), 1),
         self->size, _newbucks
     };
     bool ok = m.table && m.slot;
@@ -431,16 +1055,17 @@ _c_MEMB(_reserve)(i_type* self, const intptr_t _newcap) {
         m.slot[_newbucks].hashx = 0xff;
         const _m_value* d = self->table;
         const struct hmap_slot* s = self->slot;
-        for (intptr_t i = 0; i < _oldbucks; ++i, ++d) if ((s++)->hashx) {
-            _m_keyraw r = i_keyto(_i_keyref(d));
-            _m_result b = _c_MEMB(_bucket_)(&m, &r);
-            m.slot[b.ref - m.table].hashx = b.hashx;
-            *b.ref = *d; // move
-        }
+        for (intptr_t i = 0; i < _oldbucks; ++i) if (s[i].hashx)
+            _c_MEMB(_move_to_)(m.table, m.slot, _newbucks, d + i _i_SOA(, _i_vals(d, _oldbucks) + i),
+                               s[i].hashx, _c_MEMB(_hash_at_)(d, s, _oldbucks, i));
+    #ifdef i_stats
+        m._counters = self->_counters;
+        _i_count(_i_counters(&m), resizes);
+    #endif
         c_swap(i_type, self, &m);
     }
-    i_free(m.slot, (m.bucket_count + (int)(m.slot != NULL))*c_sizeof *m.slot);
-    i_free(m.table, m.bucket_count*c_sizeof *m.table);
+    i_free(m.slot, m.slot ? _i_slotbytes(m.bucket_count) : 0);
+    i_free(m.table, _i_tablebytes(m.bucket_count));
     return ok;
 }
 
@@ -448,26 +1073,317 @@ STC_DEF void
 _c_MEMB(_erase_entry)(i_type* self, _m_value* _val) {
     _m_value* d = self->table;
     struct hmap_slot* s = self->slot;
+    intptr_t _cap = self->bucket_count;
+#ifdef i_incremental
+    if (_c_MEMB(_in_old_)(self, _val)) {
+        d = self->_old.table, s = self->_old.slot, _cap = self->_old.bucket_count;
+        --self->_old.size;
+    }
+#endif
     intptr_t i = _val - d, j = i, k;
-    const intptr_t _cap = self->bucket_count;
     _c_MEMB(_value_drop)(_val);
+    _i_SOA( _m_mapped* _v = _i_vals(d, _cap); i_valdrop((_v + i)); )
+#ifdef i_robinhood
+    uint8_t* _dist = _i_dists(s, _cap);
+    for (;;) { // shift back displaced entries
+        if (++j == _cap) j = 0;
+        if (! s[j].hashx || _dist[j] == 0)
+            break;
+        k = _c_MEMB(_dist_at_)(d, s, _cap, j) - 1;
+        d[i] = d[j];
+        _i_SOA( _v[i] = _v[j]; )
+        s[i] = s[j];
+        _dist[i] = (uint8_t)(k < 255 ? k : 255);
+        #ifdef i_store_hash
+        _i_hashes(s, _cap)[i] = _i_hashes(s, _cap)[j];
+        #endif
+        i = j;
+    }
+#else
     for (;;) { // delete without leaving tombstone
         if (++j == _cap) j = 0;
         if (! s[j].hashx)
             break;
-        const _m_keyraw _raw = i_keyto(_i_keyref(d + j));
-        k = fastrange_2(i_hash((&_raw)), _cap);
+        const uint64_t _hash = _c_MEMB(_hash_at_)(d, s, _cap, j);
+        k = _i_bucket(_hash, _cap);
         if ((j < i) ^ (k <= i) ^ (k > j)) { // is k outside (i, j]?
             d[i] = d[j];
+            _i_SOA( _v[i] = _v[j]; )
             s[i] = s[j];
+            _c_MEMB(_set_hash_)(s, _cap, i, _hash);
             i = j;
         }
     }
+#endif
     s[i].hashx = 0;
     --self->size;
 }
+// retain()/drain_if() of one table. Starts after an empty bucket, so that clusters are visited whole
+// and in order. A kept element is moved back to the first empty bucket from its home, if any of the
+// buckets before it in its cluster were emptied. Elements never move out of their cluster.
+static intptr_t
+_c_MEMB(_sweep_)(_m_value* d, struct hmap_slot* s, const intptr_t _cap,
+                 bool (*keep)(const _m_value* val _i_SOA(, const _m_mapped* mapped), void* ctx),
+                 bool (*take)(_m_value* val _i_SOA(, _m_mapped* mapped), void* ctx), void* ctx) {
+    intptr_t e = 0, i, j, n, removed = 0;
+    bool gap = false; // an emptied bucket in the current cluster
+    _i_SOA( _m_mapped* _v = _i_vals(d, _cap); )
+    if (_cap == 0) return 0;
+    while (s[e].hashx) ++e;
+    for (n = 0, i = e; n < _cap; ++n) {
+        if (++i == _cap) i = 0;
+        if (! s[i].hashx) { // empty before the sweep: end of cluster
+            gap = false;
+            continue;
+        }
+        if (keep ? !keep(d + i _i_SOA(, _v + i), ctx) : take(d + i _i_SOA(, _v + i), ctx)) {
+            if (keep) {
+                _c_MEMB(_value_drop)(d + i);
+                _i_SOA( i_valdrop((_v + i)); )
+            }
+            s[i].hashx = 0;
+            gap = true, ++removed;
+            continue;
+        }
+        if (! gap) continue;
+    #ifdef i_robinhood
+        const intptr_t _home = _i_wrap(i - _c_MEMB(_dist_at_)(d, s, _cap, i), _cap);
+    #else
+        const intptr_t _home = _i_bucket(_c_MEMB(_hash_at_)(d, s, _cap, i), _cap);
+    #endif
+        for (j = _home; j != i && s[j].hashx; )
+            if (++j == _cap) j = 0;
+        if (j == i) continue;
+        d[j] = d[i];
+        _i_SOA( _v[j] = _v[i]; )
+        s[j] = s[i];
+        s[i].hashx = 0;
+    #ifdef i_store_hash
+        _i_hashes(s, _cap)[j] = _i_hashes(s, _cap)[i];
+    #endif
+    #ifdef i_robinhood
+        const intptr_t _d = _i_wrap(j - _home, _cap);
+        _i_dists(s, _cap)[j] = (uint8_t)(_d < 255 ? _d : 255);
+    #endif
+    }
+    return removed;
+}
+
+STC_DEF intptr_t
+_c_MEMB(_retain)(i_type* self, bool (*keep)(const _m_value* val _i_SOA(, const _m_mapped* mapped), void* ctx),
+                 void* ctx) {
+    intptr_t n = _c_MEMB(_sweep_)(self->table, self->slot, self->bucket_count, keep, NULL, ctx);
+#ifdef i_incremental
+    if (self->_old.table) { // elements stay in their cluster: the part not yet migrated is unaffected
+        const intptr_t m = _c_MEMB(_sweep_)(self->_old.table, self->_old.slot, self->_old.bucket_count,
+                                            keep, NULL, ctx);
+        self->_old.size -= m, n += m;
+    }
+#endif
+    self->size -= n;
+    return n;
+}
+
+STC_DEF intptr_t
+_c_MEMB(_drain_if)(i_type* self, bool (*take)(_m_value* val _i_SOA(, _m_mapped* mapped), void* ctx),
+                   void* ctx) {
+    intptr_t n = _c_MEMB(_sweep_)(self->table, self->slot, self->bucket_count, NULL, take, ctx);
+#ifdef i_incremental
+    if (self->_old.table) {
+        const intptr_t m = _c_MEMB(_sweep_)(self->_old.table, self->_old.slot, self->_old.bucket_count,
+                                            NULL, take, ctx);
+        self->_old.size -= m, n += m;
+    }
+#endif
+    self->size -= n;
+    return n;
+}
+
+// Accumulate the statistics of one table into *st: sums of probe lengths in hit_cost and miss_cost.
+STC_INLINE void
+_c_MEMB(_stats_scan_)(const _m_value* table, const struct hmap_slot* s, const intptr_t _cap, hmap_stats* st) {
+    intptr_t e = 0, i, j, run = 0;
+    if (_cap == 0) return;
+    while (s[e].hashx) ++e; // an empty bucket: clusters do not wrap past it
+    for (i = 0; i < _cap; ++i) {
+        const intptr_t k = _i_wrap(e + 1 + i, _cap);
+        if (!s[k].hashx) { run = 0; continue; }
+        if (++run > st->longest_cluster) st->longest_cluster = run;
+
+        const intptr_t home = _i_bucket(_c_MEMB(_hash_at_)(table, s, _cap, k), _cap);
+        const intptr_t len = _i_wrap(k - home, _cap) + 1;
+        int bin = 0;
+        while (bin < hmap_STATS_BINS - 1 && (len >> (bin + 1))) ++bin;
+        ++st->probe_hist[bin];
+        if (len > st->max_probe) st->max_probe = len;
+        st->hit_cost += (double)len;
+        for (j = home; j != k; j = _i_wrap(j + 1, _cap))
+            st->tag_collisions += s[j].hashx == s[k].hashx;
+    }
+#ifdef i_robinhood
+    for (i = 0; i < _cap; ++i) { // a miss stops at the first entry closer to its home than the probe
+        intptr_t d = 0;
+        for (j = i; s[j].hashx && _c_MEMB(_dist_at_)(table, s, _cap, j) >= d; j = _i_wrap(j + 1, _cap))
+            ++d;
+        st->miss_cost += (double)(d + 1);
+    }
+#else
+    for (i = 0, run = 0; i < _cap; ++i) { // backwards from an empty bucket: run = distance to next empty
+        const intptr_t k = _i_wrap(e - i, _cap);
+        run = s[k].hashx ? run + 1 : 0;
+        st->miss_cost += (double)(run + 1);
+    }
+#endif
+}
+
+STC_DEF hmap_stats
+_c_MEMB(_stats)(const i_type* self) {
+    hmap_stats st = {0};
+    st.size = self->size, st.bucket_count = self->bucket_count;
+    st.load_factor = self->bucket_count ? (double)self->size/(double)self->bucket_count : 0.0;
+    _c_MEMB(_stats_scan_)(self->table, self->slot, self->bucket_count, &st);
+    double _buckets = (double)self->bucket_count;
+#ifdef i_incremental
+    if (self->_old.table) { // a lookup probes both tables
+        const double _mc = st.miss_cost;
+        st.miss_cost = 0;
+        _c_MEMB(_stats_scan_)(self->_old.table, self->_old.slot, self->_old.bucket_count, &st);
+        st.miss_cost = _mc/_buckets + st.miss_cost/(double)self->_old.bucket_count;
+        _buckets = 1;
+    }
+#endif
+    if (_buckets) st.miss_cost /= _buckets;
+    if (self->size) {
+        st.hit_cost /= (double)self->size;
+        st.tag_collisions /= (double)self->size;
+    }
+#ifdef i_stats
+    st.counters = self->_counters;
+#endif
+    return st;
+}
+
+#if defined _i_trivial && !defined _i_soa
+#ifndef i_hash_id
+  #define i_hash_id _hmap_name_id(_hmap_xstringify(i_hash))
+#endif
+
+STC_INLINE hmap_file_header _c_MEMB(_file_header_)(const intptr_t size, const intptr_t nbuckets) {
+    hmap_file_header h = {hmap_FILE_MAGIC, hmap_FILE_VERSION, c_sizeof(_m_key), c_sizeof(_m_value),
+                          (uint32_t)_i_slots(0), 0, i_hash_id, size, nbuckets,
+                          c_sizeof(hmap_file_header), 0};
+#ifdef i_store_hash
+    h.flags |= 1;
+#endif
+#ifdef i_robinhood
+    h.flags |= 2;
+#endif
+#ifdef i_compact
+    h.flags |= 4;
+#endif
+    h.table_offset = (h.slot_offset + _i_slotbytes(nbuckets) + 63) & ~(int64_t)63;
+    return h;
+}
+
+STC_DEF bool
+_c_MEMB(_write)(const i_type* self, FILE* fp) {
+#ifdef i_incremental
+    if (self->_old.table) // finish the migration first, e.g. with hmap_X_reserve(self, 0)
+        return false;
+#endif
+    const intptr_t n = self->bucket_count;
+    const hmap_file_header h = _c_MEMB(_file_header_)(self->size, n);
+    char buf[4096] = {0}; // empty buckets are written as zeros
+    bool ok = fwrite(&h, sizeof h, 1, fp) == 1;
+    if (n)
+        ok = ok && fwrite(self->slot, (size_t)_i_slotbytes(n), 1, fp) == 1;
+    else {
+        buf[0] = (char)0xff; // end sentinel
+        ok = ok && fwrite(buf, (size_t)_i_slotbytes(0), 1, fp) == 1;
+        buf[0] = 0;
+    }
+    const intptr_t _pad = (intptr_t)(h.table_offset - h.slot_offset) - _i_slotbytes(n);
+    ok = ok && (_pad == 0 || fwrite(buf, (size_t)_pad, 1, fp) == 1);
+
+    const intptr_t _chunk = c_sizeof buf/c_sizeof(_m_value);
+    if (_chunk == 0) { // large elements
+        for (intptr_t i = 0; ok && i < n; ++i) {
+            _m_value _v; c_memset(&_v, 0, c_sizeof _v);
+            if (self->slot[i].hashx) _v = self->table[i];
+            ok = fwrite(&_v, sizeof _v, 1, fp) == 1;
+        }
+        return ok;
+    }
+    for (intptr_t i = 0; ok && i < n; i += _chunk) {
+        _m_value* _dst = (_m_value*)buf;
+        const intptr_t _m = n - i < _chunk ? n - i : _chunk;
+        c_memset(buf, 0, c_sizeof buf);
+        for (intptr_t j = 0; j < _m; ++j)
+            if (self->slot[i + j].hashx) _dst[j] = self->table[i + j];
+        ok = fwrite(buf, sizeof(_m_value), (size_t)_m, fp) == (size_t)_m;
+    }
+    return ok;
+}
+
+STC_DEF bool
+_c_MEMB(_map_view)(i_type* view, const void* mem, const intptr_t size) {
+    const hmap_file_header* h = (const hmap_file_header*)mem;
+    c_memset(view, 0, c_sizeof *view);
+    if ((uintptr_t)mem & 15 || size < c_sizeof *h)
+        return false;
+    const intptr_t n = (intptr_t)h->bucket_count;
+    if (n < 0 || h->size < 0 || h->size > n || n > (size - c_sizeof *h)/c_sizeof(_m_value))
+        return false;
+#ifndef i_compact
+    if (n & (n - 1))
+        return false;
+#endif
+    const hmap_file_header ref = _c_MEMB(_file_header_)((intptr_t)h->size, n);
+    if (c_memcmp(h, &ref, c_sizeof ref) != 0 || ref.table_offset + n*c_sizeof(_m_value) > size)
+        return false;
+    view->table = n ? (_m_value*)((char*)mem + ref.table_offset) : NULL;
+    view->slot = n ? (struct hmap_slot*)((char*)mem + ref.slot_offset) : NULL;
+    view->size = (intptr_t)h->size;
+    view->bucket_count = n;
+    return true;
+}
+#endif // _i_trivial && !_i_soa
 #endif // i_implement
 #undef i_max_load_factor
+#undef i_simd
+#undef i_incremental
+#undef i_incremental_step
+#undef i_store_hash
+#undef i_stats
+#undef _i_counters
+#undef _i_count
+#undef _i_STATS
+#undef i_robinhood
+#undef i_compact
+#undef i_growth_factor
+#undef _i_bucket
+#undef _i_wrap
+#undef _i_tag
+#undef _i_hash32
+#undef _i_unhash32
+#undef i_soa
+#undef _i_soa
+#undef _i_SOA
+#undef _i_PAIR_ONLY
+#undef _i_KEY_ONLY
+#undef _i_mapref
+#undef _i_valpos
+#undef _i_vals
+#undef _i_tablebytes
+#undef _i_distpos
+#undef _i_dists
+#undef i_hash_id
+#undef _i_trivial
+#undef _i_hashpos
+#undef _i_hashes
+#undef _i_slotbytes
+#undef _i_simd
+#undef _i_slots
 #undef _i_isset
 #undef _i_ismap
 #undef _i_ishash
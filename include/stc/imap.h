@@ -0,0 +1,478 @@
+/* MIT License
+ *
+ * Copyright (c) 2023 Tyge Løvset
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Insertion ordered map - elements are stored densely in insertion order. The hash table holds
+// 32-bit indices into the elements and hashx tag bytes, with linear probing and no tombstones.
+/*
+#include <stdio.h>
+#define i_TYPE Imap,int,char
+#include "stc/imap.h"
+
+int main(void) {
+    Imap m = {0};
+    Imap_insert(&m, 5, 'a');
+    Imap_insert(&m, 8, 'b');
+    Imap_insert(&m, 2, 'c');
+    Imap_erase(&m, 8);        // keeps order
+
+    c_foreach (i, Imap, m)    // 5: a, 2: c
+        printf("%d: %c\n", i.ref->first, i.ref->second);
+    Imap_drop(&m);
+}
+*/
+#include "priv/linkage.h"
+
+#ifndef STC_IMAP_H_INCLUDED
+#define STC_IMAP_H_INCLUDED
+#include "common.h"
+#include "types.h"
+#include <stdlib.h>
+#include <string.h>
+#define _imap_tags(index, n) ((uint8_t*)((index) + (n))) // tag bytes follow the n indices
+#endif // STC_IMAP_H_INCLUDED
+
+#ifndef _i_prefix
+  #define _i_prefix imap_
+#endif
+#define _i_ismap
+#define _i_ishash
+#include "priv/template.h"
+#ifndef i_is_forward
+  _c_DEFTYPES(_c_imap_types, i_type, i_key, i_val);
+#endif
+
+struct _m_value {
+    _m_key first;
+    _m_mapped second;
+};
+
+typedef i_keyraw _m_keyraw;
+typedef i_valraw _m_rmapped;
+typedef struct { _m_keyraw first; _m_rmapped second; } _m_raw;
+
+#if !defined i_no_clone
+STC_API i_type          _c_MEMB(_clone)(i_type map);
+#endif
+STC_API void            _c_MEMB(_drop)(const i_type* cself);
+STC_API void            _c_MEMB(_clear)(i_type* self);
+STC_API bool            _c_MEMB(_reserve)(i_type* self, intptr_t capacity);
+STC_API intptr_t        _c_MEMB(_bucket_)(const i_type* self, const _m_keyraw* rkeyptr, uint64_t hash);
+STC_API _m_result       _c_MEMB(_insert_entry_)(i_type* self, _m_keyraw rkey);
+STC_API void            _c_MEMB(_erase_entry)(i_type* self, _m_value* val);
+STC_API void            _c_MEMB(_swap_erase_entry)(i_type* self, _m_value* val);
+STC_API float           _c_MEMB(_max_load_factor)(const i_type* self);
+
+STC_INLINE i_type       _c_MEMB(_init)(void) { i_type map = {0}; return map; }
+STC_INLINE void         _c_MEMB(_shrink_to_fit)(i_type* self) { _c_MEMB(_reserve)(self, self->size); }
+STC_INLINE bool         _c_MEMB(_empty)(const i_type* map) { return !map->size; }
+STC_INLINE intptr_t     _c_MEMB(_size)(const i_type* map) { return map->size; }
+STC_INLINE intptr_t     _c_MEMB(_capacity)(const i_type* map) { return map->capacity; }
+STC_INLINE intptr_t     _c_MEMB(_bucket_count)(const i_type* map) { return map->bucket_count; }
+
+STC_INLINE i_type _c_MEMB(_with_capacity)(const intptr_t cap) {
+    i_type map = {0};
+    _c_MEMB(_reserve)(&map, cap);
+    return map;
+}
+
+STC_INLINE const _m_value*
+_c_MEMB(_get)(const i_type* self, _m_keyraw rkey) {
+    intptr_t b;
+    if (self->size && (b = _c_MEMB(_bucket_)(self, &rkey, i_hash((&rkey)))) >= 0)
+        return self->data + self->index[b];
+    return NULL;
+}
+
+STC_INLINE _m_value*
+_c_MEMB(_get_mut)(i_type* self, _m_keyraw rkey)
+    { return (_m_value*)_c_MEMB(_get)(self, rkey); }
+
+STC_INLINE bool
+_c_MEMB(_contains)(const i_type* self, _m_keyraw rkey)
+    { return _c_MEMB(_get)(self, rkey) != NULL; }
+
+STC_INLINE const _m_mapped*
+_c_MEMB(_at)(const i_type* self, _m_keyraw rkey) {
+    const _m_value* _v = _c_MEMB(_get)(self, rkey);
+    c_assert(_v != NULL);
+    return &_v->second;
+}
+
+STC_INLINE _m_mapped*
+_c_MEMB(_at_mut)(i_type* self, _m_keyraw rkey)
+    { return (_m_mapped*)_c_MEMB(_at)(self, rkey); }
+
+// Position of rkey in insertion order, or -1.
+STC_INLINE intptr_t
+_c_MEMB(_index_of)(const i_type* self, _m_keyraw rkey) {
+    const _m_value* _v = _c_MEMB(_get)(self, rkey);
+    return _v ? _v - self->data : -1;
+}
+
+STC_INLINE void _c_MEMB(_value_drop)(_m_value* _val) {
+    i_keydrop((&_val->first));
+    i_valdrop((&_val->second));
+}
+
+STC_INLINE _m_raw _c_MEMB(_value_toraw)(const _m_value* val)
+    { return c_LITERAL(_m_raw){i_keyto((&val->first)), i_valto((&val->second))}; }
+
+#if !defined i_no_clone
+STC_INLINE void _c_MEMB(_copy)(i_type *self, const i_type* other) {
+    if (self->data == other->data)
+        return;
+    _c_MEMB(_drop)(self);
+    *self = _c_MEMB(_clone)(*other);
+}
+
+STC_INLINE _m_value
+_c_MEMB(_value_clone)(_m_value _val) {
+    _val.first = i_keyclone(_val.first);
+    _val.second = i_valclone(_val.second);
+    return _val;
+}
+#endif // !i_no_clone
+
+STC_INLINE _m_result
+_c_MEMB(_insert)(i_type* self, _m_key _key, _m_mapped _mapped) {
+    _m_result _res = _c_MEMB(_insert_entry_)(self, i_keyto((&_key)));
+    if (_res.inserted)
+        { _res.ref->first = _key; _res.ref->second = _mapped; }
+    else
+        { i_keydrop((&_key)); i_valdrop((&_mapped)); }
+    return _res;
+}
+
+STC_INLINE _m_result
+_c_MEMB(_insert_or_assign)(i_type* self, _m_key _key, _m_mapped _mapped) {
+    _m_result _res = _c_MEMB(_insert_entry_)(self, i_keyto((&_key)));
+    _m_mapped* _mp = _res.ref ? &_res.ref->second : &_mapped;
+    if (_res.inserted)
+        _res.ref->first = _key;
+    else
+        { i_keydrop((&_key)); i_valdrop(_mp); }
+    *_mp = _mapped;
+    return _res;
+}
+
+STC_INLINE _m_value* _c_MEMB(_push)(i_type* self, _m_value _val) {
+    _m_result _res = _c_MEMB(_insert_entry_)(self, i_keyto((&_val.first)));
+    if (_res.inserted)
+        *_res.ref = _val;
+    else
+        _c_MEMB(_value_drop)(&_val);
+    return _res.ref;
+}
+
+#if !defined i_no_emplace
+STC_INLINE _m_result
+_c_MEMB(_emplace)(i_type* self, _m_keyraw rkey, _m_rmapped rmapped) {
+    _m_result _res = _c_MEMB(_insert_entry_)(self, rkey);
+    if (_res.inserted) {
+        _res.ref->first = i_keyfrom(rkey);
+        _res.ref->second = i_valfrom(rmapped);
+    }
+    return _res;
+}
+
+STC_INLINE _m_result
+_c_MEMB(_emplace_key)(i_type* self, _m_keyraw rkey) {
+    _m_result _res = _c_MEMB(_insert_entry_)(self, rkey);
+    if (_res.inserted)
+        _res.ref->first = i_keyfrom(rkey);
+    return _res;
+}
+
+STC_INLINE _m_result
+_c_MEMB(_emplace_or_assign)(i_type* self, _m_keyraw rkey, _m_rmapped rmapped) {
+    _m_result _res = _c_MEMB(_insert_entry_)(self, rkey);
+    if (_res.inserted)
+        _res.ref->first = i_keyfrom(rkey);
+    else {
+        if (!_res.ref) return _res;
+        i_valdrop((&_res.ref->second));
+    }
+    _res.ref->second = i_valfrom(rmapped);
+    return _res;
+}
+#endif // !i_no_emplace
+
+STC_INLINE void _c_MEMB(_put_n)(i_type* self, const _m_raw* raw, intptr_t n) {
+    while (n--)
+#if defined i_no_emplace
+        _c_MEMB(_insert_or_assign)(self, raw->first, raw->second), ++raw;
+#else
+        _c_MEMB(_emplace_or_assign)(self, raw->first, raw->second), ++raw;
+#endif
+}
+
+STC_INLINE i_type _c_MEMB(_from_n)(const _m_raw* raw, intptr_t n)
+    { i_type cx = {0}; _c_MEMB(_put_n)(&cx, raw, n); return cx; }
+
+STC_INLINE _m_iter _c_MEMB(_begin)(const i_type* self) {
+    _m_value* d = (_m_value*)self->data;
+    return c_LITERAL(_m_iter){self->size ? d : NULL, d + self->size};
+}
+
+STC_INLINE _m_iter _c_MEMB(_end)(const i_type* self)
+    { (void)self; return c_LITERAL(_m_iter){NULL}; }
+
+STC_INLINE void _c_MEMB(_next)(_m_iter* it)
+    { if (++it->ref == it->end) it->ref = NULL; }
+
+STC_INLINE _m_iter _c_MEMB(_advance)(_m_iter it, size_t n) {
+    if ((it.ref += n) >= it.end) it.ref = NULL;
+    return it;
+}
+
+STC_INLINE _m_iter
+_c_MEMB(_find)(const i_type* self, _m_keyraw rkey) {
+    _m_value* _v = _c_MEMB(_get_mut)((i_type*)self, rkey);
+    return c_LITERAL(_m_iter){_v, self->data + self->size};
+}
+
+// erase() keeps the insertion order of the remaining elements: O(n).
+// swap_erase() moves the last element into the erased position: O(1).
+STC_INLINE int
+_c_MEMB(_erase)(i_type* self, _m_keyraw rkey) {
+    _m_value* _v = _c_MEMB(_get_mut)(self, rkey);
+    if (_v) _c_MEMB(_erase_entry)(self, _v);
+    return _v != NULL;
+}
+
+STC_INLINE int
+_c_MEMB(_swap_erase)(i_type* self, _m_keyraw rkey) {
+    _m_value* _v = _c_MEMB(_get_mut)(self, rkey);
+    if (_v) _c_MEMB(_swap_erase_entry)(self, _v);
+    return _v != NULL;
+}
+
+// Both return an iterator to the element that now occupies the position of it.
+STC_INLINE _m_iter
+_c_MEMB(_erase_at)(i_type* self, _m_iter it) {
+    _c_MEMB(_erase_entry)(self, it.ref);
+    if (--it.end == it.ref) it.ref = NULL;
+    return it;
+}
+
+STC_INLINE _m_iter
+_c_MEMB(_swap_erase_at)(i_type* self, _m_iter it) {
+    _c_MEMB(_swap_erase_entry)(self, it.ref);
+    if (--it.end == it.ref) it.ref = NULL;
+    return it;
+}
+
+STC_INLINE bool
+_c_MEMB(_eq)(const i_type* self, const i_type* other) {
+    if (_c_MEMB(_size)(self) != _c_MEMB(_size)(other)) return false;
+    for (_m_iter i = _c_MEMB(_begin)(self); i.ref; _c_MEMB(_next)(&i)) {
+        const _m_keyraw _raw = i_keyto((&i.ref->first));
+        if (!_c_MEMB(_contains)(other, _raw)) return false;
+    }
+    return true;
+}
+
+/* -------------------------- IMPLEMENTATION ------------------------- */
+#if defined(i_implement) || defined(i_static)
+#ifndef i_max_load_factor
+  #define i_max_load_factor 0.80f
+#endif
+#define fastrange_2(x, n) (intptr_t)((x) & (size_t)((n) - 1)) // n power of 2.
+
+STC_DEF float _c_MEMB(_max_load_factor)(const i_type* self) {
+    (void)self; return (float)(i_max_load_factor);
+}
+
+STC_INLINE uint64_t _c_MEMB(_hash_of_)(const _m_value* val) {
+    const _m_keyraw _raw = i_keyto((&val->first));
+    return i_hash((&_raw));
+}
+
+// Returns the bucket holding rkey, or -1 - the empty bucket where it belongs.
+STC_DEF intptr_t
+_c_MEMB(_bucket_)(const i_type* self, const _m_keyraw* rkeyptr, const uint64_t _hash) {
+    const intptr_t _cap = self->bucket_count;
+    const uint8_t* _tags = _imap_tags(self->index, _cap), _hx = (uint8_t)(_hash | 0x80);
+    intptr_t _idx = fastrange_2(_hash, _cap);
+    while (_tags[_idx]) {
+        if (_tags[_idx] == _hx) {
+            const _m_keyraw _raw = i_keyto((&self->data[self->index[_idx]].first));
+            if (i_eq((&_raw), rkeyptr))
+                return _idx;
+        }
+        if (++_idx == _cap) _idx = 0;
+    }
+    return -1 - _idx;
+}
+
+// Bucket holding element index e: no key compares.
+STC_INLINE intptr_t
+_c_MEMB(_bucket_of_)(const i_type* self, const intptr_t e) {
+    intptr_t _idx = fastrange_2(_c_MEMB(_hash_of_)(self->data + e), self->bucket_count);
+    while (self->index[_idx] != (uint32_t)e || !_imap_tags(self->index, self->bucket_count)[_idx])
+        if (++_idx == self->bucket_count) _idx = 0;
+    return _idx;
+}
+
+STC_DEF bool
+_c_MEMB(_reserve)(i_type* self, intptr_t _newcap) {
+    if (_newcap < self->size)
+        return true;
+    const bool _shrink = _newcap == self->size;
+    if (_newcap > self->capacity || (_shrink && _newcap && _newcap < self->capacity)) {
+        _m_value* d = (_m_value*)i_realloc(self->data, self->capacity*c_sizeof *d,
+                                                       _newcap*c_sizeof *d);
+        if (!d)
+            return false;
+        self->data = d, self->capacity = _newcap;
+    }
+    const intptr_t _newbucks = c_next_pow2((intptr_t)((float)_newcap / (i_max_load_factor)) + 4);
+    if (_newbucks > self->bucket_count || (_shrink && _newbucks < self->bucket_count)) {
+        c_assert((uint64_t)_newcap <= UINT32_MAX);
+        const intptr_t _bytes = _newbucks*(c_sizeof(uint32_t) + 1);
+        uint32_t* _index = (uint32_t*)i_calloc(_bytes, 1);
+        if (!_index)
+            return false;
+        uint8_t* _tags = _imap_tags(_index, _newbucks);
+        for (intptr_t e = 0; e < self->size; ++e) { // rehash
+            const uint64_t _hash = _c_MEMB(_hash_of_)(self->data + e);
+            intptr_t _idx = fastrange_2(_hash, _newbucks);
+            while (_tags[_idx])
+                if (++_idx == _newbucks) _idx = 0;
+            _tags[_idx] = (uint8_t)(_hash | 0x80);
+            _index[_idx] = (uint32_t)e;
+        }
+        i_free(self->index, self->bucket_count*(c_sizeof(uint32_t) + 1));
+        self->index = _index, self->bucket_count = _newbucks;
+    }
+    return true;
+}
+
+STC_DEF _m_result
+_c_MEMB(_insert_entry_)(i_type* self, _m_keyraw rkey) {
+    _m_result _res = {NULL};
+    if (self->size == self->capacity ||
+        self->size >= (intptr_t)((float)self->bucket_count * (i_max_load_factor)))
+        if (!_c_MEMB(_reserve)(self, self->size*3/2 + 4))
+            return _res;
+    const uint64_t _hash = i_hash((&rkey));
+    const intptr_t b = _c_MEMB(_bucket_)(self, &rkey, _hash);
+    if (b >= 0) {
+        _res.ref = self->data + self->index[b];
+    } else {
+        _imap_tags(self->index, self->bucket_count)[-1 - b] = (uint8_t)(_hash | 0x80);
+        self->index[-1 - b] = (uint32_t)self->size;
+        _res.ref = self->data + self->size++;
+        _res.inserted = true;
+    }
+    return _res;
+}
+
+// Remove bucket i from the table without leaving a tombstone.
+STC_INLINE void
+_c_MEMB(_unlink_)(i_type* self, intptr_t i) {
+    const intptr_t _cap = self->bucket_count;
+    uint8_t* _tags = _imap_tags(self->index, _cap);
+    intptr_t j = i, k;
+    for (;;) {
+        if (++j == _cap) j = 0;
+        if (! _tags[j])
+            break;
+        k = fastrange_2(_c_MEMB(_hash_of_)(self->data + self->index[j]), _cap);
+        if ((j < i) ^ (k <= i) ^ (k > j)) { // is k outside (i, j]?
+            self->index[i] = self->index[j];
+            _tags[i] = _tags[j];
+            i = j;
+        }
+    }
+    _tags[i] = 0;
+}
+
+STC_DEF void
+_c_MEMB(_erase_entry)(i_type* self, _m_value* _val) {
+    const intptr_t e = _val - self->data;
+    _c_MEMB(_unlink_)(self, _c_MEMB(_bucket_of_)(self, e));
+    _c_MEMB(_value_drop)(_val);
+    c_memmove(_val, _val + 1, (self->size - e - 1)*c_sizeof *_val);
+    --self->size;
+    const uint8_t* _tags = _imap_tags(self->index, self->bucket_count);
+    if (e < self->size)
+        for (intptr_t i = 0; i < self->bucket_count; ++i)
+            if (_tags[i] && self->index[i] > (uint32_t)e)
+                --self->index[i];
+}
+
+STC_DEF void
+_c_MEMB(_swap_erase_entry)(i_type* self, _m_value* _val) {
+    const intptr_t e = _val - self->data, _last = self->size - 1;
+    _c_MEMB(_unlink_)(self, _c_MEMB(_bucket_of_)(self, e));
+    _c_MEMB(_value_drop)(_val);
+    if (e != _last) {
+        self->index[_c_MEMB(_bucket_of_)(self, _last)] = (uint32_t)e;
+        *_val = self->data[_last];
+    }
+    --self->size;
+}
+
+STC_DEF void _c_MEMB(_clear)(i_type* self) {
+    for (intptr_t i = 0; i < self->size; ++i)
+        _c_MEMB(_value_drop)(self->data + i);
+    self->size = 0;
+    if (self->bucket_count)
+        c_memset(_imap_tags(self->index, self->bucket_count), 0, self->bucket_count);
+}
+
+STC_DEF void _c_MEMB(_drop)(const i_type* cself) {
+    i_type* self = (i_type*)cself;
+    for (intptr_t i = 0; i < self->size; ++i)
+        _c_MEMB(_value_drop)(self->data + i);
+    i_free(self->data, self->capacity*c_sizeof *self->data);
+    i_free(self->index, self->bucket_count*(c_sizeof(uint32_t) + 1));
+}
+
+#if !defined i_no_clone
+STC_DEF i_type _c_MEMB(_clone)(i_type map) {
+    i_type out = {0};
+    const intptr_t _bytes = map.bucket_count*(c_sizeof(uint32_t) + 1);
+    out.data = (_m_value*)i_malloc(map.size*c_sizeof *out.data);
+    out.index = (uint32_t*)i_malloc(_bytes);
+    if ((out.data || !map.size) && (out.index || !_bytes)) {
+        if (_bytes) c_memcpy(out.index, map.index, _bytes);
+        out.capacity = out.size = map.size;
+        out.bucket_count = map.bucket_count;
+        for (intptr_t i = 0; i < map.size; ++i)
+            out.data[i] = _c_MEMB(_value_clone)(map.data[i]);
+    } else {
+        i_free(out.data, map.size*c_sizeof *out.data);
+        i_free(out.index, _bytes);
+        out.data = NULL, out.index = NULL;
+    }
+    return out;
+}
+#endif // !i_no_clone
+#endif // i_implement
+#undef i_max_load_factor
+#undef _i_ismap
+#undef _i_ishash
+#include "priv/template2.h"
+#include "priv/linkage2.h"
@@ -101,9 +101,7 @@ STC_API intptr_t        _c_MEMB(_remove)(i_type* self, _m_raw val);
 #endif
 #if defined _i_has_cmp
 STC_API bool            _c_MEMB(_sort_with)(i_type* self, int(*cmp)(const _m_value*, const _m_value*));
-STC_API int             _c_MEMB(_sort_cmp_)(const _m_value*, const _m_value*);
-STC_INLINE bool         _c_MEMB(_sort)(i_type* self)
-                            { return _c_MEMB(_sort_with)(self, _c_MEMB(_sort_cmp_)); }
+STC_API bool            _c_MEMB(_sort)(i_type* self);
 #endif
 STC_API void            _c_MEMB(_reverse)(i_type* self);
 STC_API _m_iter         _c_MEMB(_splice)(i_type* self, _m_iter it, i_type* other);
@@ -383,12 +381,11 @@ _c_MEMB(_remove)(i_type* self, _m_raw val) {
 #endif
 
 #if defined _i_has_cmp
-STC_DEF int _c_MEMB(_sort_cmp_)(const _m_value* x, const _m_value* y) {
-    const _m_raw a = i_keyto(x), b = i_keyto(y);
-    return i_cmp((&a), (&b));
-}
+#include "priv/sort_prv.h"
 
-STC_DEF bool _c_MEMB(_sort_with)(i_type* self, int(*cmp)(const _m_value*, const _m_value*)) {
+// Copy the values to an array, sort it with cmp, or with the inlined i_less if cmp is NULL,
+// and copy them back.
+static bool _c_MEMB(_sort_array_)(i_type* self, int(*cmp)(const _m_value*, const _m_value*)) {
     intptr_t len = 0, cap = 0;
     _m_value *arr = NULL, *p = NULL;
     c_foreach (i, i_type, *self) {
@@ -400,12 +397,21 @@ STC_DEF bool _c_MEMB(_sort_with)(i_type* self, int(*cmp)(const _m_value*, const
         }
         arr[len++] = *i.ref;
     }
-    qsort(arr, (size_t)len, sizeof *arr, (int(*)(const void*, const void*))cmp);
+    if (cmp)
+        qsort(arr, (size_t)len, sizeof *arr, (int(*)(const void*, const void*))cmp);
+    else
+        _c_MEMB(_sort_n_)(arr, len);
     c_foreach (i, i_type, *self)
         *i.ref = *p++;
     done: i_free(arr, cap*c_sizeof *arr);
     return p != NULL;
 }
+
+STC_DEF bool _c_MEMB(_sort_with)(i_type* self, int(*cmp)(const _m_value*, const _m_value*))
+    { return _c_MEMB(_sort_array_)(self, cmp); }
+
+STC_DEF bool _c_MEMB(_sort)(i_type* self)
+    { return _c_MEMB(_sort_array_)(self, NULL); }
 #endif // _i_has_cmp
 #endif // i_implement
 #include "priv/template2.h"
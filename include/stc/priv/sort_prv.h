@@ -0,0 +1,267 @@
+/* MIT License
+ *
+ * Copyright (c) 2023 Tyge Løvset
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Pattern-defeating quicksort (O. Peters, 2021) of a contiguous array of the container's values,
+// expanded inline with the template's i_less, instead of qsort() with a function pointer compare.
+// Median-of-3 / ninther pivots, and a partition that puts elements equal to the pivot to the left
+// when the pivot equals the element before the range. Partitions that needed no swaps are checked
+// with a bounded insertion sort, so sorted and nearly sorted runs take O(n). Unbalanced partitions
+// shuffle a few elements, and after log2(n) of them, the range is heapsorted: O(n log n) worst case.
+// For keys with the default less (arithmetic types), the partition is branchless and block based
+// (Edelkamp & Weiss, BlockQuicksort). Included by vec, deq and list after priv/template.h.
+
+#ifndef STC_SORT_PRV_H_INCLUDED
+#define STC_SORT_PRV_H_INCLUDED
+enum { _c_sort_insertion = 24, _c_sort_ninther = 128, _c_sort_block = 64 };
+#endif
+
+STC_INLINE bool
+_c_MEMB(_less_)(const _m_value* x, const _m_value* y) {
+    const _m_raw _rx = i_keyto(x), _ry = i_keyto(y);
+    return i_less((&_rx), (&_ry));
+}
+
+// Insertion sort of [a, a + n). When unguarded, an element <= all of them is at a[-1].
+STC_INLINE void
+_c_MEMB(_insertion_sort_)(_m_value* a, intptr_t n, bool guarded) {
+    for (intptr_t i = 1; i < n; ++i) {
+        _m_value* p = a + i;
+        if (_c_MEMB(_less_)(p, p - 1)) {
+            const _m_value x = *p;
+            do { *p = p[-1]; --p; } while ((!guarded || p != a) && _c_MEMB(_less_)(&x, p - 1));
+            *p = x;
+        }
+    }
+}
+
+// Insertion sort that gives up after 8 moved elements. Returns true if [a, a + n) is sorted.
+STC_INLINE bool
+_c_MEMB(_partial_insertion_sort_)(_m_value* a, intptr_t n) {
+    intptr_t moves = 0;
+    for (intptr_t i = 1; i < n; ++i) {
+        _m_value* p = a + i;
+        if (_c_MEMB(_less_)(p, p - 1)) {
+            const _m_value x = *p;
+            do { *p = p[-1]; --p; } while (p != a && _c_MEMB(_less_)(&x, p - 1));
+            *p = x;
+            moves += a + i - p;
+        }
+        if (moves > 8)
+            return false;
+    }
+    return true;
+}
+
+STC_INLINE void
+_c_MEMB(_heap_sift_)(_m_value* a, intptr_t i, intptr_t n) {
+    const _m_value x = a[i];
+    for (intptr_t c; (c = 2*i + 1) < n; i = c) {
+        if (c + 1 < n && _c_MEMB(_less_)(a + c, a + c + 1))
+            ++c;
+        if (!_c_MEMB(_less_)(&x, a + c))
+            break;
+        a[i] = a[c];
+    }
+    a[i] = x;
+}
+
+STC_INLINE void
+_c_MEMB(_heap_sort_)(_m_value* a, intptr_t n) {
+    for (intptr_t i = n/2; i-- > 0; )
+        _c_MEMB(_heap_sift_)(a, i, n);
+    while (--n > 0) {
+        c_swap(_m_value, a, a + n);
+        _c_MEMB(_heap_sift_)(a, 0, n);
+    }
+}
+
+STC_INLINE void
+_c_MEMB(_sort3_)(_m_value* x, _m_value* y, _m_value* z) {
+    if (_c_MEMB(_less_)(y, x)) c_swap(_m_value, x, y);
+    if (_c_MEMB(_less_)(z, y)) c_swap(_m_value, y, z);
+    if (_c_MEMB(_less_)(y, x)) c_swap(_m_value, x, y);
+}
+
+// Partition [a, a + n) around the pivot a[0]: elements < pivot to the left of it, the rest to the
+// right. Returns the new pivot position, and sets *done if no elements were swapped.
+STC_INLINE intptr_t
+_c_MEMB(_partition_right_)(_m_value* a, intptr_t n, bool* done) {
+    _m_value *first = a, *last = a + n;
+    while (_c_MEMB(_less_)(++first, a)) ;
+    if (first - 1 == a)
+        while (first < last && !_c_MEMB(_less_)(--last, a)) ;
+    else
+        while (!_c_MEMB(_less_)(--last, a)) ;
+    *done = first >= last;
+
+#if defined _i_default_less // branchless: record the misplaced elements in blocks, then swap them
+    if (first < last) {
+        const _m_value pivot = *a;
+        unsigned char offs_l[_c_sort_block], offs_r[_c_sort_block];
+        _m_value *base_l, *base_r;
+        intptr_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+        c_swap(_m_value, first, last);
+        base_l = ++first, base_r = last;
+        while (first < last) {
+            const intptr_t unknown = last - first;
+            const intptr_t split_l = num_l ? 0 : num_r ? unknown : unknown/2;
+            const intptr_t split_r = num_r ? 0 : unknown - split_l;
+            for (intptr_t i = 0, m = split_l < _c_sort_block ? split_l : _c_sort_block; i < m; ++i) {
+                offs_l[num_l] = (unsigned char)i;
+                num_l += !(*first++ < pivot);
+            }
+            for (intptr_t i = 0, m = split_r < _c_sort_block ? split_r : _c_sort_block; i < m; ) {
+                offs_r[num_r] = (unsigned char)++i;
+                num_r += *--last < pivot;
+            }
+            const intptr_t num = num_l < num_r ? num_l : num_r;
+            if (num && num_l == num_r) { // plain swaps keep descending input O(n)
+                for (intptr_t i = 0; i < num; ++i)
+                    c_swap(_m_value, base_l + offs_l[start_l + i], base_r - offs_r[start_r + i]);
+            } else if (num) { // cyclic permutation: one move per element
+                _m_value *l = base_l + offs_l[start_l], *r = base_r - offs_r[start_r];
+                const _m_value t = *l;
+                *l = *r;
+                for (intptr_t i = 1; i < num; ++i) {
+                    l = base_l + offs_l[start_l + i]; *r = *l;
+                    r = base_r - offs_r[start_r + i]; *l = *r;
+                }
+                *r = t;
+            }
+            num_l -= num, num_r -= num;
+            start_l += num, start_r += num;
+            if (num_l == 0) start_l = 0, base_l = first;
+            if (num_r == 0) start_r = 0, base_r = last;
+        }
+        if (num_l) {
+            while (num_l--)
+                c_swap(_m_value, base_l + offs_l[start_l + num_l], --last);
+            first = last;
+        }
+        if (num_r) {
+            while (num_r--)
+                { c_swap(_m_value, base_r - offs_r[start_r + num_r], first); ++first; }
+        }
+    }
+#else
+    while (first < last) {
+        c_swap(_m_value, first, last);
+        while (_c_MEMB(_less_)(++first, a)) ;
+        while (!_c_MEMB(_less_)(--last, a)) ;
+    }
+#endif
+    --first;
+    c_swap(_m_value, a, first);
+    return first - a;
+}
+
+// Partition with the elements equal to the pivot a[0] to the left. Used when the pivot equals the
+// element before the range, i.e. the range holds no smaller elements. Returns the pivot position.
+STC_INLINE intptr_t
+_c_MEMB(_partition_left_)(_m_value* a, intptr_t n) {
+    _m_value *first = a, *last = a + n;
+    while (_c_MEMB(_less_)(a, --last)) ;
+    if (last + 1 == a + n)
+        while (first < last && !_c_MEMB(_less_)(a, ++first)) ;
+    else
+        while (!_c_MEMB(_less_)(a, ++first)) ;
+    while (first < last) {
+        c_swap(_m_value, first, last);
+        while (_c_MEMB(_less_)(a, --last)) ;
+        while (!_c_MEMB(_less_)(a, ++first)) ;
+    }
+    c_swap(_m_value, a, last);
+    return last - a;
+}
+
+STC_INLINE void
+_c_MEMB(_pdqsort_)(_m_value* a, intptr_t n, int bad_allowed, bool leftmost) {
+    for (;;) {
+        if (n < _c_sort_insertion) {
+            _c_MEMB(_insertion_sort_)(a, n, leftmost);
+            return;
+        }
+        const intptr_t h = n/2;
+        if (n > _c_sort_ninther) {
+            _c_MEMB(_sort3_)(a, a + h, a + n - 1);
+            _c_MEMB(_sort3_)(a + 1, a + h - 1, a + n - 2);
+            _c_MEMB(_sort3_)(a + 2, a + h + 1, a + n - 3);
+            _c_MEMB(_sort3_)(a + h - 1, a + h, a + h + 1);
+            c_swap(_m_value, a, a + h);
+        } else
+            _c_MEMB(_sort3_)(a + h, a, a + n - 1);
+
+        if (!leftmost && !_c_MEMB(_less_)(a - 1, a)) { // many equal elements: skip them
+            const intptr_t p = _c_MEMB(_partition_left_)(a, n) + 1;
+            a += p, n -= p;
+            continue;
+        }
+        bool done;
+        const intptr_t p = _c_MEMB(_partition_right_)(a, n, &done);
+        const intptr_t nl = p, nr = n - p - 1;
+        _m_value* pv = a + p;
+
+        if (nl < n/8 || nr < n/8) { // unbalanced: break up patterns, or give up on quicksort
+            if (--bad_allowed == 0) {
+                _c_MEMB(_heap_sort_)(a, n);
+                return;
+            }
+            if (nl >= _c_sort_insertion) {
+                c_swap(_m_value, a, a + nl/4);
+                c_swap(_m_value, pv - 1, pv - nl/4);
+                if (nl > _c_sort_ninther) {
+                    c_swap(_m_value, a + 1, a + (nl/4 + 1));
+                    c_swap(_m_value, a + 2, a + (nl/4 + 2));
+                    c_swap(_m_value, pv - 2, pv - (nl/4 + 1));
+                    c_swap(_m_value, pv - 3, pv - (nl/4 + 2));
+                }
+            }
+            if (nr >= _c_sort_insertion) {
+                c_swap(_m_value, pv + 1, pv + (1 + nr/4));
+                c_swap(_m_value, a + n - 1, a + n - nr/4);
+                if (nr > _c_sort_ninther) {
+                    c_swap(_m_value, pv + 2, pv + (2 + nr/4));
+                    c_swap(_m_value, pv + 3, pv + (3 + nr/4));
+                    c_swap(_m_value, a + n - 2, a + n - (1 + nr/4));
+                    c_swap(_m_value, a + n - 3, a + n - (2 + nr/4));
+                }
+            }
+        } else if (done && _c_MEMB(_partial_insertion_sort_)(a, nl) &&
+                           _c_MEMB(_partial_insertion_sort_)(pv + 1, nr)) {
+            return; // the partition swapped nothing, and both sides were (nearly) sorted
+        }
+        _c_MEMB(_pdqsort_)(a, nl, bad_allowed, leftmost);
+        a = pv + 1, n = nr;
+        leftmost = false;
+    }
+}
+
+// Sort the n values at a.
+STC_INLINE void
+_c_MEMB(_sort_n_)(_m_value* a, intptr_t n) {
+    int lg = 1;
+    while (n >> lg) ++lg;
+    if (n > 1)
+        _c_MEMB(_pdqsort_)(a, n, lg, true);
+}
+
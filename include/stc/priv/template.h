@@ -49,7 +49,9 @@
 #endif
 
 #if defined i_TYPE && defined _i_ismap
-  #define i_type _c_SEL(_c_SEL31, i_TYPE)
+  #ifndef i_type // may be predefined by a wrapping container, e.g. chmap
+    #define i_type _c_SEL(_c_SEL31, i_TYPE)
+  #endif
   #define i_key _c_SEL(_c_SEL32, i_TYPE)
   #define i_val _c_SEL(_c_SEL33, i_TYPE)
 #elif defined i_TYPE
@@ -220,6 +222,7 @@
   #define i_less(x, y) (i_cmp(x, y)) < 0
 #elif !defined i_less && !defined i_keyraw
   #define i_less(x, y) *x < *y // works for integral types
+  #define _i_default_less      // sorts may use branchless compares
 #endif
 #if !defined i_cmp && defined i_less
   #define i_cmp(x, y) (i_less(y, x)) - (i_less(x, y))
@@ -247,6 +250,7 @@
 #endif
 #ifndef i_keydrop
   #define i_keydrop c_default_drop
+  #define _i_trivial_key // no destructor: bitwise copyable
 #endif
 
 #if defined _i_ismap // ---- process hmap/smap value i_val, ... ----
@@ -304,6 +308,7 @@
 #endif
 #ifndef i_valdrop
   #define i_valdrop c_default_drop
+  #define _i_trivial_val
 #endif
 
 #endif // !_i_ismap
@@ -67,6 +67,9 @@
 
 #undef _i_has_cmp
 #undef _i_has_eq
+#undef _i_default_less
+#undef _i_trivial_key
+#undef _i_trivial_val
 #undef _i_prefix
 #undef _i_template
 
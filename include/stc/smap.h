@@ -72,10 +72,63 @@ int main(void) {
   #define _i_SET_ONLY c_true
   #define _i_keyref(vp) (vp)
 #endif
+#if defined i_parent
+  #define _i_PARENT c_true
+  #define _i_STACK c_false
+#else
+  #define _i_PARENT c_false
+  #define _i_STACK c_true
+#endif
+#if defined i_cow
+  #define _i_COW c_true
+#else
+  #define _i_COW c_false
+#endif
+#if defined i_interval && (defined i_augment || defined i_keyraw || defined i_keyfrom || defined i_keydrop || \
+                           defined i_key_str || defined i_key_ssv || defined i_key_class || defined i_key_arcbox)
+  #error "i_interval requires a bitwise copyable i_key bound type without i_keyraw, and defines i_augment itself"
+#elif defined i_interval && !(defined i_type || defined i_TYPE || defined i_tag)
+  #error "i_interval requires i_type, i_TYPE or i_tag"
+#endif
 #define _i_sorted
 #include "priv/template.h"
+#if defined i_cow && (defined i_parent || !defined _i_trivial_key || !(defined _i_isset || defined _i_trivial_val))
+  #error "i_cow requires bitwise copyable keys and values without drop, and cannot be combined with i_parent"
+#endif
+
+#if defined i_interval
+// The keys are closed intervals [lo, hi] of i_key bounds, ordered by lo, then hi. The bounds are
+// compared with i_cmp. Each node stores the max hi of its subtree, which find_overlapping() uses.
+typedef i_key _c_MEMB(_bound);
+typedef struct { _c_MEMB(_bound) lo, hi; } _c_MEMB(_interval);
+
+STC_INLINE int
+_c_MEMB(_bound_cmp)(const _c_MEMB(_bound)* x, const _c_MEMB(_bound)* y)
+    { return i_cmp(x, y); }
+
+STC_INLINE int
+_c_MEMB(_interval_cmp)(const _c_MEMB(_interval)* x, const _c_MEMB(_interval)* y) {
+    const int c = _c_MEMB(_bound_cmp)(&x->lo, &y->lo);
+    return c ? c : _c_MEMB(_bound_cmp)(&x->hi, &y->hi);
+}
+  #undef i_key
+  #undef i_cmp
+  #undef i_less
+  #undef i_eq
+  #define i_key _c_MEMB(_interval)
+  #define i_cmp(x, y) _c_MEMB(_interval_cmp)(x, y)
+  #define i_less(x, y) (i_cmp(x, y)) < 0
+  #define i_eq(x, y) (i_cmp(x, y)) == 0
+  #define i_aug _c_MEMB(_bound)
+  #define i_augment _c_MEMB(_max_hi_)
+#endif
+#if defined i_augment
+  #define _i_AUG c_true
+#else
+  #define _i_AUG c_false
+#endif
 #ifndef i_is_forward
-  _c_DEFTYPES(_c_aatree_types, i_type, i_key, i_val, _i_MAP_ONLY, _i_SET_ONLY);
+  _c_DEFTYPES(_c_aatree_types_x, i_type, i_key, i_val, _i_MAP_ONLY, _i_SET_ONLY, _i_PARENT, _i_STACK);
 #endif
 
 _i_MAP_ONLY( struct _m_value {
@@ -84,16 +137,40 @@ _i_MAP_ONLY( struct _m_value {
 }; )
 struct _m_node {
     int32_t link[2];
+    _i_PARENT( int32_t parent; )
+#if defined i_ranked
+    int32_t count; // nodes in subtree
+#endif
+    _i_AUG( i_aug aug; ) // summary of the subtree, by i_augment
+    _i_COW( int32_t epoch; ) // shared with snapshots when older than the array epoch
     int8_t level;
     _m_value value;
 };
 
+#if defined i_cow
+// In front of the node array: the number of trees and snapshots sharing it, and the snapshot epoch.
+typedef struct { catomic_long refs; int32_t epoch; } _c_MEMB(_cow_);
+#define _i_COW_SLOTS ((c_sizeof(_c_MEMB(_cow_)) + c_sizeof(struct _m_node) - 1)/c_sizeof(struct _m_node))
+STC_INLINE _c_MEMB(_cow_)* _c_MEMB(_cow_of_)(const struct _m_node* d)
+    { return (_c_MEMB(_cow_)*)(void*)((struct _m_node*)d - _i_COW_SLOTS); }
+#endif
+
 typedef i_keyraw _m_keyraw;
 typedef i_valraw _m_rmapped;
 typedef _i_SET_ONLY( _m_keyraw )
         _i_MAP_ONLY( struct { _m_keyraw first; _m_rmapped second; } )
         _m_raw;
 
+#if defined i_interval
+STC_INLINE void
+_c_MEMB(_max_hi_)(_c_MEMB(_bound)* out, const _m_value* val,
+                  const _c_MEMB(_bound)* left, const _c_MEMB(_bound)* right) {
+    *out = _i_keyref(val)->hi;
+    if (left && _c_MEMB(_bound_cmp)(left, out) > 0) *out = *left;
+    if (right && _c_MEMB(_bound_cmp)(right, out) > 0) *out = *right;
+}
+#endif
+
 #if !defined i_no_emplace
 STC_API _m_result       _c_MEMB(_emplace)(i_type* self, _m_keyraw rkey _i_MAP_ONLY(, _m_rmapped rmapped));
 #endif // !i_no_emplace
@@ -102,6 +179,7 @@ STC_API i_type          _c_MEMB(_clone)(i_type tree);
 #endif // !i_no_clone
 STC_API void            _c_MEMB(_drop)(const i_type* cself);
 STC_API bool            _c_MEMB(_reserve)(i_type* self, intptr_t cap);
+STC_API void            _c_MEMB(_compact)(i_type* self);
 STC_API _m_value*       _c_MEMB(_find_it)(const i_type* self, _m_keyraw rkey, _m_iter* out);
 STC_API _m_iter         _c_MEMB(_lower_bound)(const i_type* self, _m_keyraw rkey);
 STC_API _m_value*       _c_MEMB(_front)(const i_type* self);
@@ -109,8 +187,31 @@ STC_API _m_value*       _c_MEMB(_back)(const i_type* self);
 STC_API int             _c_MEMB(_erase)(i_type* self, _m_keyraw rkey);
 STC_API _m_iter         _c_MEMB(_erase_at)(i_type* self, _m_iter it);
 STC_API _m_iter         _c_MEMB(_erase_range)(i_type* self, _m_iter it1, _m_iter it2);
+STC_API intptr_t        _c_MEMB(_erase_key_range)(i_type* self, _m_keyraw lo, _m_keyraw hi);
+STC_API _m_iter         _c_MEMB(_insert_hint)(i_type* self, _m_iter hint, _m_key key _i_MAP_ONLY(, _m_mapped mapped));
 STC_API _m_iter         _c_MEMB(_begin)(const i_type* self);
 STC_API void            _c_MEMB(_next)(_m_iter* it);
+#if defined i_parent
+STC_API void            _c_MEMB(_prev)(_m_iter* it);
+STC_API _m_iter         _c_MEMB(_rbegin)(const i_type* self);
+#endif
+STC_API i_type          _c_MEMB(_from_sorted_n)(const _m_raw* raw, intptr_t n);
+#if !defined i_no_clone
+STC_API i_type          _c_MEMB(_combine_)(const i_type* a, const i_type* b, int keep, bool move_a);
+STC_API void            _c_MEMB(_merge_into)(i_type* self, const i_type* other);
+#endif
+#if defined i_ranked
+STC_API _m_iter         _c_MEMB(_select)(const i_type* self, intptr_t k);
+STC_API intptr_t        _c_MEMB(_rank)(const i_type* self, _m_keyraw rkey);
+#endif
+#if defined i_augment
+STC_API void            _c_MEMB(_reaugment)(i_type* self, _m_keyraw rkey);
+STC_API void            _c_MEMB(_augment_path_)(i_type* self, _m_keyraw rkey);
+#endif
+#if defined i_interval
+STC_API _m_iter         _c_MEMB(_find_overlapping)(const i_type* self, _c_MEMB(_bound) lo, _c_MEMB(_bound) hi);
+STC_API void            _c_MEMB(_next_overlapping)(_m_iter* it, _c_MEMB(_bound) lo, _c_MEMB(_bound) hi);
+#endif
 
 STC_INLINE i_type       _c_MEMB(_init)(void) { i_type tree = {0}; return tree; }
 STC_INLINE bool         _c_MEMB(_empty)(const i_type* cx) { return cx->size == 0; }
@@ -125,6 +226,14 @@ STC_INLINE const _m_value* _c_MEMB(_get)(const i_type* self, _m_keyraw rkey)
 STC_INLINE _m_value*    _c_MEMB(_get_mut)(i_type* self, _m_keyraw rkey)
                             { _m_iter it; return _c_MEMB(_find_it)(self, rkey, &it); }
 
+#if defined i_ranked
+STC_INLINE intptr_t
+_c_MEMB(_count_range)(const i_type* self, _m_keyraw lo, _m_keyraw hi) {
+    const intptr_t n = _c_MEMB(_rank)(self, hi) - _c_MEMB(_rank)(self, lo);
+    return n > 0 ? n : 0;
+}
+#endif
+
 STC_INLINE i_type
 _c_MEMB(_with_capacity)(const intptr_t cap) {
     i_type tree = _c_MEMB(_init)();
@@ -136,6 +245,24 @@ STC_INLINE void
 _c_MEMB(_clear)(i_type* self)
     { _c_MEMB(_drop)(self); *self = _c_MEMB(_init)(); }
 
+STC_INLINE void
+_c_MEMB(_shrink_to_fit)(i_type *self)
+    { _c_MEMB(_compact)(self); }
+
+#if defined i_cow
+// O(1) read-only view of the tree as it is now. Later inserts and erases in self copy the nodes
+// they would modify. Release the snapshot with drop().
+STC_INLINE i_type
+_c_MEMB(_snapshot)(i_type* self) {
+    if (self->cap) {
+        _c_MEMB(_cow_)* h = _c_MEMB(_cow_of_)(self->nodes);
+        c_atomic_inc(&h->refs);
+        ++h->epoch;
+    }
+    return *self;
+}
+#endif
+
 STC_INLINE _m_raw
 _c_MEMB(_value_toraw)(const _m_value* val) {
     return _i_SET_ONLY( i_keyto(val) )
@@ -159,17 +286,24 @@ _c_MEMB(_value_clone)(_m_value _val) {
 
 STC_INLINE void
 _c_MEMB(_copy)(i_type *self, const i_type* other) {
-    if (self->nodes == other->nodes)
+    if (self == other) // a snapshot shares the nodes, but not root and size
         return;
     _c_MEMB(_drop)(self);
     *self = _c_MEMB(_clone)(*other);
 }
 
-STC_INLINE void
-_c_MEMB(_shrink_to_fit)(i_type *self) {
-    i_type tmp = _c_MEMB(_clone)(*self);
-    _c_MEMB(_drop)(self); *self = tmp;
-}
+// New trees from two trees in O(n + m). Where a key is in both, the element of self is used.
+STC_INLINE i_type
+_c_MEMB(_union)(const i_type* self, const i_type* other)
+    { return _c_MEMB(_combine_)(self, other, 1|2|4, false); }
+
+STC_INLINE i_type
+_c_MEMB(_intersection)(const i_type* self, const i_type* other)
+    { return _c_MEMB(_combine_)(self, other, 2, false); }
+
+STC_INLINE i_type
+_c_MEMB(_difference)(const i_type* self, const i_type* other)
+    { return _c_MEMB(_combine_)(self, other, 1, false); }
 #endif // !i_no_clone
 
 STC_API _m_result _c_MEMB(_insert_entry_)(i_type* self, _m_keyraw rkey);
@@ -182,8 +316,10 @@ STC_API _m_result _c_MEMB(_insert_entry_)(i_type* self, _m_keyraw rkey);
         STC_INLINE _m_result
         _c_MEMB(_emplace_key)(i_type* self, _m_keyraw rkey) {
             _m_result res = _c_MEMB(_insert_entry_)(self, rkey);
-            if (res.inserted)
+            if (res.inserted) {
                 res.ref->first = i_keyfrom(rkey);
+                _i_AUG( _c_MEMB(_augment_path_)(self, rkey); ) // again when the mapped value is assigned
+            }
             return res;
         }
     #endif
@@ -199,7 +335,9 @@ STC_API _m_result _c_MEMB(_insert_entry_)(i_type* self, _m_keyraw rkey);
 STC_INLINE _m_iter
 _c_MEMB(_end)(const i_type* self) {
     _m_iter it; (void)self;
-    it.ref = NULL, it._top = 0, it._tn = 0;
+    it.ref = NULL, it._tn = 0;
+    _i_PARENT( it._d = self->nodes; )
+    _i_STACK( it._top = 0; )
     return it;
 }
 
@@ -210,6 +348,31 @@ _c_MEMB(_advance)(_m_iter it, size_t n) {
     return it;
 }
 
+// First element with key > rkey.
+STC_INLINE _m_iter
+_c_MEMB(_upper_bound)(const i_type* self, _m_keyraw rkey) {
+    _m_iter it = _c_MEMB(_lower_bound)(self, rkey);
+    if (it.ref) {
+        const _m_keyraw _raw = i_keyto(_i_keyref(it.ref));
+        if (i_cmp((&_raw), (&rkey)) == 0)
+            _c_MEMB(_next)(&it);
+    }
+    return it;
+}
+
+// The range [lower_bound, upper_bound) of rkey: the element with key rkey, or an empty range.
+STC_INLINE _c_MEMB(_range)
+_c_MEMB(_equal_range)(const i_type* self, _m_keyraw rkey) {
+    _c_MEMB(_range) r;
+    r.first = r.second = _c_MEMB(_lower_bound)(self, rkey);
+    if (r.second.ref) {
+        const _m_keyraw _raw = i_keyto(_i_keyref(r.second.ref));
+        if (i_cmp((&_raw), (&rkey)) == 0)
+            _c_MEMB(_next)(&r.second);
+    }
+    return r;
+}
+
 #if defined _i_has_eq
 STC_INLINE bool
 _c_MEMB(_eq)(const i_type* self, const i_type* other) {
@@ -226,9 +389,10 @@ _c_MEMB(_eq)(const i_type* self, const i_type* other) {
 STC_INLINE _m_result
 _c_MEMB(_insert)(i_type* self, _m_key _key _i_MAP_ONLY(, _m_mapped _mapped)) {
     _m_result _res = _c_MEMB(_insert_entry_)(self, i_keyto((&_key)));
-    if (_res.inserted)
-        { *_i_keyref(_res.ref) = _key; _i_MAP_ONLY( _res.ref->second = _mapped; )}
-    else
+    if (_res.inserted) {
+        *_i_keyref(_res.ref) = _key; _i_MAP_ONLY( _res.ref->second = _mapped; )
+        _i_AUG( _c_MEMB(_augment_path_)(self, i_keyto((&_key))); )
+    } else
         { i_keydrop((&_key)); _i_MAP_ONLY( i_valdrop((&_mapped)); )}
     return _res;
 }
@@ -236,9 +400,10 @@ _c_MEMB(_insert)(i_type* self, _m_key _key _i_MAP_ONLY(, _m_mapped _mapped)) {
 STC_INLINE _m_value*
 _c_MEMB(_push)(i_type* self, _m_value _val) {
     _m_result _res = _c_MEMB(_insert_entry_)(self, i_keyto(_i_keyref(&_val)));
-    if (_res.inserted)
+    if (_res.inserted) {
         *_res.ref = _val;
-    else
+        _i_AUG( _c_MEMB(_augment_path_)(self, i_keyto(_i_keyref(&_val))); )
+    } else
         _c_MEMB(_value_drop)(&_val);
     return _res.ref;
 }
@@ -264,6 +429,54 @@ _c_MEMB(_from_n)(const _m_raw* raw, intptr_t n)
 /* -------------------------- IMPLEMENTATION ------------------------- */
 #if defined(i_implement) || defined(i_static)
 
+#if defined i_parent
+// In-order neighbor of node tn in direction dir (1: next, 0: prev) via the parent links, or 0.
+static int32_t
+_c_MEMB(_step_)(const _m_node* d, int32_t tn, int dir) {
+    int32_t p;
+    if (d[tn].link[dir]) {
+        tn = d[tn].link[dir];
+        while (d[tn].link[!dir])
+            tn = d[tn].link[!dir];
+        return tn;
+    }
+    while ((p = d[tn].parent) && d[p].link[dir] == tn)
+        tn = p;
+    return p;
+}
+
+STC_DEF void
+_c_MEMB(_next)(_m_iter *it) {
+    it->_tn = _c_MEMB(_step_)(it->_d, it->_tn, 1);
+    it->ref = it->_tn ? &it->_d[it->_tn].value : NULL;
+}
+
+STC_DEF void
+_c_MEMB(_prev)(_m_iter *it) {
+    it->_tn = _c_MEMB(_step_)(it->_d, it->_tn, 0);
+    it->ref = it->_tn ? &it->_d[it->_tn].value : NULL;
+}
+
+// Iterator at the leftmost (dir 0) or rightmost (dir 1) node.
+static _m_iter
+_c_MEMB(_edge_)(const i_type* self, int dir) {
+    _m_iter it = _c_MEMB(_end)(self);
+    if ((it._tn = self->root)) {
+        while (it._d[it._tn].link[dir])
+            it._tn = it._d[it._tn].link[dir];
+        it.ref = &it._d[it._tn].value;
+    }
+    return it;
+}
+
+STC_DEF _m_iter
+_c_MEMB(_begin)(const i_type* self)
+    { return _c_MEMB(_edge_)(self, 0); }
+
+STC_DEF _m_iter
+_c_MEMB(_rbegin)(const i_type* self)
+    { return _c_MEMB(_edge_)(self, 1); }
+#else
 STC_DEF void
 _c_MEMB(_next)(_m_iter *it) {
     int32_t tn = it->_tn;
@@ -289,15 +502,42 @@ _c_MEMB(_begin)(const i_type* self) {
         _c_MEMB(_next)(&it);
     return it;
 }
+#endif // i_parent
+
+// Free the node array, unless it is still shared with a snapshot.
+static void
+_c_MEMB(_free_nodes_)(i_type* self) {
+#if defined i_cow
+    _c_MEMB(_cow_)* h = _c_MEMB(_cow_of_)(self->nodes);
+    if (c_atomic_dec_and_test(&h->refs))
+        i_free(h, (self->cap + 1 + _i_COW_SLOTS)*c_sizeof(_m_node));
+#else
+    i_free(self->nodes, (self->cap + 1)*c_sizeof(_m_node));
+#endif
+}
 
 STC_DEF bool
 _c_MEMB(_reserve)(i_type* self, const intptr_t cap) {
     if (cap <= self->cap)
         return false;
+#if defined i_cow // always a new array, as the current may be shared
+    _c_MEMB(_cow_)* h = (_c_MEMB(_cow_)*)i_malloc((cap + 1 + _i_COW_SLOTS)*c_sizeof(_m_node));
+    if (!h)
+        return false;
+    h->refs = 1, h->epoch = 0;
+    _m_node* nodes = (_m_node*)(void*)h + _i_COW_SLOTS;
+    if (self->cap) {
+        c_memcpy(nodes, self->nodes, (self->head + 1)*c_sizeof(_m_node));
+        for (int32_t i = 1; i <= self->head; ++i)
+            nodes[i].epoch = 0; // not shared
+        _c_MEMB(_free_nodes_)(self);
+    }
+#else
     _m_node* nodes = (_m_node*)i_realloc(self->nodes, (self->cap + 1)*c_sizeof(_m_node),
                                                       (cap + 1)*c_sizeof(_m_node));
     if (!nodes)
         return false;
+#endif
     nodes[0] = c_LITERAL(_m_node){0};
     self->nodes = nodes;
     self->cap = (int32_t)cap;
@@ -336,9 +576,34 @@ _c_MEMB(_new_node_)(i_type* self, int level) {
     }
     _m_node* dn = &self->nodes[tn];
     dn->link[0] = dn->link[1] = 0; dn->level = (int8_t)level;
+    _i_AUG( c_memset(&dn->value, 0, c_sizeof dn->value); ) // read by i_augment until it is assigned
+    _i_COW( dn->epoch = _c_MEMB(_cow_of_)(self->nodes)->epoch; )
     return tn;
 }
 
+#if defined i_cow
+// Node tn, or a copy of it if a snapshot may share it. The caller links the copy into its parent.
+static int32_t
+_c_MEMB(_own_)(i_type* self, int32_t tn) {
+    _m_node* d = self->nodes;
+    const int32_t epoch = _c_MEMB(_cow_of_)(d)->epoch;
+    if (tn == 0 || d[tn].epoch == epoch)
+        return tn;
+    const int32_t tx = _c_MEMB(_new_node_)(self, 0);
+    d[tx] = d[tn];
+    d[tx].epoch = epoch;
+    return tx;
+}
+
+// Reserve nodes for the copies one insert or erase may make: the search path and the rotated
+// nodes. The array is then not reallocated while the nodes are modified.
+static void
+_c_MEMB(_cow_prepare_)(i_type* self) {
+    if (self->cap - self->head < 3*64 + 1)
+        _c_MEMB(_reserve)(self, self->head*3/2 + 3*64 + 1);
+}
+#endif
+
 #ifdef _i_ismap
     STC_DEF _m_result
     _c_MEMB(_insert_or_assign)(i_type* self, _m_key _key, _m_mapped _mapped) {
@@ -349,6 +614,7 @@ _c_MEMB(_new_node_)(i_type* self, int level) {
         else
             { i_keydrop((&_key)); i_valdrop(_mp); }
         *_mp = _mapped;
+        _i_AUG( if (_res.ref) _c_MEMB(_augment_path_)(self, i_keyto((&_res.ref->first))); )
         return _res;
     }
 
@@ -363,6 +629,7 @@ _c_MEMB(_new_node_)(i_type* self, int level) {
             i_valdrop((&_res.ref->second));
         }
         _res.ref->second = i_valfrom(rmapped);
+        _i_AUG( _c_MEMB(_augment_path_)(self, rkey); )
         return _res;
     }
     #endif // !i_no_emplace
@@ -372,15 +639,21 @@ STC_DEF _m_value*
 _c_MEMB(_find_it)(const i_type* self, _m_keyraw rkey, _m_iter* out) {
     int32_t tn = self->root;
     _m_node *d = out->_d = self->nodes;
-    out->_top = 0;
+    _i_STACK( out->_top = 0; )
+    _i_PARENT( out->_tn = 0; ) // when not found: the closest greater node
     while (tn) {
         int c; const _m_keyraw _raw = i_keyto(_i_keyref(&d[tn].value));
         if ((c = i_cmp((&_raw), (&rkey))) < 0)
             tn = d[tn].link[1];
-        else if (c > 0)
-            { out->_st[out->_top++] = tn; tn = d[tn].link[0]; }
-        else
-            { out->_tn = d[tn].link[1]; return (out->ref = &d[tn].value); }
+        else if (c > 0) {
+            _i_STACK( out->_st[out->_top++] = tn; )
+            _i_PARENT( out->_tn = tn; )
+            tn = d[tn].link[0];
+        } else {
+            _i_STACK( out->_tn = d[tn].link[1]; )
+            _i_PARENT( out->_tn = tn; )
+            return (out->ref = &d[tn].value);
+        }
     }
     return (out->ref = NULL);
 }
@@ -389,31 +662,105 @@ STC_DEF _m_iter
 _c_MEMB(_lower_bound)(const i_type* self, _m_keyraw rkey) {
     _m_iter it;
     _c_MEMB(_find_it)(self, rkey, &it);
+#if defined i_parent
+    if (!it.ref && it._tn)
+        it.ref = &it._d[it._tn].value;
+#else
     if (!it.ref && it._top) {
         int32_t tn = it._st[--it._top];
         it._tn = it._d[tn].link[1];
         it.ref = &it._d[tn].value;
     }
+#endif
+    return it;
+}
+
+// Recompute the subtree data of node tn from its children, and link the children back to tn.
+STC_INLINE void
+_c_MEMB(_update_)(_m_node *d, int32_t tn) {
+#if defined i_ranked
+    d[tn].count = d[d[tn].link[0]].count + d[d[tn].link[1]].count + 1;
+#endif
+#if defined i_augment
+    const int32_t l = d[tn].link[0], r = d[tn].link[1];
+    i_augment((&d[tn].aug), (&d[tn].value), (l ? &d[l].aug : NULL), (r ? &d[r].aug : NULL));
+#endif
+    _i_PARENT( d[d[tn].link[0]].parent = d[d[tn].link[1]].parent = tn; )
+    (void)d; (void)tn;
+}
+
+#if defined i_ranked
+STC_DEF _m_iter
+_c_MEMB(_select)(const i_type* self, intptr_t k) {
+    _m_iter it;
+    _m_node *d = it._d = self->nodes;
+    int32_t tn = self->root;
+    _i_STACK( it._top = 0; )
+    if (k >= 0 && k < self->size) {
+        for (;;) {
+            const int32_t nl = d[d[tn].link[0]].count;
+            if (k < nl) {
+                _i_STACK( it._st[it._top++] = tn; )
+                tn = d[tn].link[0];
+            } else if (k > nl) {
+                k -= nl + 1; tn = d[tn].link[1];
+            } else {
+                _i_STACK( it._tn = d[tn].link[1]; )
+                _i_PARENT( it._tn = tn; )
+                it.ref = &d[tn].value;
+                return it;
+            }
+        }
+    }
+    it.ref = NULL, it._tn = 0;
+    _i_STACK( it._top = 0; )
     return it;
 }
 
+STC_DEF intptr_t
+_c_MEMB(_rank)(const i_type* self, _m_keyraw rkey) {
+    const _m_node *d = self->nodes;
+    int32_t tn = self->root;
+    intptr_t r = 0;
+    while (tn) {
+        const _m_keyraw _raw = i_keyto(_i_keyref(&d[tn].value));
+        const int c = i_cmp((&_raw), (&rkey));
+        if (c < 0)
+            { r += d[d[tn].link[0]].count + 1; tn = d[tn].link[1]; }
+        else if (c > 0)
+            tn = d[tn].link[0];
+        else
+            return r + d[d[tn].link[0]].count;
+    }
+    return r;
+}
+#endif // i_ranked
+
 STC_DEF int32_t
-_c_MEMB(_skew_)(_m_node *d, int32_t tn) {
+_c_MEMB(_skew_)(i_type* self, int32_t tn) {
+    _m_node *d = self->nodes;
     if (tn && d[d[tn].link[0]].level == d[tn].level) {
         int32_t tmp = d[tn].link[0];
+        _i_COW( tn = _c_MEMB(_own_)(self, tn); tmp = _c_MEMB(_own_)(self, tmp); )
         d[tn].link[0] = d[tmp].link[1];
         d[tmp].link[1] = tn;
+        _c_MEMB(_update_)(d, tn);
+        _c_MEMB(_update_)(d, tmp);
         tn = tmp;
     }
     return tn;
 }
 
 STC_DEF int32_t
-_c_MEMB(_split_)(_m_node *d, int32_t tn) {
+_c_MEMB(_split_)(i_type* self, int32_t tn) {
+    _m_node *d = self->nodes;
     if (d[d[d[tn].link[1]].link[1]].level == d[tn].level) {
         int32_t tmp = d[tn].link[1];
+        _i_COW( tn = _c_MEMB(_own_)(self, tn); tmp = _c_MEMB(_own_)(self, tmp); )
         d[tn].link[1] = d[tmp].link[0];
         d[tmp].link[0] = tn;
+        _c_MEMB(_update_)(d, tn);
+        _c_MEMB(_update_)(d, tmp);
         tn = tmp;
         ++d[tn].level;
     }
@@ -426,6 +773,10 @@ _c_MEMB(_insert_entry_i_)(i_type* self, int32_t tn, const _m_keyraw* rkey, _m_re
     _m_node* d = self->nodes;
     int c, top = 0, dir = 0;
     while (tx) {
+    #if defined i_cow // copy the path down from the root, also when the key is found
+        tx = _c_MEMB(_own_)(self, tx);
+        if (top) d[up[top - 1]].link[dir] = tx; else tn = tx;
+    #endif
         up[top++] = tx;
         const _m_keyraw _raw = i_keyto(_i_keyref(&d[tx].value));
         if (!(c = i_cmp((&_raw), rkey)))
@@ -436,6 +787,7 @@ _c_MEMB(_insert_entry_i_)(i_type* self, int32_t tn, const _m_keyraw* rkey, _m_re
     if ((tx = _c_MEMB(_new_node_)(self, 1)) == 0)
         return 0;
     d = self->nodes;
+    _c_MEMB(_update_)(d, tx);
     _res->ref = &d[tx].value;
     _res->inserted = true;
     if (top == 0)
@@ -444,8 +796,9 @@ _c_MEMB(_insert_entry_i_)(i_type* self, int32_t tn, const _m_keyraw* rkey, _m_re
     while (top--) {
         if (top)
             dir = (d[up[top - 1]].link[1] == up[top]);
-        up[top] = _c_MEMB(_skew_)(d, up[top]);
-        up[top] = _c_MEMB(_split_)(d, up[top]);
+        _c_MEMB(_update_)(d, up[top]);
+        up[top] = _c_MEMB(_skew_)(self, up[top]);
+        up[top] = _c_MEMB(_split_)(self, up[top]);
         if (top)
             d[up[top - 1]].link[dir] = up[top];
     }
@@ -455,59 +808,83 @@ _c_MEMB(_insert_entry_i_)(i_type* self, int32_t tn, const _m_keyraw* rkey, _m_re
 STC_DEF _m_result
 _c_MEMB(_insert_entry_)(i_type* self, _m_keyraw rkey) {
     _m_result res = {NULL};
+    _i_COW( _c_MEMB(_cow_prepare_)(self); )
     int32_t tn = _c_MEMB(_insert_entry_i_)(self, self->root, &rkey, &res);
     self->root = tn;
+    _i_PARENT( if (tn) self->nodes[tn].parent = 0; )
     self->size += res.inserted;
     return res;
 }
 
-STC_DEF int32_t
-_c_MEMB(_erase_r_)(i_type *self, int32_t tn, const _m_keyraw* rkey, int *erased) {
+// Descend to rkey and record the path, then unlink the node, or the node of its predecessor after
+// moving the predecessor into it. Rebalance bottom-up along the path.
+STC_DEF int
+_c_MEMB(_erase)(i_type* self, _m_keyraw rkey) {
+    int32_t up[64], tn = self->root, tx;
+    int8_t dir[64];
+    int top = 0, c;
+    _i_COW( _c_MEMB(_cow_prepare_)(self); )
     _m_node *d = self->nodes;
+    while (tn) {
+    #if defined i_cow // copy the path down from the root, also when the key is not found
+        tn = _c_MEMB(_own_)(self, tn);
+        if (top) d[up[top - 1]].link[dir[top - 1]] = tn; else self->root = tn;
+    #endif
+        up[top] = tn;
+        const _m_keyraw _raw = i_keyto(_i_keyref(&d[tn].value));
+        if ((c = i_cmp((&_raw), (&rkey))) == 0)
+            break;
+        dir[top++] = (int8_t)(c < 0);
+        tn = d[tn].link[c < 0];
+    }
     if (tn == 0)
         return 0;
-    _m_keyraw raw = i_keyto(_i_keyref(&d[tn].value));
-    int32_t tx; int c = i_cmp((&raw), rkey);
-    if (c != 0)
-        d[tn].link[c < 0] = _c_MEMB(_erase_r_)(self, d[tn].link[c < 0], rkey, erased);
-    else {
-        if (!(*erased)++)
-            _c_MEMB(_value_drop)(&d[tn].value);
-        if (d[tn].link[0] && d[tn].link[1]) {
-            tx = d[tn].link[0];
-            while (d[tx].link[1])
-                tx = d[tx].link[1];
-            d[tn].value = d[tx].value; /* move */
-            raw = i_keyto(_i_keyref(&d[tn].value));
-            d[tn].link[0] = _c_MEMB(_erase_r_)(self, d[tn].link[0], &raw, erased);
-        } else { /* unlink node */
-            tx = tn;
-            tn = d[tn].link[ d[tn].link[0] == 0 ];
-            /* move it to disposed nodes list */
-            d[tx].link[1] = self->disp;
-            self->disp = tx;
+    _c_MEMB(_value_drop)(&d[tn].value);
+    if (d[tn].link[0] && d[tn].link[1]) {
+        const int32_t found = tn;
+        dir[top++] = 0;
+        for (tn = d[tn].link[0]; ; tn = d[tn].link[1]) {
+        #if defined i_cow
+            tn = _c_MEMB(_own_)(self, tn);
+            d[up[top - 1]].link[dir[top - 1]] = tn;
+        #endif
+            up[top] = tn;
+            if (d[tn].link[1] == 0)
+                break;
+            dir[top++] = 1;
         }
+        d[found].value = d[tn].value; /* move */
     }
-    tx = d[tn].link[1];
-    if (d[d[tn].link[0]].level < d[tn].level - 1 || d[tx].level < d[tn].level - 1) {
-        if (d[tx].level > --d[tn].level)
-            d[tx].level = d[tn].level;
-                       tn = _c_MEMB(_skew_)(d, tn);
-       tx = d[tn].link[1] = _c_MEMB(_skew_)(d, d[tn].link[1]);
-            d[tx].link[1] = _c_MEMB(_skew_)(d, d[tx].link[1]);
-                       tn = _c_MEMB(_split_)(d, tn);
-            d[tn].link[1] = _c_MEMB(_split_)(d, d[tn].link[1]);
-    }
-    return tn;
-}
+    /* unlink node tn, and move it to disposed nodes list */
+    tx = d[tn].link[d[tn].link[0] == 0];
+    d[tn].link[1] = self->disp;
+    self->disp = tn;
+    if (top) d[up[top - 1]].link[dir[top - 1]] = tx; else self->root = tx;
 
-STC_DEF int
-_c_MEMB(_erase)(i_type* self, _m_keyraw rkey) {
-    int erased = 0;
-    int32_t root = _c_MEMB(_erase_r_)(self, self->root, &rkey, &erased);
-    if (!erased)
-        return 0;
-    self->root = root;
+    while (top--) {
+        tn = up[top];
+        _c_MEMB(_update_)(d, tn);
+        tx = d[tn].link[1];
+        if (d[d[tn].link[0]].level < d[tn].level - 1 || d[tx].level < d[tn].level - 1) {
+            if (d[tx].level > --d[tn].level) {
+                _i_COW( tx = d[tn].link[1] = _c_MEMB(_own_)(self, tx); )
+                d[tx].level = d[tn].level;
+            }
+                           tn = _c_MEMB(_skew_)(self, tn);
+           tx = d[tn].link[1] = _c_MEMB(_skew_)(self, d[tn].link[1]);
+            _i_COW( tx = d[tn].link[1] = _c_MEMB(_own_)(self, tx); )
+            if (tx)     d[tx].link[1] = _c_MEMB(_skew_)(self, d[tx].link[1]);
+                           tn = _c_MEMB(_split_)(self, tn);
+                d[tn].link[1] = _c_MEMB(_split_)(self, d[tn].link[1]);
+            #if defined i_parent // relink the right spine; the rotations kept the subtree counts
+                if (tx) _c_MEMB(_update_)(d, tx);
+                if ((tx = d[tn].link[1])) _c_MEMB(_update_)(d, tx);
+                _c_MEMB(_update_)(d, tn);
+            #endif
+        }
+        if (top) d[up[top - 1]].link[dir[top - 1]] = tn; else self->root = tn;
+    }
+    _i_PARENT( if (self->root) d[self->root].parent = 0; )
     --self->size;
     return 1;
 }
@@ -525,25 +902,333 @@ _c_MEMB(_erase_at)(i_type* self, _m_iter it) {
     return it;
 }
 
+// Link the nodes [lo, hi], in key order, into a perfectly balanced tree. The left subtree gets the
+// smaller half, so that the levels floor(log2(size + 1)) of the subtrees satisfy the AA-tree rules.
+static int32_t
+_c_MEMB(_build_r_)(_m_node* d, int32_t lo, int32_t hi) {
+    if (lo > hi)
+        return 0;
+    const int32_t mid = lo + (hi - lo)/2;
+    d[mid].link[0] = _c_MEMB(_build_r_)(d, lo, mid - 1);
+    d[mid].link[1] = _c_MEMB(_build_r_)(d, mid + 1, hi);
+    d[mid].level = (int8_t)(d[d[mid].link[0]].level + 1);
+    _i_COW( d[mid].epoch = 0; ) // in a new array
+    _c_MEMB(_update_)(d, mid);
+    return mid;
+}
+
+// Make a tree of the nodes [1, m], which hold the elements in key order.
+static void
+_c_MEMB(_link_sorted_)(i_type* tree, int32_t m) {
+    tree->root = _c_MEMB(_build_r_)(tree->nodes, 1, m);
+    _i_PARENT( if (tree->root) tree->nodes[tree->root].parent = 0; )
+    tree->head = tree->size = m;
+}
+
+// Move the elements to a node array of the exact size, numbered in key order, and relink them
+// into a balanced tree. The free list of erased nodes is released. If first is an element, it and
+// the n - 1 elements after it are dropped instead. Returns the node of the element after those, 0
+// if none, or -1 if the allocation failed.
+static int32_t
+_c_MEMB(_rebuild_)(i_type* self, const _m_value* first, intptr_t n) {
+    i_type tree = _c_MEMB(_with_capacity)(self->size - n);
+    if (tree.cap < self->size - n)
+        return -1;
+    int32_t m = 0, after = 0;
+    for (_m_iter it = _c_MEMB(_begin)(self); it.ref; _c_MEMB(_next)(&it)) {
+        if (it.ref == first) {
+            after = m + 1;
+            first = NULL;
+        }
+        if (after && n) {
+            _c_MEMB(_value_drop)(it.ref);
+            --n;
+        } else
+            tree.nodes[++m].value = *it.ref;
+    }
+    _c_MEMB(_link_sorted_)(&tree, m);
+    if (self->cap)
+        _c_MEMB(_free_nodes_)(self);
+    *self = tree;
+    return after > m ? 0 : after;
+}
+
+STC_DEF void
+_c_MEMB(_compact)(i_type* self)
+    { _c_MEMB(_rebuild_)(self, NULL, 0); }
+
+// Iterator at node tn, or end if tn is 0.
+static _m_iter
+_c_MEMB(_iter_at_)(const i_type* self, int32_t tn) {
+    _m_iter it = _c_MEMB(_end)(self);
+#if defined i_parent
+    if (tn) it._tn = tn, it.ref = &self->nodes[tn].value;
+#else
+    if (tn) _c_MEMB(_find_it)(self, i_keyto(_i_keyref(&self->nodes[tn].value)), &it);
+#endif
+    return it;
+}
+
+// Erase the elements from it up to key *hi, or to the end if hi is NULL. When they are more than
+// about size/log2(size), it rebuilds the tree from the remaining elements in O(n), instead of one
+// descent per element. Returns the iterator after the erased elements.
+static _m_iter
+_c_MEMB(_erase_bounds_)(i_type* self, _m_iter it, const _m_keyraw* hi) {
+    intptr_t k = 0;
+    int lg = 1;
+    while (self->size >> lg) ++lg;
+    for (_m_iter j = it; j.ref; _c_MEMB(_next)(&j), ++k) {
+        const _m_keyraw _raw = i_keyto(_i_keyref(j.ref));
+        if (hi && i_cmp((&_raw), hi) >= 0)
+            break;
+    }
+    if (k*lg >= self->size && k > 1) {
+        const int32_t tn = _c_MEMB(_rebuild_)(self, it.ref, k);
+        if (tn >= 0)
+            return _c_MEMB(_iter_at_)(self, tn);
+    }
+    while (k--)
+        it = _c_MEMB(_erase_at)(self, it);
+    return it;
+}
+
 STC_DEF _m_iter
 _c_MEMB(_erase_range)(i_type* self, _m_iter it1, _m_iter it2) {
-    if (!it2.ref) {
-        while (it1.ref)
-            it1 = _c_MEMB(_erase_at)(self, it1);
-        return it1;
+    if (!it2.ref)
+        return _c_MEMB(_erase_bounds_)(self, it1, NULL);
+    const _m_keyraw hi = i_keyto(_i_keyref(it2.ref));
+    return _c_MEMB(_erase_bounds_)(self, it1, &hi);
+}
+
+STC_DEF intptr_t
+_c_MEMB(_erase_key_range)(i_type* self, _m_keyraw lo, _m_keyraw hi) {
+    const intptr_t n = self->size;
+    _c_MEMB(_erase_bounds_)(self, _c_MEMB(_lower_bound)(self, lo), &hi);
+    return n - self->size;
+}
+
+#if defined i_augment
+// Recompute the subtree summaries on the path from the root to rkey, e.g. after its mapped value
+// was modified in place.
+STC_DEF void
+_c_MEMB(_reaugment)(i_type* self, _m_keyraw rkey) {
+    _i_COW( _c_MEMB(_cow_prepare_)(self); )
+    _c_MEMB(_augment_path_)(self, rkey);
+}
+
+// As reaugment, after an insert: that copied the path already, so no nodes are allocated
+// and refs into the node array stay valid.
+STC_DEF void
+_c_MEMB(_augment_path_)(i_type* self, _m_keyraw rkey) {
+    int32_t up[64], tn = self->root;
+    int top = 0, c = 0;
+    if (tn == 0)
+        return;
+    _m_node* d = self->nodes;
+    while (tn) {
+    #if defined i_cow
+        tn = _c_MEMB(_own_)(self, tn);
+        if (top) d[up[top - 1]].link[c < 0] = tn; else self->root = tn;
+    #endif
+        up[top++] = tn;
+        const _m_keyraw _raw = i_keyto(_i_keyref(&d[tn].value));
+        if ((c = i_cmp((&_raw), (&rkey))) == 0)
+            break;
+        tn = d[tn].link[c < 0];
     }
-    _m_key k1 = *_i_keyref(it1.ref), k2 = *_i_keyref(it2.ref);
-    _m_keyraw r1 = i_keyto((&k1));
+    while (top--)
+        _c_MEMB(_update_)(d, up[top]);
+}
+#endif
+
+#if defined i_interval
+// An in-order walk that skips the subtrees whose max hi is below lo, and stops at the first node with
+// lo above hi. The nodes visited are O(log n) per overlapping interval found.
+#if defined i_parent
+// The next node after tn (0: before the first) that overlaps [*lo, *hi], searching its subtree sub first.
+static int32_t
+_c_MEMB(_overlap_next_)(const _m_node* d, int32_t tn, int32_t sub,
+                        const _c_MEMB(_bound)* lo, const _c_MEMB(_bound)* hi) {
     for (;;) {
-        if (memcmp(&k1, &k2, sizeof k1) == 0)
-            return it1;
-        _c_MEMB(_next)(&it1);
-        k1 = *_i_keyref(it1.ref);
-        _c_MEMB(_erase)(self, r1);
-        r1 = i_keyto((&k1));
-        _c_MEMB(_find_it)(self, r1, &it1);
+        if (sub && _c_MEMB(_bound_cmp)(&d[sub].aug, lo) >= 0) {
+            tn = sub;
+            while ((sub = d[tn].link[0]) && _c_MEMB(_bound_cmp)(&d[sub].aug, lo) >= 0)
+                tn = sub;
+        } else { // up to the first ancestor that has tn in its left subtree
+            int32_t p = 0;
+            if (tn)
+                while ((p = d[tn].parent) && d[p].link[1] == tn)
+                    tn = p;
+            if ((tn = p) == 0)
+                return 0;
+        }
+        const _m_key* key = _i_keyref(&d[tn].value);
+        if (_c_MEMB(_bound_cmp)(&key->lo, hi) > 0)
+            return 0;
+        if (_c_MEMB(_bound_cmp)(&key->hi, lo) >= 0)
+            return tn;
+        sub = d[tn].link[1];
     }
 }
+#else
+// Advance it to the next node that overlaps [*lo, *hi]. The stack holds the ancestors still to visit.
+static void
+_c_MEMB(_overlap_next_)(_m_iter* it, const _c_MEMB(_bound)* lo, const _c_MEMB(_bound)* hi) {
+    _m_node* d = it->_d;
+    for (;;) {
+        int32_t tn = it->_tn;
+        while (tn && _c_MEMB(_bound_cmp)(&d[tn].aug, lo) >= 0) {
+            it->_st[it->_top++] = tn;
+            tn = d[tn].link[0];
+        }
+        if (it->_top == 0)
+            break;
+        tn = it->_st[--it->_top];
+        const _m_key* key = _i_keyref(&d[tn].value);
+        if (_c_MEMB(_bound_cmp)(&key->lo, hi) > 0)
+            break;
+        it->_tn = d[tn].link[1];
+        if (_c_MEMB(_bound_cmp)(&key->hi, lo) >= 0)
+            { it->ref = &d[tn].value; return; }
+    }
+    it->ref = NULL, it->_tn = 0, it->_top = 0;
+}
+#endif
+
+STC_DEF _m_iter
+_c_MEMB(_find_overlapping)(const i_type* self, _c_MEMB(_bound) lo, _c_MEMB(_bound) hi) {
+    _m_iter it = _c_MEMB(_end)(self);
+#if defined i_parent
+    if ((it._tn = _c_MEMB(_overlap_next_)(self->nodes, 0, self->root, &lo, &hi)))
+        it.ref = &self->nodes[it._tn].value;
+#else
+    it._d = self->nodes, it._tn = self->root;
+    _c_MEMB(_overlap_next_)(&it, &lo, &hi);
+#endif
+    return it;
+}
+
+STC_DEF void
+_c_MEMB(_next_overlapping)(_m_iter* it, _c_MEMB(_bound) lo, _c_MEMB(_bound) hi) {
+#if defined i_parent
+    if (it->_tn)
+        it->_tn = _c_MEMB(_overlap_next_)(it->_d, it->_tn, it->_d[it->_tn].link[1], &lo, &hi);
+    it->ref = it->_tn ? &it->_d[it->_tn].value : NULL;
+#else
+    _c_MEMB(_overlap_next_)(it, &lo, &hi);
+#endif
+}
+#endif // i_interval
+
+#if defined i_parent
+// Insert rkey next to node hint (0: after the last node) if it belongs there, with one or two
+// compares. The new node is a leaf, and the rebalance walks up the parent links only until two
+// nodes in a row are unchanged, which is amortized O(1) (with i_ranked, the counts up to the root
+// are updated). Otherwise, insert from the root. Returns the node of rkey.
+static int32_t
+_c_MEMB(_insert_hint_entry_)(i_type* self, int32_t hint, _m_keyraw rkey, _m_result* res) {
+    _m_node* d = self->nodes;
+    int32_t a, b = 0, x, tn, tx; // insert between a and b, after comparing rkey with x
+    int c;
+    if (self->root == 0)
+        goto from_root;
+    if (hint == 0) {
+        for (a = self->root; d[a].link[1]; a = d[a].link[1]) ;
+        x = a;
+    } else {
+        const _m_keyraw _raw = i_keyto(_i_keyref(&d[hint].value));
+        if ((c = i_cmp((&_raw), (&rkey))) == 0)
+            { res->ref = &d[hint].value; return hint; }
+        if (c > 0) b = hint, a = x = _c_MEMB(_step_)(d, b, 0);
+        else       a = hint, b = x = _c_MEMB(_step_)(d, a, 1);
+    }
+    if (x) {
+        const _m_keyraw _raw = i_keyto(_i_keyref(&d[x].value));
+        if ((c = i_cmp((&_raw), (&rkey))) == 0)
+            { res->ref = &d[x].value; return x; }
+        if ((x == a) != (c < 0))
+            goto from_root;
+    }
+
+    if ((tx = _c_MEMB(_new_node_)(self, 1)) == 0)
+        return 0;
+    d = self->nodes;
+    tn = a && d[a].link[1] == 0 ? a : b; // the predecessor or the successor has a free link
+    d[tn].link[tn == a] = tx;
+    _c_MEMB(_update_)(d, tx);
+    res->ref = &d[tx].value;
+    res->inserted = true;
+    ++self->size;
+    for (int quiet = 0; tn && quiet < 2; ) {
+        const int32_t up = d[tn].parent;
+        const int dir = (d[up].link[1] == tn), level = d[tn].level;
+        _c_MEMB(_update_)(d, tn);
+        tx = _c_MEMB(_skew_)(self, tn);
+        tx = _c_MEMB(_split_)(self, tx);
+        quiet = tx == tn && d[tx].level == level ? quiet + 1 : 0; // skew + split may return tn
+        d[tx].parent = up;
+        if (up) d[up].link[dir] = tx; else self->root = tx;
+        tn = up;
+    }
+#if defined i_ranked
+    for (; tn; tn = d[tn].parent)
+        _c_MEMB(_update_)(d, tn);
+#endif
+    return (int32_t)(c_container_of(res->ref, _m_node, value) - d);
+
+    from_root:
+    *res = _c_MEMB(_insert_entry_)(self, rkey);
+    return res->ref ? (int32_t)(c_container_of(res->ref, _m_node, value) - self->nodes) : 0;
+}
+#endif
+
+STC_DEF _m_iter
+_c_MEMB(_insert_hint)(i_type* self, _m_iter hint, _m_key _key _i_MAP_ONLY(, _m_mapped _mapped)) {
+    _m_result _res = {NULL};
+#if defined i_parent
+    const int32_t tn = _c_MEMB(_insert_hint_entry_)(self, hint.ref ? hint._tn : 0, i_keyto((&_key)), &_res);
+#else
+    (void)hint; // no parent links: insert from the root
+    _res = _c_MEMB(_insert_entry_)(self, i_keyto((&_key)));
+    const int32_t tn = _res.ref ? (int32_t)(c_container_of(_res.ref, _m_node, value) - self->nodes) : 0;
+#endif
+    if (_res.inserted) {
+        *_i_keyref(_res.ref) = _key; _i_MAP_ONLY( _res.ref->second = _mapped; )
+        _i_AUG( _c_MEMB(_augment_path_)(self, i_keyto((&_key))); )
+    } else
+        { i_keydrop((&_key)); _i_MAP_ONLY( i_valdrop((&_mapped)); )}
+    return _c_MEMB(_iter_at_)(self, tn);
+}
+
+STC_DEF i_type
+_c_MEMB(_from_sorted_n)(const _m_raw* raw, intptr_t n) {
+    i_type tree = _c_MEMB(_with_capacity)(n);
+    if (tree.cap < n)
+        return tree;
+    _m_node* d = tree.nodes;
+    int32_t m = 0;
+    for (; n--; ++raw) {
+        const _m_keyraw rkey = _i_SET_ONLY( *raw ) _i_MAP_ONLY( raw->first );
+        if (m) {
+            const _m_keyraw _raw = i_keyto(_i_keyref(&d[m].value));
+            const int c = i_cmp((&_raw), (&rkey));
+            c_assert(c <= 0); // input must be sorted
+            if (c == 0) { // duplicate key: same result as put_n()
+                #if defined i_no_emplace
+                    _m_key _key = i_keyfrom(rkey); i_keydrop((&_key));
+                #endif
+                _i_MAP_ONLY( i_valdrop((&d[m].value.second));
+                             d[m].value.second = i_valfrom(raw->second); )
+                continue;
+            }
+        }
+        _m_value* v = &d[++m].value; // nodes are numbered in key order
+        *_i_keyref(v) = i_keyfrom(rkey);
+        _i_MAP_ONLY( v->second = i_valfrom(raw->second); )
+    }
+    _c_MEMB(_link_sorted_)(&tree, m);
+    return tree;
+}
 
 #if !defined i_no_clone
 STC_DEF int32_t
@@ -554,6 +1239,7 @@ _c_MEMB(_clone_r_)(i_type* self, _m_node* src, int32_t sn) {
     self->nodes[tn].value = _c_MEMB(_value_clone)(src[sn].value);
     tx = _c_MEMB(_clone_r_)(self, src, src[sn].link[0]); self->nodes[tn].link[0] = tx;
     tx = _c_MEMB(_clone_r_)(self, src, src[sn].link[1]); self->nodes[tn].link[1] = tx;
+    _c_MEMB(_update_)(self->nodes, tn);
     return tn;
 }
 
@@ -562,9 +1248,68 @@ _c_MEMB(_clone)(i_type tree) {
     i_type clone = _c_MEMB(_with_capacity)(tree.size);
     int32_t root = _c_MEMB(_clone_r_)(&clone, tree.nodes, tree.root);
     clone.root = root;
+    _i_PARENT( if (root) clone.nodes[root].parent = 0; )
     clone.size = tree.size;
     return clone;
 }
+
+// Walk a and b in key order, and build a tree of the elements selected by the keep bits: 1 = only in a,
+// 2 = in both (the element of a is used), 4 = only in b. With move_a, the elements of a are moved or
+// dropped, and the caller frees a->nodes. Nothing is moved if the allocation fails: cap < size of a + b.
+STC_DEF i_type
+_c_MEMB(_combine_)(const i_type* a, const i_type* b, int keep, bool move_a) {
+    const intptr_t n = (keep & 3 ? a->size : 0) + (keep & 4 ? b->size : 0);
+    i_type tree = _c_MEMB(_with_capacity)(n);
+    if (n == 0 || tree.cap < n)
+        return tree;
+    _m_node* d = tree.nodes;
+    int32_t m = 0;
+    _m_iter i = _c_MEMB(_begin)(a), j = _c_MEMB(_begin)(b);
+    while ((i.ref && (j.ref || keep & 1 || move_a)) || (j.ref && keep & 4)) {
+        int c = -1, bit = 1;
+        if (!i.ref) c = 1;
+        else if (j.ref) {
+            const _m_keyraw _ra = i_keyto(_i_keyref(i.ref)), _rb = i_keyto(_i_keyref(j.ref));
+            c = i_cmp((&_ra), (&_rb));
+        }
+        _m_value* v = c > 0 ? j.ref : i.ref;
+        if (c >= 0) bit = c ? 4 : 2;
+        if (keep & bit)
+            d[++m].value = move_a && c <= 0 ? *v : _c_MEMB(_value_clone)(*v);
+        else if (move_a && c <= 0)
+            _c_MEMB(_value_drop)(v);
+        if (c <= 0) _c_MEMB(_next)(&i);
+        if (c >= 0) _c_MEMB(_next)(&j);
+    }
+    _c_MEMB(_link_sorted_)(&tree, m);
+    return tree;
+}
+
+STC_DEF void
+_c_MEMB(_merge_into)(i_type* self, const i_type* other) {
+    const intptr_t n = self->size, m = other->size;
+    if (m == 0 || self == other)
+        return;
+    int lg = 1; // inserts cost about log2(n + m) each
+    while ((n + m) >> lg) ++lg;
+    if (m*lg >= n + m) { // many elements: rebuild in O(n + m), moving the elements of self
+        i_type tree = _c_MEMB(_combine_)(self, other, 1|2|4, true);
+        if (tree.cap >= n + m) {
+            if (self->cap)
+                _c_MEMB(_free_nodes_)(self);
+            *self = tree;
+            return;
+        }
+        _c_MEMB(_drop)(&tree);
+    }
+    for (_m_iter it = _c_MEMB(_begin)(other); it.ref; _c_MEMB(_next)(&it)) {
+        _m_result res = _c_MEMB(_insert_entry_)(self, i_keyto(_i_keyref(it.ref)));
+        if (res.inserted) {
+            *res.ref = _c_MEMB(_value_clone)(*it.ref);
+            _i_AUG( _c_MEMB(_augment_path_)(self, i_keyto(_i_keyref(it.ref))); )
+        }
+    }
+}
 #endif // !i_no_clone
 
 #if !defined i_no_emplace
@@ -574,11 +1319,13 @@ _c_MEMB(_emplace)(i_type* self, _m_keyraw rkey _i_MAP_ONLY(, _m_rmapped rmapped)
     if (res.inserted) {
         *_i_keyref(res.ref) = i_keyfrom(rkey);
         _i_MAP_ONLY(res.ref->second = i_valfrom(rmapped);)
+        _i_AUG( _c_MEMB(_augment_path_)(self, rkey); )
     }
     return res;
 }
 #endif // i_no_emplace
 
+#if !defined i_cow // the elements have no destructors with i_cow
 static void
 _c_MEMB(_drop_r_)(_m_node* d, int32_t tn) {
     if (tn) {
@@ -587,13 +1334,16 @@ _c_MEMB(_drop_r_)(_m_node* d, int32_t tn) {
         _c_MEMB(_value_drop)(&d[tn].value);
     }
 }
+#endif
 
 STC_DEF void
 _c_MEMB(_drop)(const i_type* cself) {
     i_type* self = (i_type*)cself;
     if (self->cap) {
+    #if !defined i_cow
         _c_MEMB(_drop_r_)(self->nodes, self->root);
-        i_free(self->nodes, (self->cap + 1)*c_sizeof(_m_node));
+    #endif
+        _c_MEMB(_free_nodes_)(self);
     }
 }
 
@@ -604,5 +1354,16 @@ _c_MEMB(_drop)(const i_type* cself) {
 #undef _i_keyref
 #undef _i_MAP_ONLY
 #undef _i_SET_ONLY
+#undef i_ranked
+#undef i_parent
+#undef _i_PARENT
+#undef i_cow
+#undef _i_COW
+#undef i_interval
+#undef i_augment
+#undef i_aug
+#undef _i_AUG
+#undef _i_COW_SLOTS
+#undef _i_STACK
 #include "priv/template2.h"
 #include "priv/linkage2.h"
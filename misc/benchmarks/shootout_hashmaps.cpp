@@ -37,6 +37,19 @@ KHASH_MAP_INIT_INT64(ii, IValue)
 #define i_max_load_factor MAX_LOAD_FACTOR / 100.0f
 #include "stc/hmap.h"
 
+// STC hmap with high max load factor for fixed load factor lookup tests (T6): scalar, SIMD and robin hood probing
+#define i_TYPE hmap_lii,IKey,IValue
+#define i_max_load_factor 0.95f
+#include "stc/hmap.h"
+#define i_TYPE hmap_gii,IKey,IValue
+#define i_max_load_factor 0.95f
+#define i_simd
+#include "stc/hmap.h"
+#define i_TYPE hmap_hii,IKey,IValue
+#define i_max_load_factor 0.95f
+#define i_robinhood
+#include "stc/hmap.h"
+
 #define SEED(s) rng = crand_init(s)
 #define RAND(N) (crand_u64(&rng) & (((uint64_t)1 << N) - 1))
 
@@ -172,6 +185,34 @@ KHASH_MAP_INIT_INT64(ii, IValue)
 #define PMAP_DTOR(X)              UMAP_DTOR(X)
 
 
+#define LMAP_SETUP(X, Key, Value) hmap_l##X map = hmap_l##X##_init()
+#define LMAP_RESERVE(X, buckets)  hmap_l##X##_reserve(&map, (buckets)/2)
+#define LMAP_EMPLACE(X, key, val) hmap_l##X##_insert(&map, key, val).ref->second
+#define LMAP_FIND(X, key)         hmap_l##X##_contains(&map, key)
+#define LMAP_SIZE(X)              hmap_l##X##_size(&map)
+#define LMAP_BUCKETS(X)           hmap_l##X##_bucket_count(&map)
+#define LMAP_DTOR(X)              hmap_l##X##_drop(&map)
+
+#define GMAP_SETUP(X, Key, Value) hmap_g##X map = hmap_g##X##_init()
+#define GMAP_RESERVE(X, buckets)  hmap_g##X##_reserve(&map, (buckets)/2)
+#define GMAP_EMPLACE(X, key, val) hmap_g##X##_insert(&map, key, val).ref->second
+#define GMAP_FIND(X, key)         hmap_g##X##_contains(&map, key)
+#define GMAP_SIZE(X)              hmap_g##X##_size(&map)
+#define GMAP_BUCKETS(X)           hmap_g##X##_bucket_count(&map)
+#define GMAP_DTOR(X)              hmap_g##X##_drop(&map)
+
+#define HMAP_SETUP(X, Key, Value) hmap_h##X map = hmap_h##X##_init()
+#define HMAP_RESERVE(X, buckets)  hmap_h##X##_reserve(&map, (buckets)/2)
+#define HMAP_EMPLACE(X, key, val) hmap_h##X##_insert(&map, key, val).ref->second
+#define HMAP_FIND(X, key)         hmap_h##X##_contains(&map, key)
+#define HMAP_SIZE(X)              hmap_h##X##_size(&map)
+#define HMAP_BUCKETS(X)           hmap_h##X##_bucket_count(&map)
+#define HMAP_DTOR(X)              hmap_h##X##_drop(&map)
+#define HMAP_FOR(X, i)            c_foreach (i, hmap_h##X, map)
+#define LMAP_FOR(X, i)            c_foreach (i, hmap_l##X, map)
+
+#define BMAP_RESERVE(X, buckets)  map.max_load_factor(0.95f); map.rehash(buckets)
+
 #define MAP_TEST1(M, X, n) \
 {   /* Insert, update */ \
     M##_SETUP(X, IKey, IValue); \
@@ -262,6 +303,92 @@ KHASH_MAP_INIT_INT64(ii, IValue)
     M##_DTOR(X); \
 }
 
+#define MAP_TEST6(M, X, lf) \
+{   /* Lookup hits and misses at a fixed load factor */ \
+    M##_SETUP(X, IKey, IValue); \
+    size_t found = 0, buckets = (size_t)1 << keybits, m = (size_t)((lf)*buckets); \
+    clock_t difference, before; \
+    M##_RESERVE(X, buckets); \
+    SEED(seed); \
+    for (size_t i = 0; i < m; ++i) \
+        M##_EMPLACE(X, crand_u64(&rng), i); \
+    size_t x = 20000000ull/m + 1; \
+    SEED(seed); \
+    before = clock(); \
+    for (size_t r = 0; r < x; ++r) { /* existing keys */ \
+        for (size_t i = 0; i < m; ++i) found += M##_FIND(X, crand_u64(&rng)); \
+        SEED(seed); \
+    } \
+    difference = clock() - before; \
+    printf(#M ": lf %.2f, hit:  %6.1f Mlookups/s, buckets: %8" c_ZU ", found: %" c_ZU "\n", \
+           (double)M##_SIZE(X)/M##_BUCKETS(X), (x*m/1e6) / ((double)difference / CLOCKS_PER_SEC), \
+           (size_t) M##_BUCKETS(X), found); \
+    SEED(seed + 1); \
+    found = 0; \
+    before = clock(); \
+    for (size_t i = 0; i < x*m; ++i) /* missing keys */ \
+        found += M##_FIND(X, crand_u64(&rng)); \
+    difference = clock() - before; \
+    printf(#M ": lf %.2f, miss: %6.1f Mlookups/s, buckets: %8" c_ZU ", found: %" c_ZU "\n", \
+           (double)M##_SIZE(X)/M##_BUCKETS(X), (x*m/1e6) / ((double)difference / CLOCKS_PER_SEC), \
+           (size_t) M##_BUCKETS(X), found); \
+    M##_DTOR(X); \
+}
+
+// Probe lengths: number of buckets examined per lookup, computed from the home bucket of each key.
+// Linear probing (LMAP) scans to the first empty bucket on a miss. Robin hood (HMAP) stops at the
+// first entry which is closer to its home bucket than the probe.
+static void probe_lengths(const char* name, const intptr_t* home, size_t nb, int robinhood,
+                          crand_t* rng, int shift)
+{
+    const size_t mask = nb - 1, nmiss = 1000000;
+    enum {NH = 8};
+    const char* label[NH] = {"1", "2", "3", "4", "5-8", "9-16", "17-32", ">32"};
+    size_t hist[2][NH] = {{0}}, cnt[2] = {0}, sum[2] = {0}, max[2] = {0};
+    for (size_t k = 0; k < nb + nmiss; ++k) {
+        size_t len, h = k < nb; /* h: hit */
+        if (h) {
+            if (home[k] < 0) continue;
+            len = ((k - (size_t)home[k]) & mask) + 1;
+        } else {
+            const IKey key = (IKey)(crand_u64(rng) << shift);
+            size_t j = c_default_hash(&key) & mask, d = 0;
+            while (home[j] >= 0 && (!robinhood || ((j - (size_t)home[j]) & mask) >= d))
+                j = (j + 1) & mask, ++d;
+            len = d + 1;
+        }
+        int b = len <= 4 ? (int)len - 1 : len <= 8 ? 4 : len <= 16 ? 5 : len <= 32 ? 6 : 7;
+        ++hist[h][b], ++cnt[h], sum[h] += len;
+        if (len > max[h]) max[h] = len;
+    }
+    for (int h = 1; h >= 0; --h) {
+        printf("%s %s: mean %5.2f, max %4" c_ZU " |", name, h ? "hit " : "miss",
+               (double)sum[h]/cnt[h], max[h]);
+        for (int b = 0; b < NH; ++b)
+            printf(" %s:%5.1f%%", label[b], 100.0*hist[h][b]/cnt[h]);
+        puts("");
+    }
+}
+
+#define MAP_TEST7(M, X, lf, shift) \
+{   /* Probe length distribution at a fixed load factor */ \
+    M##_SETUP(X, IKey, IValue); \
+    size_t buckets = (size_t)1 << keybits, m = (size_t)((lf)*buckets); \
+    M##_RESERVE(X, buckets); \
+    SEED(seed); \
+    for (size_t i = 0; i < m; ++i) \
+        M##_EMPLACE(X, (IKey)(crand_u64(&rng) << (shift)), i); \
+    size_t nb = (size_t)M##_BUCKETS(X); \
+    intptr_t* home = (intptr_t*)malloc(nb*sizeof *home); \
+    for (size_t i = 0; i < nb; ++i) home[i] = -1; \
+    M##_FOR(X, it) \
+        home[it.ref - map.table] = (intptr_t)(c_default_hash(&it.ref->first) & (nb - 1)); \
+    probe_lengths(#M, home, nb, M##_ROBINHOOD, &rng, shift); \
+    free(home); \
+    M##_DTOR(X); \
+}
+#define LMAP_ROBINHOOD 0
+#define HMAP_ROBINHOOD 1
 
 #ifdef __cplusplus
 #ifdef HAVE_BOOST
@@ -282,6 +409,18 @@ KHASH_MAP_INIT_INT64(ii, IValue)
 #define RUN_TEST(n) MAP_TEST##n(KMAP, ii, N##n) \
                     MAP_TEST##n(CMAP, ii, N##n)
 #endif
+#if defined __cplusplus && defined HAVE_BOOST
+#define RUN_TEST6(lf) MAP_TEST6(LMAP, ii, lf) \
+                      MAP_TEST6(GMAP, ii, lf) \
+                      MAP_TEST6(HMAP, ii, lf) \
+                      MAP_TEST6(BMAP, ii, lf)
+#else
+#define RUN_TEST6(lf) MAP_TEST6(LMAP, ii, lf) \
+                      MAP_TEST6(GMAP, ii, lf) \
+                      MAP_TEST6(HMAP, ii, lf)
+#endif
+#define RUN_TEST7(lf, shift) MAP_TEST7(LMAP, ii, lf, shift) \
+                             MAP_TEST7(HMAP, ii, lf, shift)
 
 enum {
     DEFAULT_N_MILL = 10,
@@ -307,6 +446,9 @@ int main(int argc, char* argv[])
            "BMAP = https://www.boost.org (unordered_flat_map)\n"
 #endif
            "CMAP = https://github.com/stclib/STC (**)\n"
+           "LMAP = STC hmap, max load factor 0.95 (T6 only)\n"
+           "GMAP = STC hmap, max load factor 0.95, SIMD group probing: i_simd (T6 only)\n"
+           "HMAP = STC hmap, max load factor 0.95, robin hood probing: i_robinhood (T6, T7 only)\n"
            //"PMAP = https://github.com/greg7mdp/parallel-hashmap\n"
            "FMAP = https://github.com/skarupke/flat_hash_map\n"
            "TMAP = https://github.com/Tessil/robin-map\n"
@@ -331,4 +473,16 @@ int main(int argc, char* argv[])
 
     printf("\nT5: Lookup mix of random/existing keys in range [0, 2^%u). Num lookups depends on size.\n", keybits);
     RUN_TEST(5)
+
+    printf("\nT6: Lookup existing/missing keys at fixed load factors, 2^%u buckets.\n", keybits);
+    const float lfs[] = {0.5f, 0.6f, 0.7f, 0.8f, 0.9f};
+    for (size_t k = 0; k < sizeof lfs/sizeof lfs[0]; ++k) {
+        RUN_TEST6(lfs[k])
+    }
+
+    printf("\nT7: Probe length distribution at load factor 0.8, 2^%u buckets: random and clustered keys.\n", keybits);
+    printf("Random keys:\n");
+    RUN_TEST7(0.8, 0)
+    printf("Clustered keys (rnd << 8):\n");
+    RUN_TEST7(0.8, 8)
 }
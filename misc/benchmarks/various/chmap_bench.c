@@ -0,0 +1,98 @@
+#define i_static
+#include "stc/crand.h"
+#include <stdio.h>
+#include <time.h>
+
+// Throughput of chmap vs. a single hmap behind one mutex, 1 to 64 threads, mixed reads/writes.
+// Build: gcc -O2 -std=gnu11 -pthread -I../../../include chmap_bench.c
+#define i_TYPE chmap_u64, uint64_t, uint64_t
+#include "stc/chmap.h"
+
+#define i_TYPE hmap_u64, uint64_t, uint64_t
+#include "stc/hmap.h"
+
+enum {KEYS = 1 << 20, OPS = 1000000};
+
+typedef struct {
+    chmap_u64* cmap;
+    hmap_u64* hmap;
+    pthread_mutex_t* mtx;
+    int read_pct;
+    uint64_t seed, found;
+} job;
+
+static void* run_chmap(void* arg) {
+    job* j = (job*)arg;
+    crand_t rng = crand_init(j->seed);
+    c_forrange (OPS) {
+        uint64_t r = crand_u64(&rng), key = r % (2*KEYS);
+        if ((int)(r >> 57) % 100 < j->read_pct)
+            j->found += chmap_u64_contains(j->cmap, key);
+        else if (r & (1ULL << 50))
+            chmap_u64_insert(j->cmap, key, r);
+        else
+            chmap_u64_erase(j->cmap, key);
+    }
+    return NULL;
+}
+
+static void* run_hmap(void* arg) {
+    job* j = (job*)arg;
+    crand_t rng = crand_init(j->seed);
+    c_forrange (OPS) {
+        uint64_t r = crand_u64(&rng), key = r % (2*KEYS);
+        pthread_mutex_lock(j->mtx);
+        if ((int)(r >> 57) % 100 < j->read_pct)
+            j->found += hmap_u64_contains(j->hmap, key);
+        else if (r & (1ULL << 50))
+            hmap_u64_insert(j->hmap, key, r);
+        else
+            hmap_u64_erase(j->hmap, key);
+        pthread_mutex_unlock(j->mtx);
+    }
+    return NULL;
+}
+
+static double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static double bench(void* (*fn)(void*), int nthreads, int read_pct,
+                    chmap_u64* cmap, hmap_u64* hmap, pthread_mutex_t* mtx) {
+    pthread_t th[64];
+    job jobs[64];
+    double t = now();
+    c_forrange (i, nthreads) {
+        jobs[i] = c_LITERAL(job){cmap, hmap, mtx, read_pct, (uint64_t)i + 1, 0};
+        pthread_create(&th[i], NULL, fn, &jobs[i]);
+    }
+    c_forrange (i, nthreads)
+        pthread_join(th[i], NULL);
+    return (double)nthreads*OPS/(now() - t)*1e-6;
+}
+
+int main(void)
+{
+    const int reads[] = {50, 90, 99};
+    chmap_u64 cmap;
+    hmap_u64 hmap = {0};
+    pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+    chmap_u64_init(&cmap);
+    crand_t rng = crand_init(0);
+    c_forrange (KEYS) {
+        uint64_t key = crand_u64(&rng) % (2*KEYS);
+        chmap_u64_insert(&cmap, key, key);
+        hmap_u64_insert(&hmap, key, key);
+    }
+    printf("Mops/s, %d ops per thread, %d initial keys\n", OPS, KEYS);
+    printf("threads read%%      chmap  hmap+mutex\n");
+    c_forrange (r, c_arraylen(reads))
+        for (int n = 1; n <= 64; n *= 2)
+            printf("%7d %5d%% %10.1f %11.1f\n", n, reads[r],
+                   bench(run_chmap, n, reads[r], &cmap, &hmap, &mtx),
+                   bench(run_hmap, n, reads[r], &cmap, &hmap, &mtx));
+    chmap_u64_drop(&cmap);
+    hmap_u64_drop(&hmap);
+}
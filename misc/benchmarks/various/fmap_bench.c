@@ -0,0 +1,66 @@
+#define i_static
+#include "stc/crand.h"
+#define i_TYPE hmap_u64, uint64_t, uint64_t
+#define i_max_load_factor 0.80f
+#include "stc/hmap.h"
+#define i_TYPE fmap_u64, uint64_t, uint64_t
+#include "stc/fmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Memory footprint and lookup speed: frozen perfect hash map vs. hmap at max load factor 0.8.
+// hmap uses 1 byte metadata per bucket, fmap 4 bytes pilot per ~3 elements.
+
+static double secs(clock_t t) { return (double)t/CLOCKS_PER_SEC; }
+
+int main(int argc, char const *argv[])
+{
+    const intptr_t N = argc > 1 ? atoll(argv[1]) : 5000000;
+    const intptr_t L = 20000000;
+    hmap_u64 hmap = {0};
+    fmap_u64 fmap = {0};
+    crand_t rng = crand_init(1);
+    intptr_t count;
+    clock_t t;
+
+    c_forrange (i, N)
+        hmap_u64_insert(&hmap, crand_u64(&rng), i);
+    t = clock();
+    fmap_u64_reserve(&fmap, hmap_u64_size(&hmap));
+    c_foreach (i, hmap_u64, hmap)
+        fmap_u64_insert(&fmap, i.ref->first, i.ref->second);
+    fmap_u64_freeze(&fmap);
+    t = clock() - t;
+    printf("fmap build: %.2f s\n", secs(t));
+
+    const double hbytes = (double)hmap_u64_bucket_count(&hmap)*(sizeof(hmap_u64_value) + 1);
+    const double fbytes = (double)fmap_u64_size(&fmap)*sizeof(fmap_u64_value) +
+                          (double)fmap_u64_bucket_count(&fmap)*sizeof(uint32_t);
+    printf("hmap: size %" c_ZI ", load %.2f, %.1f MB, %.2f bytes/elem\n", hmap_u64_size(&hmap),
+           (double)hmap_u64_size(&hmap)/hmap_u64_bucket_count(&hmap), hbytes*1e-6, hbytes/N);
+    printf("fmap: size %" c_ZI ", load 1.00, %.1f MB, %.2f bytes/elem\n", fmap_u64_size(&fmap),
+           fbytes*1e-6, fbytes/N);
+
+    const char* what[] = {"hits", "misses"};
+    c_forrange (m, 2) {
+        rng = crand_init(m == 0 ? 1 : 2), count = 0, t = clock();
+        c_forrange (i, L) {
+            if (m == 0 && i % N == 0) rng = crand_init(1);
+            count += hmap_u64_get(&hmap, crand_u64(&rng)) != NULL;
+        }
+        t = clock() - t;
+        printf("hmap get %-6s: found %" c_ZI ", %.1f ns/lookup\n", what[m], count, secs(t)*1e9/L);
+
+        rng = crand_init(m == 0 ? 1 : 2), count = 0, t = clock();
+        c_forrange (i, L) {
+            if (m == 0 && i % N == 0) rng = crand_init(1);
+            count += fmap_u64_get(&fmap, crand_u64(&rng)) != NULL;
+        }
+        t = clock() - t;
+        printf("fmap get %-6s: found %" c_ZI ", %.1f ns/lookup\n", what[m], count, secs(t)*1e9/L);
+    }
+    fmap_u64_drop(&fmap);
+    hmap_u64_drop(&hmap);
+}
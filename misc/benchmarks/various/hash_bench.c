@@ -0,0 +1,112 @@
+#include "stc/common.h"
+#include "stc/crand.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+
+// Speed and quality of c_hash_n() for key lengths 1..1024, against the previous (c_hash_version 1)
+// function. Quality: chi-square of the low 16 bits (the bucket index of fastrange_2 in a table of
+// 2^16 buckets), for keys which differ only in one 4-byte counter, plus the worst avalanche bias:
+// the probability that flipping one input bit flips a given output bit should be 0.5.
+
+static uint64_t hash_v1(const void* key, intptr_t len) {
+    uint32_t u4; uint64_t u8;
+    switch (len) {
+        case 8: memcpy(&u8, key, 8); return u8*0xc6a4a7935bd1e99d;
+        case 4: memcpy(&u4, key, 4); return u4*0xc6a4a7935bd1e99d;
+        case 0: return 1;
+    }
+    const uint8_t *x = (const uint8_t*)key;
+    uint64_t h = (uint64_t)*x << 7, n = (uint64_t)len >> 3;
+    len &= 7;
+    while (n--) {
+        memcpy(&u8, x, 8), x += 8;
+        h = (h ^ u8)*0xc6a4a7935bd1e99d;
+    }
+    while (len--) h = (h ^ *x++)*0x100000001b3;
+    return h ^ c_ROTL(h, 26);
+}
+
+typedef uint64_t (*hash_fn)(const void* key, intptr_t len);
+enum {BITS = 16, NB = 1 << BITS};
+
+static double speed(hash_fn fn, uint8_t* buf, intptr_t len) {
+    const intptr_t n = 200000000/(len + 16) + 1000;
+    uint64_t sum = 0;
+    clock_t t = clock();
+    for (intptr_t i = 0; i < n; ++i) {
+        buf[0] = (uint8_t)i; // defeat hoisting
+        sum += fn(buf, len);
+    }
+    t = clock() - t;
+    if (sum == 1) puts("");
+    return (double)t/CLOCKS_PER_SEC*1e9/n; // ns per hash
+}
+
+static double chi2(hash_fn fn, uint8_t* buf, intptr_t len, uint32_t* count) {
+    const intptr_t n = 8*NB, off = len >= 4 ? (len - 4)/2 : 0;
+    memset(count, 0, NB*sizeof *count);
+    memset(buf, 'a', (size_t)len);
+    for (intptr_t i = 0; i < n; ++i) {
+        const uint32_t k = (uint32_t)i << (len >= 4 ? 4 : 0); // clustered: low bits zero
+        memcpy(buf + off, &k, (size_t)(len < 4 ? len : 4));
+        ++count[fn(buf, len) & (NB - 1)];
+    }
+    double e = (double)n/NB, x = 0;
+    for (intptr_t i = 0; i < NB; ++i)
+        x += (count[i] - e)*(count[i] - e)/e;
+    return x/NB; // normalized: ~1.0 for a uniform distribution
+}
+
+static double avalanche(hash_fn fn, uint8_t* buf, intptr_t len, crand_t* rng) {
+    enum {TRIALS = 2000};
+    const intptr_t nbits = len*8 < 256 ? len*8 : 256;
+    static uint32_t flips[256][64];
+    memset(flips, 0, sizeof flips);
+    for (int t = 0; t < TRIALS; ++t) {
+        for (intptr_t i = 0; i < len; ++i) buf[i] = (uint8_t)crand_u64(rng);
+        const uint64_t h = fn(buf, len);
+        for (intptr_t b = 0; b < nbits; ++b) {
+            buf[b >> 3] ^= (uint8_t)(1 << (b & 7));
+            const uint64_t d = h ^ fn(buf, len);
+            buf[b >> 3] ^= (uint8_t)(1 << (b & 7));
+            for (int o = 0; o < 64; ++o) flips[b][o] += (uint32_t)(d >> o & 1);
+        }
+    }
+    double worst = 0;
+    for (intptr_t b = 0; b < nbits; ++b)
+        for (int o = 0; o < 64; ++o) {
+            const double bias = fabs((double)flips[b][o]/TRIALS - 0.5)*2;
+            if (bias > worst) worst = bias;
+        }
+    return worst; // 0 = ideal, 1 = an output bit never or always flips
+}
+
+int main(void)
+{
+    const intptr_t lens[] = {1, 2, 3, 4, 5, 7, 8, 12, 16, 24, 32, 48, 64, 100, 128, 256, 512, 1024};
+    uint8_t* buf = (uint8_t*)malloc(1024 + 64);
+    uint32_t* count = (uint32_t*)malloc(NB*sizeof *count);
+    crand_t rng = crand_init(1);
+    c_forrange (i, 1024 + 64) buf[i] = (uint8_t)crand_u64(&rng);
+
+    printf("%6s | %20s | %20s | %20s\n", "", "ns/hash (GB/s)", "chi2/bucket (1.0)", "avalanche bias (0)");
+    printf("%6s | %9s  %9s | %9s  %9s | %9s  %9s\n", "len", "v1", "c_hash_n", "v1", "c_hash_n", "v1", "c_hash_n");
+    c_forrange (k, c_arraylen(lens)) {
+        const intptr_t len = lens[k];
+        const double t1 = speed(hash_v1, buf, len), t2 = speed(c_hash_n, buf, len);
+        // keys of 1-2 bytes have too few values for the chi-square test: skip
+        const double c1 = len > 2 ? chi2(hash_v1, buf, len, count) : NAN;
+        const double c2 = len > 2 ? chi2(c_hash_n, buf, len, count) : NAN;
+        const double a1 = avalanche(hash_v1, buf, len, &rng), a2 = avalanche(c_hash_n, buf, len, &rng);
+        if (len >= 64)
+            printf("%6d | %4.1f %4.1f  %4.1f %4.1f | %9.2f  %9.2f | %9.3f  %9.3f\n", (int)len,
+                   t1, len/t1, t2, len/t2, c1, c2, a1, a2);
+        else
+            printf("%6d | %9.2f  %9.2f | %9.2f  %9.2f | %9.3f  %9.3f\n", (int)len, t1, t2, c1, c2, a1, a2);
+    }
+    free(count);
+    free(buf);
+}
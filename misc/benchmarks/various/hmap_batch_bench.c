@@ -0,0 +1,63 @@
+#define i_static
+#include "stc/crand.h"
+#define i_TYPE hmap_u64, uint64_t, uint64_t
+#include "stc/hmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Per-key vs. batched (hmap_X_get_n) lookups in a table much larger than the LLC.
+// Default: 50M uint64_t pairs, 2^26 buckets of 17 bytes, i.e. ~1.1 GB.
+enum {BATCH = 256};
+#define c_min(a, b) ((a) < (b) ? (a) : (b))
+
+int main(int argc, char const *argv[])
+{
+    const intptr_t N = argc > 1 ? atoll(argv[1]) : 50000000;
+    const intptr_t L = 20000000; // lookups, ~50% hits
+    hmap_u64 map = hmap_u64_with_capacity(N);
+    uint64_t* keys = (uint64_t*)malloc(BATCH*sizeof *keys);
+    const hmap_u64_value** out = (const hmap_u64_value**)malloc(BATCH*sizeof *out);
+    crand_t rng = crand_init(1);
+    intptr_t count;
+    clock_t t;
+
+    t = clock();
+    c_forrange (i, N)
+        hmap_u64_insert(&map, crand_u64(&rng) % (2*N), i);
+    t = clock() - t;
+    printf("size: %" c_ZI ", buckets: %" c_ZI ", %.2f GB\n", hmap_u64_size(&map),
+           hmap_u64_bucket_count(&map), (double)hmap_u64_bucket_count(&map)*17/(1 << 30));
+    printf("insert:     %.1f Minserts/s\n", N/((double)t/CLOCKS_PER_SEC)*1e-6);
+
+    rng = crand_init(2), count = 0, t = clock();
+    c_forrange (L)
+        count += hmap_u64_get(&map, crand_u64(&rng) % (2*N)) != NULL;
+    t = clock() - t;
+    printf("get:        found %" c_ZI ", %.1f Mlookups/s\n", count, L/((double)t/CLOCKS_PER_SEC)*1e-6);
+
+    rng = crand_init(2), count = 0, t = clock();
+    for (intptr_t i = 0; i < L; i += BATCH) {
+        c_forrange (j, BATCH) keys[j] = crand_u64(&rng) % (2*N);
+        count += hmap_u64_get_n(&map, keys, BATCH, out);
+    }
+    t = clock() - t;
+    printf("get_n:      found %" c_ZI ", %.1f Mlookups/s\n", count, L/((double)t/CLOCKS_PER_SEC)*1e-6);
+
+    hmap_u64 map2 = hmap_u64_with_capacity(N);
+    hmap_u64_raw raw[BATCH];
+    rng = crand_init(1), t = clock();
+    for (intptr_t i = 0; i < N; i += BATCH) {
+        const intptr_t m = c_min(N - i, (intptr_t)BATCH);
+        c_forrange (j, m) raw[j] = c_LITERAL(hmap_u64_raw){crand_u64(&rng) % (2*N), i + j};
+        hmap_u64_emplace_n(&map2, raw, m);
+    }
+    t = clock() - t;
+    printf("emplace_n:  size %" c_ZI ", %.1f Minserts/s\n", hmap_u64_size(&map2), N/((double)t/CLOCKS_PER_SEC)*1e-6);
+
+    free(out);
+    free(keys);
+    hmap_u64_drop(&map2);
+    hmap_u64_drop(&map);
+}
@@ -0,0 +1,49 @@
+#define i_static
+#include "stc/crand.h"
+#define i_TYPE hmap_u64, uint64_t, uint64_t
+#include "stc/hmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined __GLIBC__
+  #include <malloc.h>
+#endif
+
+// Snapshot cost of a map of bitwise copyable elements: clone() into new memory, copy() into an
+// existing snapshot of the same bucket count, and reserve() to double the bucket count.
+// Default: 10M uint64_t pairs, 2^24 buckets, ~270 MB.
+#define MS(t) ((double)(t)/CLOCKS_PER_SEC*1e3)
+
+int main(int argc, char const *argv[])
+{
+    const intptr_t N = argc > 1 ? atoll(argv[1]) : 10000000;
+#if defined __GLIBC__
+    mallopt(M_MMAP_THRESHOLD, 1 << 30); // reuse freed memory, instead of new zero pages from the OS
+    mallopt(M_TRIM_THRESHOLD, -1);
+#endif
+    hmap_u64 map = {0};
+    crand_t rng = crand_init(1);
+    c_forrange (i, N)
+        hmap_u64_insert(&map, crand_u64(&rng), i);
+    printf("size: %" c_ZI ", buckets: %" c_ZI "\n", hmap_u64_size(&map), hmap_u64_bucket_count(&map));
+
+    hmap_u64 snap = {0};
+    c_forrange (k, 3) {
+        clock_t t = clock();
+        hmap_u64 c = hmap_u64_clone(map);
+        const double tclone = MS(clock() - t);
+
+        t = clock();
+        hmap_u64_copy(&snap, &map);
+        const double tcopy = MS(clock() - t);
+
+        t = clock();
+        hmap_u64_reserve(&c, hmap_u64_bucket_count(&c) + 1);
+        const double treserve = MS(clock() - t);
+        printf("clone: %6.1f ms, copy: %6.1f ms, reserve x2: %6.1f ms\n", tclone, tcopy, treserve);
+        hmap_u64_drop(&c);
+    }
+    hmap_u64_drop(&snap);
+    hmap_u64_drop(&map);
+}
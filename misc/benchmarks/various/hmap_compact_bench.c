@@ -0,0 +1,65 @@
+#define i_static
+#include "stc/crand.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+// Peak RSS and throughput of hmap with power of 2 bucket counts vs. i_compact (any bucket count,
+// growth factor 1.25). Run each variant in its own process, as the peak RSS is per process:
+//   hmap_compact_bench pow2 70000000
+//   hmap_compact_bench compact 70000000
+// Add "reserve" to reserve the final size up front instead of growing.
+
+#define i_TYPE pow2, uint64_t, uint64_t
+#include "stc/hmap.h"
+#define i_TYPE compact, uint64_t, uint64_t
+#define i_compact
+#include "stc/hmap.h"
+
+#define SECS(t) ((double)(t)/CLOCKS_PER_SEC)
+
+static double peak_rss_mb(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss/1024.0; // kB on Linux
+}
+
+#define RUN(M, N, reserve) do { \
+    const intptr_t L = N < 20000000 ? N : 20000000; \
+    M map = reserve ? M##_with_capacity(N) : M##_init(); \
+    crand_t rng = crand_init(1); \
+    uint64_t sum = 0; \
+    clock_t t = clock(); \
+    c_forrange (i, N) M##_insert(&map, crand_u64(&rng), i); \
+    const double tins = SECS(clock() - t); \
+    rng = crand_init(1), t = clock(); \
+    c_forrange (L) sum += *M##_at(&map, crand_u64(&rng)); /* hits: the first L inserted keys */ \
+    const double thit = SECS(clock() - t); \
+    rng = crand_init(2), t = clock(); \
+    c_forrange (L) sum += M##_contains(&map, crand_u64(&rng)); /* misses */ \
+    const double tmiss = SECS(clock() - t); \
+    const double mb = (double)M##_bucket_count(&map)*(c_sizeof(M##_value) + 1)/(1 << 20); \
+    printf("%-8s size %" c_ZI " buckets %" c_ZI " (lf %.2f) table %.0f MB, peak RSS %.0f MB, " \
+           "ideal %.0f MB\n", #M, M##_size(&map), M##_bucket_count(&map), \
+           (double)M##_size(&map)/(double)M##_bucket_count(&map), mb, peak_rss_mb(), \
+           (double)N/0.8*(c_sizeof(M##_value) + 1)/(1 << 20)); \
+    printf("%-8s insert %.1f M/s, hit %.1f M/s, miss %.1f M/s  %" PRIu64 "\n", #M, \
+           N/tins*1e-6, L/thit*1e-6, L/tmiss*1e-6, sum % 1000); \
+    M##_drop(&map); \
+} while (0)
+
+int main(int argc, char const *argv[])
+{
+    if (argc < 2 || (strcmp(argv[1], "pow2") && strcmp(argv[1], "compact"))) {
+        puts("usage: hmap_compact_bench pow2|compact [size [reserve]]");
+        return 1;
+    }
+    const intptr_t N = argc > 2 ? atoll(argv[2]) : 20000000;
+    const bool reserve = argc > 3 && !strcmp(argv[3], "reserve");
+    if (!strcmp(argv[1], "pow2"))
+        RUN(pow2, N, reserve);
+    else
+        RUN(compact, N, reserve);
+}
@@ -0,0 +1,65 @@
+#define i_static
+#include "stc/crand.h"
+#define i_TYPE hmap_u64, uint64_t, uint64_t
+#include "stc/hmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Startup cost of a large lookup table: rebuild by inserting vs. hmap_X_map_view() of an mmapped
+// file written by hmap_X_write(). POSIX only.
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main(int argc, char const *argv[])
+{
+    const intptr_t N = argc > 1 ? atoll(argv[1]) : 20000000;
+    const char* path = argc > 2 ? argv[2] : "hmap_mmap_bench.bin";
+    const intptr_t L = 1000000;
+    crand_t rng = crand_init(1);
+    intptr_t count = 0;
+    double t;
+
+    t = now();
+    hmap_u64 map = hmap_u64_with_capacity(N);
+    c_forrange (i, N)
+        hmap_u64_insert(&map, crand_u64(&rng), i);
+    printf("build:  %8.1f ms\n", (now() - t)*1e3);
+
+    FILE* fp = fopen(path, "wb");
+    t = now();
+    if (!fp || !hmap_u64_write(&map, fp))
+        return perror(path), 1;
+    fclose(fp);
+    printf("write:  %8.1f ms\n", (now() - t)*1e3);
+    hmap_u64_drop(&map);
+
+    t = now();
+    const int fd = open(path, O_RDONLY);
+    struct stat st;
+    fstat(fd, &st);
+    void* mem = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    hmap_u64 view;
+    if (mem == MAP_FAILED || !hmap_u64_map_view(&view, mem, st.st_size))
+        return fprintf(stderr, "map_view failed\n"), 1;
+    printf("load:   %8.1f ms, %.2f GB, size %" c_ZI "\n", (now() - t)*1e3,
+           st.st_size*1e-9, hmap_u64_size(&view));
+
+    rng = crand_init(1), t = now();
+    c_forrange (L)
+        count += hmap_u64_contains(&view, crand_u64(&rng));
+    printf("lookup: %8.1f ns, found %" c_ZI " (first touch, page cache)\n", (now() - t)*1e9/L, count);
+
+    munmap(mem, (size_t)st.st_size);
+    close(fd);
+    remove(path);
+}
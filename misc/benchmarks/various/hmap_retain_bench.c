@@ -0,0 +1,47 @@
+#define i_static
+#include "stc/crand.h"
+#include "stc/algo/utility.h"
+#define i_TYPE hmap_u64, uint64_t, uint64_t
+#include "stc/hmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Erase half of the elements of a map: c_erase_if() with erase_at() per element, vs. a single
+// pass hmap_X_retain(), vs. rebuilding a new map of the kept elements.
+// Default: 10M uint64_t pairs.
+#define MS(t) ((double)(t)/CLOCKS_PER_SEC*1e3)
+
+static bool keep_even(const hmap_u64_value* val, void* ctx)
+    { (void)ctx; return (val->second & 1) == 0; }
+
+int main(int argc, char const *argv[])
+{
+    const intptr_t N = argc > 1 ? atoll(argv[1]) : 10000000;
+    hmap_u64 map = {0};
+    crand_t rng = crand_init(1);
+    c_forrange (i, N)
+        hmap_u64_insert(&map, crand_u64(&rng), i);
+    printf("size: %" c_ZI ", buckets: %" c_ZI "\n", hmap_u64_size(&map), hmap_u64_bucket_count(&map));
+
+    hmap_u64 m = hmap_u64_clone(map);
+    clock_t t = clock();
+    c_erase_if(hmap_u64, &m, value->second & 1);
+    printf("c_erase_if: %7.1f ms, size %" c_ZI "\n", MS(clock() - t), hmap_u64_size(&m));
+    hmap_u64_drop(&m);
+
+    m = hmap_u64_clone(map);
+    t = clock();
+    hmap_u64_retain(&m, keep_even, NULL);
+    printf("retain:     %7.1f ms, size %" c_ZI "\n", MS(clock() - t), hmap_u64_size(&m));
+    hmap_u64_drop(&m);
+
+    t = clock();
+    m = hmap_u64_with_capacity(hmap_u64_size(&map)/2);
+    c_foreach (i, hmap_u64, map)
+        if (keep_even(i.ref, NULL)) hmap_u64_insert(&m, i.ref->first, i.ref->second);
+    printf("rebuild:    %7.1f ms, size %" c_ZI "\n", MS(clock() - t), hmap_u64_size(&m));
+    hmap_u64_drop(&m);
+    hmap_u64_drop(&map);
+}
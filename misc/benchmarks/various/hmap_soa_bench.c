@@ -0,0 +1,68 @@
+#define i_static
+#include "stc/crand.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// hmap with i_soa (keys and mapped values in separate arrays) vs. the default key/value pairs,
+// for 8-byte keys and 64, 128 and 256-byte values. Lookups read one word of the value on a hit.
+// Default: 1M inserts of random keys; hit lookups use random keys from the same range.
+typedef struct { uint64_t w[8]; } Val64;
+typedef struct { uint64_t w[16]; } Val128;
+typedef struct { uint64_t w[32]; } Val256;
+
+#define i_TYPE aos64, uint64_t, Val64
+#include "stc/hmap.h"
+#define i_TYPE soa64, uint64_t, Val64
+#define i_soa
+#include "stc/hmap.h"
+#define i_TYPE aos128, uint64_t, Val128
+#include "stc/hmap.h"
+#define i_TYPE soa128, uint64_t, Val128
+#define i_soa
+#include "stc/hmap.h"
+#define i_TYPE aos256, uint64_t, Val256
+#include "stc/hmap.h"
+#define i_TYPE soa256, uint64_t, Val256
+#define i_soa
+#include "stc/hmap.h"
+
+#define SECS(t) ((double)(t)/CLOCKS_PER_SEC)
+#define AOS_VAL(it) (&(it).ref->second)
+#define SOA_VAL(it) ((it).val)
+
+#define RUN(M, V, VAL, N, L) do { \
+    M map = {0}; V v = {{0}}; crand_t rng = crand_init(1); \
+    uint64_t sum = 0; clock_t t = clock(); \
+    c_forrange (i, N) { v.w[0] = (uint64_t)i; M##_insert(&map, crand_u64(&rng) & mask, v); } \
+    const double tins = SECS(clock() - t); \
+    rng = crand_init(2), t = clock(); \
+    c_forrange (L) { \
+        M##_iter it = M##_find(&map, crand_u64(&rng) & mask); \
+        if (it.ref) sum += VAL(it)->w[0]; \
+    } \
+    const double tget = SECS(clock() - t); \
+    rng = crand_init(3), t = clock(); \
+    c_forrange (L) sum += M##_contains(&map, (crand_u64(&rng) & mask) | (mask + 1)); /* misses */ \
+    const double tmiss = SECS(clock() - t); \
+    t = clock(); \
+    c_forrange (10) c_foreach (it, M, map) sum += VAL(it)->w[0]; \
+    const double titer = SECS(clock() - t)/10; \
+    printf("%-7s %4d %11.1f %11.1f %11.1f %11.2f   %" PRIu64 "\n", #M, (int)sizeof(V), \
+           N/tins*1e-6, L/tget*1e-6, L/tmiss*1e-6, titer*1e3, sum % 1000); \
+    M##_drop(&map); \
+} while (0)
+
+int main(int argc, char const *argv[])
+{
+    const intptr_t N = argc > 1 ? atoll(argv[1]) : 1000000;
+    const intptr_t L = 10000000;
+    const uint64_t mask = (uint64_t)c_next_pow2(2*N) - 1;
+    printf("%-7s %4s %11s %11s %11s %11s\n", "layout", "val", "Minsert/s", "Mhit/s", "Mmiss/s", "iter ms");
+    RUN(aos64, Val64, AOS_VAL, N, L);
+    RUN(soa64, Val64, SOA_VAL, N, L);
+    RUN(aos128, Val128, AOS_VAL, N, L);
+    RUN(soa128, Val128, SOA_VAL, N, L);
+    RUN(aos256, Val256, AOS_VAL, N, L);
+    RUN(soa256, Val256, SOA_VAL, N, L);
+}
@@ -0,0 +1,61 @@
+#define i_static
+#include "stc/crand.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// hmap vs. imap (insertion ordered, dense elements) with 64-byte mapped values:
+// table memory, iteration over all elements, and lookups.
+typedef struct { uint64_t v[8]; } Big;
+
+#define i_TYPE hmap_big, uint64_t, Big
+#include "stc/hmap.h"
+#define i_TYPE imap_big, uint64_t, Big
+#include "stc/imap.h"
+
+static double secs(clock_t t) { return (double)t/CLOCKS_PER_SEC; }
+
+int main(int argc, char const *argv[])
+{
+    const intptr_t N = argc > 1 ? atoll(argv[1]) : 2000000;
+    const int R = 10; // iteration rounds
+    hmap_big hmap = {0};
+    imap_big imap = {0};
+    crand_t rng = crand_init(1);
+    uint64_t sum = 0;
+    clock_t t;
+
+    Big b = {{0}};
+    c_forrange (i, N) {
+        const uint64_t key = crand_u64(&rng);
+        b.v[0] = (uint64_t)i;
+        hmap_big_insert(&hmap, key, b);
+        imap_big_insert(&imap, key, b);
+    }
+    printf("hmap: %" c_ZI " buckets, %.1f MB\n", hmap_big_bucket_count(&hmap),
+           hmap_big_bucket_count(&hmap)*(sizeof(hmap_big_value) + 1)*1e-6);
+    printf("imap: %" c_ZI " buckets, %.1f MB table + %.1f MB elements\n", imap_big_bucket_count(&imap),
+           imap_big_bucket_count(&imap)*5*1e-6, imap_big_capacity(&imap)*sizeof(imap_big_value)*1e-6);
+
+    t = clock();
+    c_forrange (R) c_foreach (i, hmap_big, hmap) sum += i.ref->second.v[0];
+    t = clock() - t;
+    printf("hmap iterate: %.2f ns/elem\n", secs(t)*1e9/(N*R));
+    t = clock();
+    c_forrange (R) c_foreach (i, imap_big, imap) sum += i.ref->second.v[0];
+    t = clock() - t;
+    printf("imap iterate: %.2f ns/elem\n", secs(t)*1e9/(N*R));
+
+    rng = crand_init(1), t = clock();
+    c_forrange (N) sum += hmap_big_get(&hmap, crand_u64(&rng))->second.v[0];
+    t = clock() - t;
+    printf("hmap get:     %.2f ns\n", secs(t)*1e9/N);
+    rng = crand_init(1), t = clock();
+    c_forrange (N) sum += imap_big_get(&imap, crand_u64(&rng))->second.v[0];
+    t = clock() - t;
+    printf("imap get:     %.2f ns\n", secs(t)*1e9/N);
+
+    printf("sum: %" PRIu64 "\n", sum);
+    hmap_big_drop(&hmap);
+    imap_big_drop(&imap);
+}
@@ -1,4 +1,5 @@
-// Generic Quicksort in C, performs as fast as c++ std::sort().
+// Sorting benchmark: vec sort() (inlined pdqsort), algo/quicksort.h, qsort() and c++ std::sort().
+// Build as C (-DQSORT or -DQUICKSORT to select) or as C++ for std::sort().
 #include <stdio.h>
 #include <time.h>
 #include <stdlib.h>
@@ -7,6 +8,7 @@
 #endif
 #define NDEBUG
 #define i_TYPE Ints,int
+#define i_use_cmp
 #define i_more
 #include "stc/vec.h"
 #include "stc/algo/quicksort.h"
@@ -30,8 +32,10 @@ void testsort(Ints *a, int size, const char *desc) {
     printf("std::sort: "); std::sort(a->data, a->data + size);
 #elif defined QSORT
     printf("qsort: "); qsort(a->data, size, sizeof *a->data, cmp_int);
+#elif defined QUICKSORT
+    printf("STC quicksort: "); Ints_quicksort(a);
 #else
-    printf("STC sort_n: "); Ints_quicksort(a);
+    printf("STC sort: "); Ints_sort(a);
 #endif
     t = clock() - t;
 
@@ -53,7 +57,7 @@ int main(int argc, char *argv[]) {
         printf(" %d", (int)*Ints_at(&a, i));
     puts("");
     for (i = 1; i < size; i++)
-        if (Ints_at(&a, i - 1) > Ints_at(&a, i))
+        if (*Ints_at(&a, i - 1) > *Ints_at(&a, i))
             { printf("sort error\n"); exit(-1); };
 
     for (i = 0; i < size; i++)
@@ -69,6 +73,15 @@ int main(int argc, char *argv[]) {
         *Ints_at_mut(&a, i) = i + 1;
     *Ints_at_mut(&a, size - 1) = 0;
     testsort(&a, size, "rotated");
+    for (i = 0; i < size; i++)
+        *Ints_at_mut(&a, i) = romutrio(s) & 15;
+    testsort(&a, size, "few unique");
+    for (i = 0; i < size; i++)
+        *Ints_at_mut(&a, i) = i < size/2 ? i : size - i;
+    testsort(&a, size, "organ pipe");
+    for (i = 0; i < size; i++)
+        *Ints_at_mut(&a, i) = (romutrio(s) & 63) ? i : romutrio(s) & ((1U << 30) - 1);
+    testsort(&a, size, "sorted + 1/64 random");
 
     Ints_drop(&a);
 }
@@ -0,0 +1,57 @@
+#define i_TYPE smap_u64, uint64_t, uint64_t
+#include "stc/smap.h"
+#define i_TYPE smap_par, uint64_t, uint64_t
+#define i_parent
+#include "stc/smap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "stc/crand.h"
+#include <time.h>
+
+// Nearly sorted timestamps: insert() descends from the root, insert_hint() with the previous
+// position starts at the leaf (i_parent). Then erase of the oldest half: one key at a time with
+// erase(), and with erase_key_range(). Default: 4M elements.
+#define MS(t) ((double)(t)/CLOCKS_PER_SEC*1e3)
+
+int main(int argc, char const *argv[])
+{
+    const intptr_t N = argc > 1 ? atoll(argv[1]) : 4000000;
+    uint64_t* ts = (uint64_t*)malloc(N*sizeof *ts);
+    crand_t rng = crand_init(1);
+    c_forrange (i, N) ts[i] = (uint64_t)i*16 + crand_u64(&rng) % 64; // slightly out of order
+
+    smap_u64 a = {0};
+    clock_t t = clock();
+    c_forrange (i, N) smap_u64_insert(&a, ts[i], (uint64_t)i);
+    const double tins = MS(clock() - t);
+
+    smap_par b = {0};
+    t = clock();
+    c_forrange (i, N) smap_par_insert(&b, ts[i], (uint64_t)i);
+    const double tpins = MS(clock() - t);
+    smap_par_clear(&b);
+
+    smap_par_iter hint = smap_par_end(&b);
+    t = clock();
+    c_forrange (i, N) hint = smap_par_insert_hint(&b, hint, ts[i], (uint64_t)i);
+    const double thint = MS(clock() - t);
+
+    const uint64_t half = (uint64_t)(N/2)*16;
+    t = clock();
+    c_forrange (i, N) if (ts[i] < half) smap_u64_erase(&a, ts[i]);
+    const double terase = MS(clock() - t);
+
+    t = clock();
+    smap_par_erase_key_range(&b, 0, half);
+    const double trange = MS(clock() - t);
+
+    printf("insert:              %7.1f ms\n", tins);
+    printf("insert (i_parent):   %7.1f ms\n", tpins);
+    printf("insert_hint:         %7.1f ms\n", thint);
+    printf("erase half:          %7.1f ms\n", terase);
+    printf("erase_key_range:     %7.1f ms  (%d %d)\n", trange, (int)smap_u64_size(&a), (int)smap_par_size(&b));
+    smap_u64_drop(&a);
+    smap_par_drop(&b);
+    free(ts);
+}
@@ -0,0 +1,42 @@
+#define i_static
+#include "stc/crand.h"
+#define i_TYPE smap_u64, uint64_t, uint64_t
+#include "stc/smap.h"
+#define i_TYPE smap_rk, uint64_t, uint64_t
+#define i_ranked
+#include "stc/smap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Cost of the i_ranked subtree counts on insert and erase, and select(k) vs. advancing k steps
+// from begin(). Default: 1M random keys, 50 percentile queries.
+#define MS(t) ((double)(t)/CLOCKS_PER_SEC*1e3)
+
+#define RUN(M, SELECT) do { \
+    M map = {0}; crand_t rng = crand_init(1); uint64_t sum = 0; \
+    clock_t t = clock(); \
+    c_forrange (i, N) M##_insert(&map, crand_u64(&rng), i); \
+    const double tins = MS(clock() - t); \
+    t = clock(); \
+    c_forrange (q, Q) sum += SELECT(M, map, (intptr_t)(q*M##_size(&map)/Q)).ref->second; \
+    const double tsel = MS(clock() - t); \
+    rng = crand_init(1), t = clock(); \
+    c_forrange (N/2) M##_erase(&map, crand_u64(&rng)); \
+    const double terase = MS(clock() - t); \
+    printf("%-9s insert %7.1f ms, erase half %7.1f ms, %d selects %9.1f ms  (%" PRIu64 ")\n", \
+           #M, tins, terase, Q, tsel, sum % 1000); \
+    M##_drop(&map); \
+} while (0)
+
+#define WALK(M, map, k) M##_advance(M##_begin(&map), k)
+#define SELECT(M, map, k) M##_select(&map, k)
+
+int main(int argc, char const *argv[])
+{
+    const intptr_t N = argc > 1 ? atoll(argv[1]) : 1000000;
+    enum {Q = 50};
+    RUN(smap_u64, WALK);
+    RUN(smap_rk, SELECT);
+}
@@ -0,0 +1,48 @@
+#define i_TYPE sset_u64, uint64_t
+#include "stc/sset.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Union of two sets: inserting all elements of b into a clone of a is O(m log(n + m)),
+// sset_union() walks both sets in order and builds the result in O(n + m).
+// merge_into() picks inserts or a rebuild from the sizes. Default: n = 4M.
+#define MS(t) ((double)(t)/CLOCKS_PER_SEC*1e3)
+
+static sset_u64 make_set(intptr_t n, uint64_t step, uint64_t offs) {
+    sset_u64 s = sset_u64_with_capacity(n);
+    c_forrange (i, n) sset_u64_insert(&s, (uint64_t)i*step + offs);
+    return s;
+}
+
+int main(int argc, char const *argv[])
+{
+    const intptr_t N = argc > 1 ? atoll(argv[1]) : 4000000;
+    sset_u64 a = make_set(N, 2, 0);
+
+    printf("%10s %12s %12s %12s\n", "m", "inserts ms", "union ms", "merge_into ms");
+    for (intptr_t m = N/10000; m <= N; m *= 10) {
+        sset_u64 b = make_set(m, (uint64_t)(2*N/m) + 1, 1);
+
+        clock_t t = clock();
+        sset_u64 c1 = sset_u64_clone(a);
+        c_foreach (i, sset_u64, b) sset_u64_insert(&c1, *i.ref);
+        const double tins = MS(clock() - t);
+
+        t = clock();
+        sset_u64 c2 = sset_u64_union(&a, &b);
+        const double tuni = MS(clock() - t);
+
+        sset_u64 c3 = sset_u64_clone(a);
+        t = clock();
+        sset_u64_merge_into(&c3, &b);
+        const double tmrg = MS(clock() - t);
+
+        if (sset_u64_size(&c1) != sset_u64_size(&c2) || sset_u64_size(&c2) != sset_u64_size(&c3))
+            return 1;
+        printf("%10d %12.1f %12.1f %12.1f\n", (int)m, tins, tuni, tmrg);
+        c_drop(sset_u64, &b, &c1, &c2, &c3);
+    }
+    sset_u64_drop(&a);
+}
@@ -0,0 +1,40 @@
+#define i_TYPE smap_u64, uint64_t, uint64_t
+#include "stc/smap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Build a smap from sorted input: put_n() inserts one by one with rebalancing, O(n log n),
+// from_sorted_n() lays out a balanced tree in one pass, O(n). Default: 10M uint64_t pairs.
+#define MS(t) ((double)(t)/CLOCKS_PER_SEC*1e3)
+
+int main(int argc, char const *argv[])
+{
+    const intptr_t N = argc > 1 ? atoll(argv[1]) : 10000000;
+    smap_u64_raw* raw = (smap_u64_raw*)malloc(N*sizeof *raw);
+    c_forrange (i, N) raw[i] = (smap_u64_raw){(uint64_t)i*3, (uint64_t)i};
+
+    clock_t t = clock();
+    smap_u64 a = smap_u64_with_capacity(N);
+    smap_u64_put_n(&a, raw, N);
+    const double tput = MS(clock() - t);
+
+    t = clock();
+    smap_u64 b = smap_u64_from_sorted_n(raw, N);
+    const double tsorted = MS(clock() - t);
+
+    uint64_t sum = 0;
+    t = clock();
+    c_forrange (i, N/10) sum += smap_u64_get(&a, raw[(i*7919) % N].first)->second;
+    const double tgeta = MS(clock() - t);
+    t = clock();
+    c_forrange (i, N/10) sum += smap_u64_get(&b, raw[(i*7919) % N].first)->second;
+    const double tgetb = MS(clock() - t);
+
+    printf("put_n:         %7.1f ms, N/10 lookups %7.1f ms\n", tput, tgeta);
+    printf("from_sorted_n: %7.1f ms, N/10 lookups %7.1f ms  (%" PRIu64 ")\n", tsorted, tgetb, sum % 1000);
+    smap_u64_drop(&a);
+    smap_u64_drop(&b);
+    free(raw);
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include "stc/crand.h"
+#include "stc/cstr.h"
+#include "stc/algo/utility.h"
+#include "ctest.h"
+
+#define i_TYPE bmap_ii, int, int
+#define i_node_size 64 // 6 elements per leaf, 8 children per inner node: a deep tree
+#include "stc/bmap.h"
+
+#define i_TYPE smap_ii, int, int
+#include "stc/smap.h"
+
+#define i_key_str
+#include "stc/bset.h"
+
+// An allocator that fails when its budget of allocations is used up. bmap uses only malloc and free.
+static intptr_t lim_budget = -1;
+static void* lim_malloc(intptr_t sz) { return lim_budget-- == 0 ? NULL : c_malloc(sz); }
+static void lim_free(void* p, intptr_t sz) { c_free(p, sz); }
+
+#define i_TYPE bmap_lim, int, int
+#define i_node_size 64
+#define i_allocator lim
+#include "stc/bmap.h"
+
+
+CTEST(bmap, random_ops)
+{
+    smap_ii ref = {0};
+    bmap_ii map = {0};
+    crand_t rng = crand_init(13);
+
+    c_forrange (i, 200000) {
+        int key = (int)(crand_u64(&rng) % 5000);
+        if (crand_u64(&rng) % 3)
+            ASSERT_EQ(smap_ii_insert(&ref, key, (int)i).inserted,
+                      bmap_ii_insert(&map, key, (int)i).inserted);
+        else
+            ASSERT_EQ(smap_ii_erase(&ref, key), bmap_ii_erase(&map, key));
+    }
+    ASSERT_EQ(smap_ii_size(&ref), bmap_ii_size(&map));
+    ASSERT_EQ(smap_ii_front(&ref)->first, bmap_ii_front(&map)->first);
+    ASSERT_EQ(smap_ii_back(&ref)->first, bmap_ii_back(&map)->first);
+
+    bmap_ii_iter j = bmap_ii_begin(&map);
+    c_foreach (i, smap_ii, ref) {
+        ASSERT_EQ(i.ref->first, j.ref->first);
+        ASSERT_EQ(i.ref->second, j.ref->second);
+        bmap_ii_next(&j);
+    }
+    ASSERT_TRUE(j.ref == NULL);
+
+    c_forrange (k, 5001) {
+        smap_ii_iter a = smap_ii_lower_bound(&ref, (int)k);
+        bmap_ii_iter b = bmap_ii_lower_bound(&map, (int)k);
+        ASSERT_EQ(a.ref == NULL, b.ref == NULL);
+        if (a.ref) ASSERT_EQ(a.ref->first, b.ref->first);
+    }
+
+    const intptr_t n = bmap_ii_size(&map);
+    bmap_ii clone = bmap_ii_clone(map);
+    bmap_ii_erase_range(&map, bmap_ii_lower_bound(&map, 1000), bmap_ii_lower_bound(&map, 4000));
+    c_erase_if(smap_ii, &ref, value->first >= 1000 && value->first < 4000);
+    ASSERT_EQ(smap_ii_size(&ref), bmap_ii_size(&map));
+    j = bmap_ii_begin(&map);
+    c_foreach (i, smap_ii, ref)
+        ASSERT_EQ(i.ref->first, j.ref->first), bmap_ii_next(&j);
+
+    ASSERT_EQ(n, bmap_ii_size(&clone));
+    bmap_ii_erase_range(&clone, bmap_ii_begin(&clone), bmap_ii_end(&clone));
+    ASSERT_TRUE(bmap_ii_empty(&clone));
+    ASSERT_TRUE(bmap_ii_begin(&clone).ref == NULL);
+
+    bmap_ii_drop(&clone);
+    bmap_ii_drop(&map);
+    smap_ii_drop(&ref);
+}
+
+CTEST(bmap, strings)
+{
+    bset_str set = {0};
+    char buf[32];
+    c_forrange (i, 2000) {
+        snprintf(buf, sizeof buf, "%s%04d", i & 1 ? "a long string key number " : "", (int)i);
+        bset_str_emplace(&set, buf);
+    }
+    bset_str copy = bset_str_clone(set);
+    bset_str part = bset_str_clone(set); // erase a range of keys that move while it is erased
+    bset_str_erase_range(&part, bset_str_find(&part, "0100"), bset_str_find(&part, "0300"));
+    ASSERT_EQ(1900, bset_str_size(&part));
+    ASSERT_FALSE(bset_str_contains(&part, "0298"));
+    ASSERT_TRUE(bset_str_contains(&part, "0300"));
+    ASSERT_TRUE(bset_str_contains(&part, "0098"));
+    bset_str_drop(&part);
+
+    // Erase every other key, smallest first: the separator keys in the inner nodes are replaced.
+    c_forrange (i, 0, 2000, 2) {
+        snprintf(buf, sizeof buf, "%04d", (int)i);
+        ASSERT_EQ(1, bset_str_erase(&set, buf));
+    }
+    ASSERT_EQ(1000, bset_str_size(&set));
+    c_forrange (i, 1, 2000, 2) {
+        snprintf(buf, sizeof buf, "a long string key number %04d", (int)i);
+        ASSERT_TRUE(bset_str_contains(&set, buf));
+    }
+    ASSERT_EQ(2000, bset_str_size(&copy));
+    ASSERT_STREQ("0000", cstr_str(bset_str_front(&copy)));
+
+    const char* prev = "";
+    c_foreach (i, bset_str, copy) {
+        ASSERT_TRUE(strcmp(prev, cstr_str(i.ref)) < 0);
+        prev = cstr_str(i.ref);
+    }
+    bset_str_drop(&copy);
+    bset_str_drop(&set);
+}
+
+CTEST(bmap, clone_out_of_memory)
+{
+    bmap_lim map = {0};
+    int n_ok = 0;
+    c_forrange (i, 1000) bmap_lim_insert(&map, (int)i, (int)i);
+    c_forrange (budget, 0, 1000, 9) { // fail at allocation budget of the clone: no leaks, empty clone
+        lim_budget = budget;
+        bmap_lim clone = bmap_lim_clone(map);
+        const bool ok = lim_budget >= 0;
+        lim_budget = -1;
+        ASSERT_EQ(ok ? 1000 : 0, bmap_lim_size(&clone));
+        ASSERT_EQ(ok, !bmap_lim_empty(&clone));
+        bmap_lim_drop(&clone);
+        n_ok += ok;
+    }
+    ASSERT_TRUE(n_ok > 0 && n_ok < 112);
+    bmap_lim_drop(&map);
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include "stc/cstr.h"
+#include "ctest.h"
+
+#define i_TYPE chmap_ii, int, int
+#define i_shards 8
+#include "stc/chmap.h"
+
+#define i_key_str
+#define i_val int
+#include "stc/chmap.h"
+
+#define i_TYPE chmap_cu, uint64_t, int
+#define i_compact
+#include "stc/chmap.h"
+
+#define i_TYPE chmap_u, uint64_t, int
+#include "stc/chmap.h"
+
+enum {NTHREADS = 4, PER_THREAD = 20000};
+
+typedef struct { chmap_ii* map; int id; int found; } worker_arg;
+
+static void* worker(void* arg) {
+    worker_arg* w = (worker_arg*)arg;
+    c_forrange (i, PER_THREAD) {
+        const int key = (int)i*NTHREADS + w->id;
+        chmap_ii_insert(w->map, key, key*2);
+        w->found += chmap_ii_contains(w->map, key - NTHREADS);
+        if (i & 1) chmap_ii_erase(w->map, key - NTHREADS);
+    }
+    return NULL;
+}
+
+CTEST(chmap, threads)
+{
+    chmap_ii map;
+    chmap_ii_init(&map);
+    worker_arg args[NTHREADS];
+#if defined _WIN32
+    c_forrange (t, NTHREADS) {
+        args[t] = c_LITERAL(worker_arg){&map, (int)t};
+        worker(&args[t]);
+    }
+#else
+    pthread_t th[NTHREADS];
+    c_forrange (t, NTHREADS) {
+        args[t] = c_LITERAL(worker_arg){&map, (int)t};
+        pthread_create(&th[t], NULL, worker, &args[t]);
+    }
+    c_forrange (t, NTHREADS)
+        pthread_join(th[t], NULL);
+#endif
+    intptr_t n = 0;
+    c_forrange (t, NTHREADS)
+        ASSERT_EQ(PER_THREAD - 1, args[t].found);
+    c_forrange (s, chmap_ii_shard_count(&map)) {
+        const chmap_ii_shard* shard = chmap_ii_read_lock(&map, s);
+        c_foreach (i, chmap_ii_shard, *shard) {
+            ASSERT_EQ(i.ref->first*2, i.ref->second);
+            ++n;
+        }
+        chmap_ii_read_unlock(&map, s);
+    }
+    ASSERT_EQ(NTHREADS*PER_THREAD/2, n);
+    ASSERT_EQ(n, chmap_ii_size(&map));
+    chmap_ii_drop(&map);
+}
+
+CTEST(chmap, strings)
+{
+    chmap_str map;
+    chmap_str_init(&map);
+    int val = 0;
+    ASSERT_TRUE(chmap_str_emplace(&map, "one", 1));
+    ASSERT_FALSE(chmap_str_emplace(&map, "one", 2));
+    ASSERT_TRUE(chmap_str_insert(&map, cstr_lit("two"), 2));
+    ASSERT_FALSE(chmap_str_insert_or_assign(&map, cstr_lit("two"), 22));
+    ASSERT_TRUE(chmap_str_get(&map, "two", &val));
+    ASSERT_EQ(22, val);
+    ASSERT_FALSE(chmap_str_get(&map, "three", &val));
+    ASSERT_EQ(1, chmap_str_erase(&map, "one"));
+    ASSERT_EQ(0, chmap_str_erase(&map, "one"));
+    ASSERT_EQ(1, chmap_str_size(&map));
+    chmap_str_clear(&map);
+    ASSERT_EQ(0, chmap_str_size(&map));
+    chmap_str_drop(&map);
+}
+
+CTEST(chmap, compact)
+{
+    chmap_cu map;
+    chmap_cu_init(&map);
+    c_forrange (i, 100000)
+        chmap_cu_insert(&map, i*0x9E3779B97F4A7C15, (int)i);
+    ASSERT_EQ(100000, chmap_cu_size(&map));
+    c_forrange (s, chmap_cu_shard_count(&map)) { // the keys of a shard spread over all its buckets
+        const chmap_cu_shard* shard = chmap_cu_read_lock(&map, s);
+        hmap_stats st = chmap_cu_shard_stats(shard);
+        chmap_cu_read_unlock(&map, s);
+        ASSERT_TRUE(st.size > 0);
+        ASSERT_TRUE(st.longest_cluster < 200);
+    }
+    int val = 0;
+    ASSERT_TRUE(chmap_cu_get(&map, 777*0x9E3779B97F4A7C15, &val));
+    ASSERT_EQ(777, val);
+    chmap_cu_drop(&map);
+}
+
+CTEST(chmap, tag_spread)
+{
+    chmap_u map;
+    chmap_u_init(&map);
+    c_forrange (i, 200000)
+        chmap_u_insert(&map, i*0x9E3779B97F4A7C15, (int)i);
+    double tag_collisions = 0;
+    c_forrange (s, chmap_u_shard_count(&map)) { // the keys of a shard use all the tag values
+        const chmap_u_shard* shard = chmap_u_read_lock(&map, s);
+        tag_collisions += chmap_u_shard_stats(shard).tag_collisions;
+        chmap_u_read_unlock(&map, s);
+    }
+    tag_collisions /= (double)chmap_u_shard_count(&map);
+    ASSERT_TRUE(tag_collisions < 0.1);
+    chmap_u_drop(&map);
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include "stc/crand.h"
+#include "stc/cstr.h"
+#include "ctest.h"
+
+#define i_TYPE fmap_ii, int, int
+#include "stc/fmap.h"
+
+#define i_TYPE hmap_ii2, int, int
+#include "stc/hmap.h"
+
+#define i_key_str
+#define i_val int
+#include "stc/fmap.h"
+
+#define i_TYPE fmap_uu, uint64_t, int
+#define i_hash(x) (*(x)) // the identity, to construct hashes that collide for every pilot
+#include "stc/fmap.h"
+
+static uint64_t unmix(uint64_t x) { // inverse of _fmap_mix()
+    x ^= x >> 33; x *= 0x9cb4b2f8129337db;
+    x ^= x >> 33; x *= 0x4f74430c22a54005;
+    return x ^ (x >> 33);
+}
+
+
+CTEST(fmap, freeze)
+{
+    hmap_ii2 ref = {0};
+    fmap_ii map = {0};
+    crand_t rng = crand_init(7);
+
+    c_forrange (i, 50000) {
+        int key = (int)(crand_u64(&rng) % 100000);
+        hmap_ii2_insert(&ref, key, (int)i); // keeps first
+        fmap_ii_insert(&map, key, (int)i);
+    }
+    ASSERT_FALSE(fmap_ii_is_frozen(&map));
+    ASSERT_TRUE(fmap_ii_freeze(&map));
+    ASSERT_EQ(hmap_ii2_size(&ref), fmap_ii_size(&map));
+
+    c_foreach (i, hmap_ii2, ref)
+        ASSERT_EQ(i.ref->second, *fmap_ii_at(&map, i.ref->first));
+    c_forrange (i, 100000)
+        ASSERT_EQ(hmap_ii2_contains(&ref, (int)i), fmap_ii_contains(&map, (int)i));
+
+    intptr_t n = 0;
+    c_foreach (i, fmap_ii, map)
+        ASSERT_TRUE(hmap_ii2_contains(&ref, i.ref->first)), ++n;
+    ASSERT_EQ(fmap_ii_size(&map), n);
+
+    fmap_ii clone = fmap_ii_clone(map);
+    ASSERT_EQ(*fmap_ii_at(&map, 0), *fmap_ii_at(&clone, 0));
+    fmap_ii_insert(&clone, -1, -1); // thaws
+    ASSERT_FALSE(fmap_ii_is_frozen(&clone));
+    ASSERT_TRUE(fmap_ii_freeze(&clone));
+    ASSERT_EQ(-1, *fmap_ii_at(&clone, -1));
+
+    fmap_ii_drop(&clone);
+    fmap_ii_drop(&map);
+    hmap_ii2_drop(&ref);
+}
+
+CTEST(fmap, from_n)
+{
+    fmap_str_raw raw[] = {{"one", 1}, {"two", 2}, {"three", 3}, {"two", 4}};
+    fmap_str map = fmap_str_from_n(raw, c_arraylen(raw));
+    ASSERT_EQ(3, fmap_str_size(&map));
+    ASSERT_EQ(2, *fmap_str_at(&map, "two"));
+    ASSERT_EQ(3, *fmap_str_at(&map, "three"));
+    ASSERT_TRUE(fmap_str_get(&map, "four") == NULL);
+    fmap_str_drop(&map);
+
+    fmap_str empty = {0};
+    ASSERT_TRUE(fmap_str_freeze(&empty));
+    ASSERT_FALSE(fmap_str_contains(&empty, "one"));
+    fmap_str_drop(&empty);
+}
+
+CTEST(fmap, pilot_collision)
+{
+    fmap_uu map = {0};
+    const uint64_t h = 0x123456789abcdef0;
+    c_forrange (i, 100) fmap_uu_insert(&map, i, (int)i);
+    fmap_uu_insert(&map, unmix(h), 100);
+    fmap_uu_insert(&map, 7, 107); // a duplicate, dropped only by a freeze that succeeds
+    fmap_uu_insert(&map, unmix(h ^ (uint64_t)1 << 32), 101);
+    ASSERT_EQ(h, _fmap_mix(unmix(h)));
+    ASSERT_FALSE(fmap_uu_freeze(&map));
+    ASSERT_FALSE(fmap_uu_is_frozen(&map));
+    ASSERT_EQ(103, fmap_uu_size(&map));
+    fmap_uu_drop(&map);
+}
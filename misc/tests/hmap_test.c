@@ -0,0 +1,523 @@
+#include <stdio.h>
+#include "stc/crand.h"
+#include "stc/cstr.h"
+#include "stc/algo/utility.h"
+#include "ctest.h"
+
+#define i_TYPE hmap_ii, int, int
+#include "stc/hmap.h"
+
+#define i_TYPE hmap_sii, int, int
+#define i_simd
+#include "stc/hmap.h"
+
+#define i_TYPE hmap_iii, int, int
+#define i_incremental
+#define i_incremental_step 2
+#include "stc/hmap.h"
+
+#define i_TYPE hmap_hii, int, int
+#define i_store_hash
+#define i_incremental
+#define i_simd
+#include "stc/hmap.h"
+
+#define i_TYPE hmap_rii, int, int
+#define i_robinhood
+#define i_max_load_factor 0.95f
+#include "stc/hmap.h"
+
+// Only 64 distinct hashes: clusters far longer than the saturated probe distance 255.
+#define i_TYPE hmap_rci, int, int
+#define i_hash(x) ((uint64_t)(*(x) & 63)*0x9E3779B97F4A7C15)
+#define i_robinhood
+#define i_store_hash
+#define i_incremental
+#include "stc/hmap.h"
+
+#define i_TYPE hmap_tii, int, int
+#define i_stats
+#include "stc/hmap.h"
+
+// One hash for all keys: every key has the same home bucket and tag.
+#define i_TYPE hmap_sti, int, int
+#define i_hash(x) ((uint64_t)(*(x) & 0) + 0x9E3779B97F4A7C15)
+#define i_simd
+#define i_stats
+#include "stc/hmap.h"
+
+#define i_TYPE hmap_cii, int, int
+#define i_compact
+#define i_robinhood
+#define i_store_hash
+#include "stc/hmap.h"
+
+#define i_TYPE hmap_oii, int, int
+#define i_soa
+#define i_incremental
+#define i_incremental_step 2
+#include "stc/hmap.h"
+
+#define i_type hmap_ors
+#define i_key int
+#define i_val_str
+#define i_soa
+#define i_robinhood
+#include "stc/hmap.h"
+
+#define i_type hmap_hsi
+#define i_key_str
+#define i_val int
+#define i_store_hash
+#include "stc/hmap.h"
+
+
+CTEST(hmap, simd_probing)
+{
+    hmap_ii ref = {0};
+    hmap_sii map = {0};
+    crand_t rng = crand_init(123);
+
+    c_forrange (i, 200000) {
+        int key = (int)(crand_u64(&rng) % 20000);
+        switch (crand_u64(&rng) % 3) {
+            case 0:
+                hmap_ii_insert(&ref, key, (int)i);
+                hmap_sii_insert(&map, key, (int)i);
+                break;
+            case 1:
+                ASSERT_EQ(hmap_ii_erase(&ref, key), hmap_sii_erase(&map, key));
+                break;
+            case 2: {
+                const hmap_ii_value* r = hmap_ii_get(&ref, key);
+                const hmap_sii_value* v = hmap_sii_get(&map, key);
+                ASSERT_EQ(r == NULL, v == NULL);
+                if (r) ASSERT_EQ(r->second, v->second);
+            }
+        }
+    }
+    ASSERT_EQ(hmap_ii_size(&ref), hmap_sii_size(&map));
+
+    intptr_t n = 0;
+    c_foreach (i, hmap_sii, map) {
+        ASSERT_EQ(*hmap_ii_at(&ref, i.ref->first), i.ref->second);
+        ++n;
+    }
+    ASSERT_EQ(hmap_sii_size(&map), n);
+
+    hmap_ii_drop(&ref);
+    hmap_sii_drop(&map);
+}
+
+CTEST(hmap, robinhood)
+{
+    hmap_ii ref = {0};
+    hmap_rii map = {0};
+    hmap_rci col = {0};
+    crand_t rng = crand_init(321);
+
+    c_forrange (i, 200000) {
+        int key = (int)(crand_u64(&rng) % 20000);
+        if (i & 1) key <<= 8; // clustered keys
+        switch (crand_u64(&rng) % 3) {
+            case 0:
+                hmap_ii_insert(&ref, key, (int)i);
+                hmap_rii_insert(&map, key, (int)i);
+                if (key < 4000) hmap_rci_insert(&col, key, (int)i);
+                break;
+            case 1:
+                ASSERT_EQ(hmap_ii_erase(&ref, key), hmap_rii_erase(&map, key));
+                if (key < 4000) hmap_rci_erase(&col, key);
+                break;
+            case 2: {
+                const hmap_ii_value* r = hmap_ii_get(&ref, key);
+                const hmap_rii_value* v = hmap_rii_get(&map, key);
+                ASSERT_EQ(r == NULL, v == NULL);
+                if (r) ASSERT_EQ(r->second, v->second);
+                if (key < 4000) {
+                    const hmap_rci_value* c = hmap_rci_get(&col, key);
+                    ASSERT_EQ(r == NULL, c == NULL);
+                    if (r) ASSERT_EQ(r->second, c->second);
+                }
+            }
+        }
+    }
+    ASSERT_EQ(hmap_ii_size(&ref), hmap_rii_size(&map));
+    c_foreach (i, hmap_rii, map)
+        ASSERT_EQ(*hmap_ii_at(&ref, i.ref->first), i.ref->second);
+
+    intptr_t n = 0;
+    c_foreach (i, hmap_rci, col) {
+        ASSERT_EQ(*hmap_ii_at(&ref, i.ref->first), i.ref->second);
+        ++n;
+    }
+    ASSERT_EQ(hmap_rci_size(&col), n);
+
+    hmap_ii_drop(&ref);
+    hmap_rii_drop(&map);
+    hmap_rci_drop(&col);
+}
+
+CTEST(hmap, stats)
+{
+    hmap_tii map = {0};
+    hmap_rci col = {0}; // 64 distinct hashes
+    hmap_stats st = hmap_tii_stats(&map);
+    ASSERT_EQ(0, st.size);
+    ASSERT_EQ(0, st.max_probe);
+
+    c_forrange (i, 10000) {
+        hmap_tii_insert(&map, (int)i, (int)i);
+        hmap_rci_insert(&col, (int)i & 1023, (int)i);
+    }
+    c_forrange (i, 20000)
+        hmap_tii_contains(&map, (int)i);
+
+    st = hmap_tii_stats(&map);
+    intptr_t n = 0;
+    c_forrange (k, hmap_STATS_BINS) n += st.probe_hist[k];
+    ASSERT_EQ(10000, n);
+    ASSERT_EQ(st.size, hmap_tii_size(&map));
+    ASSERT_TRUE(st.hit_cost >= 1.0 && st.hit_cost < 3.0);
+    ASSERT_TRUE(st.miss_cost >= 1.0 && st.miss_cost < 10.0);
+    ASSERT_TRUE(st.max_probe <= st.longest_cluster);
+    ASSERT_TRUE(st.counters.resizes > 0);
+    ASSERT_TRUE(st.counters.lookups >= 30000);
+    ASSERT_TRUE(st.counters.probes >= 10000); // hits
+    ASSERT_TRUE(st.counters.eq_calls >= 10000);
+    ASSERT_TRUE(st.counters.eq_fails <= st.counters.eq_calls);
+
+    hmap_tii_reset_counters(&map);
+    hmap_tii_contains(&map, 5);
+    st = hmap_tii_stats(&map);
+    ASSERT_EQ(1, st.counters.lookups);
+    ASSERT_EQ(1, st.counters.eq_calls - st.counters.eq_fails);
+
+    st = hmap_rci_stats(&col);
+    ASSERT_EQ(1024, st.size);
+    ASSERT_TRUE(st.max_probe >= 16); // 16 keys per hash
+    ASSERT_TRUE(st.longest_cluster >= 16);
+    ASSERT_TRUE(st.tag_collisions > 1.0);
+    ASSERT_EQ(0, st.counters.lookups); // no i_stats
+
+    hmap_tii_drop(&map);
+    hmap_rci_drop(&col);
+
+    hmap_sti one = {0}; // i_simd: each slot is compared once, also the home slot
+    c_forrange (i, 5) hmap_sti_insert(&one, (int)i, (int)i);
+    hmap_sti_reset_counters(&one);
+    ASSERT_FALSE(hmap_sti_contains(&one, 99));
+    st = hmap_sti_stats(&one);
+    ASSERT_EQ(5, st.counters.eq_calls);
+    ASSERT_EQ(5, st.counters.eq_fails);
+    hmap_sti_drop(&one);
+}
+
+CTEST(hmap, incremental_resize)
+{
+    hmap_iii map = {0};
+    int n = 0;
+
+    // insert until a resize is in progress
+    while (n < 1000 || map._old.size == 0) {
+        hmap_iii_insert(&map, n, n*2);
+        ++n;
+    }
+    ASSERT_EQ(n, hmap_iii_size(&map));
+    c_forrange (i, n)
+        ASSERT_EQ(i*2, *hmap_iii_at(&map, (int)i));
+
+    // erase while iterating over both tables
+    intptr_t count = 0;
+    for (hmap_iii_iter it = hmap_iii_begin(&map); it.ref; ) {
+        if (it.ref->first & 1) it = hmap_iii_erase_at(&map, it);
+        else ++count, hmap_iii_next(&it);
+    }
+    ASSERT_EQ(hmap_iii_size(&map), count);
+    ASSERT_EQ((n + 1)/2, count);
+
+    hmap_iii clone = hmap_iii_clone(map);
+    ASSERT_TRUE(hmap_iii_eq(&clone, &map));
+
+    c_forrange (i, n) // completes the migration
+        ASSERT_EQ(i & 1, hmap_iii_erase(&map, (int)i) == 0);
+    ASSERT_TRUE(map._old.table == NULL);
+    ASSERT_EQ(0, hmap_iii_size(&map));
+
+    hmap_iii_drop(&clone);
+    hmap_iii_drop(&map);
+}
+
+CTEST(hmap, store_hash)
+{
+    hmap_ii ref = {0};
+    hmap_hii map = {0};
+    hmap_hsi smap = {0};
+    crand_t rng = crand_init(42);
+
+    c_forrange (i, 100000) {
+        int key = (int)(crand_u64(&rng) % 5000);
+        char buf[16];
+        snprintf(buf, sizeof buf, "k%d", key);
+        if (crand_u64(&rng) & 1) {
+            hmap_ii_insert(&ref, key, (int)i);
+            hmap_hii_insert(&map, key, (int)i);
+            hmap_hsi_insert(&smap, cstr_from(buf), (int)i);
+        } else {
+            int n = hmap_ii_erase(&ref, key);
+            ASSERT_EQ(n, hmap_hii_erase(&map, key));
+            ASSERT_EQ(n, hmap_hsi_erase(&smap, buf));
+        }
+    }
+    ASSERT_EQ(hmap_ii_size(&ref), hmap_hii_size(&map));
+    ASSERT_EQ(hmap_ii_size(&ref), hmap_hsi_size(&smap));
+    hmap_hsi_reserve(&smap, hmap_hsi_size(&smap)*8);
+
+    c_foreach (i, hmap_ii, ref) {
+        char buf[16];
+        snprintf(buf, sizeof buf, "k%d", i.ref->first);
+        ASSERT_EQ(i.ref->second, *hmap_hii_at(&map, i.ref->first));
+        ASSERT_EQ(i.ref->second, *hmap_hsi_at(&smap, buf));
+    }
+    hmap_ii_drop(&ref);
+    hmap_hii_drop(&map);
+    hmap_hsi_drop(&smap);
+}
+
+CTEST(hmap, batch)
+{
+    hmap_ii map = {0};
+    hmap_ii_raw raw[100];
+    int keys[150];
+    const hmap_ii_value* out[150];
+    bool found[150];
+
+    c_forrange (i, 100)
+        raw[i] = c_LITERAL(hmap_ii_raw){(int)i*3, (int)i};
+    ASSERT_EQ(100, hmap_ii_emplace_n(&map, raw, 100));
+    ASSERT_EQ(0, hmap_ii_emplace_n(&map, raw, 50));
+    ASSERT_EQ(100, hmap_ii_size(&map));
+
+    c_forrange (i, 150)
+        keys[i] = (int)i*2;
+    ASSERT_EQ(50, hmap_ii_get_n(&map, keys, 150, out));
+    ASSERT_EQ(50, hmap_ii_contains_n(&map, keys, 150, found));
+    c_forrange (i, 150) {
+        ASSERT_EQ(i % 3 == 0 && i < 150, out[i] != NULL);
+        ASSERT_EQ(out[i] != NULL, found[i]);
+        if (out[i]) ASSERT_EQ((int)i*2/3, out[i]->second);
+    }
+    hmap_ii_drop(&map);
+
+    hmap_hsi smap = {0};
+    const char* words[] = {"one", "two", "three", "two"};
+    hmap_hsi_raw sraw[] = {{"one", 1}, {"two", 2}, {"three", 3}, {"two", 4}};
+    ASSERT_EQ(3, hmap_hsi_emplace_n(&smap, sraw, 4));
+    ASSERT_EQ(4, hmap_hsi_contains_n(&smap, words, 4, found));
+    ASSERT_EQ(2, *hmap_hsi_at(&smap, "two"));
+    hmap_hsi_drop(&smap);
+}
+
+CTEST(hmap, write_view)
+{
+    hmap_hii map = {0}; // stored hashes, with SIMD padded slots
+    c_forrange (i, 10000)
+        hmap_hii_insert(&map, (int)i*7, (int)i);
+    hmap_hii_reserve(&map, 0); // completes the incremental resize
+
+    FILE* fp = tmpfile();
+    ASSERT_TRUE(fp != NULL);
+    ASSERT_TRUE(hmap_hii_write(&map, fp));
+    const long size = ftell(fp);
+    void* mem = malloc(size);
+    rewind(fp);
+    ASSERT_EQ(1, fread(mem, size, 1, fp));
+    fclose(fp);
+
+    hmap_hii view;
+    ASSERT_TRUE(hmap_hii_map_view(&view, mem, size));
+    ASSERT_EQ(hmap_hii_size(&map), hmap_hii_size(&view));
+    c_forrange (i, 70000)
+        ASSERT_EQ(i % 7 == 0, hmap_hii_contains(&view, (int)i));
+    ASSERT_EQ(1234, *hmap_hii_at(&view, 1234*7));
+    intptr_t n = 0;
+    c_foreach (i, hmap_hii, view) ++n;
+    ASSERT_EQ(hmap_hii_size(&map), n);
+
+    ASSERT_FALSE(hmap_hii_map_view(&view, mem, size - 1)); // truncated
+    ASSERT_FALSE(hmap_ii_map_view((hmap_ii*)&view, mem, size)); // type mismatch
+    free(mem);
+    hmap_hii_drop(&map);
+}
+
+CTEST(hmap, soa)
+{
+    hmap_ii ref = {0};
+    hmap_oii map = {0};
+    crand_t rng = crand_init(456);
+
+    c_forrange (i, 200000) {
+        int key = (int)(crand_u64(&rng) % 20000);
+        switch (crand_u64(&rng) % 3) {
+            case 0:
+                hmap_ii_insert_or_assign(&ref, key, (int)i);
+                hmap_oii_insert_or_assign(&map, key, (int)i);
+                break;
+            case 1:
+                ASSERT_EQ(hmap_ii_erase(&ref, key), hmap_oii_erase(&map, key));
+                break;
+            case 2: {
+                const hmap_ii_value* r = hmap_ii_get(&ref, key);
+                hmap_oii_iter it = hmap_oii_find(&map, key);
+                ASSERT_EQ(r == NULL, it.ref == NULL);
+                if (r) ASSERT_EQ(r->second, *it.val);
+                if (r) ASSERT_EQ(key, *it.ref);
+            }
+        }
+    }
+    ASSERT_EQ(hmap_ii_size(&ref), hmap_oii_size(&map));
+    intptr_t n = 0;
+    c_foreach (i, hmap_oii, map) {
+        ASSERT_EQ(*hmap_ii_at(&ref, *i.ref), *i.val);
+        ++n;
+    }
+    ASSERT_EQ(hmap_oii_size(&map), n);
+
+    hmap_ors str = {0};
+    c_forrange (i, 1000)
+        hmap_ors_emplace(&str, (int)i, "a string value too long for short string optimization");
+    c_forrange (i, 0, 1000, 3)
+        hmap_ors_erase(&str, (int)i);
+    hmap_ors_result res = hmap_ors_emplace_or_assign(&str, 7, "seven");
+    ASSERT_FALSE(res.inserted);
+    ASSERT_STREQ("seven", cstr_str(res.val));
+    hmap_ors copy = hmap_ors_clone(str);
+    ASSERT_EQ(666, hmap_ors_size(&copy));
+    ASSERT_STREQ("seven", cstr_str(hmap_ors_at(&copy, 7)));
+
+    hmap_ii_drop(&ref);
+    hmap_oii_drop(&map);
+    hmap_ors_drop(&str);
+    hmap_ors_drop(&copy);
+}
+
+CTEST(hmap, compact)
+{
+    hmap_ii ref = {0};
+    hmap_cii map = {0};
+    crand_t rng = crand_init(789);
+
+    c_forrange (i, 200000) {
+        int key = (int)(crand_u64(&rng) % 20000);
+        switch (crand_u64(&rng) % 3) {
+            case 0:
+                hmap_ii_insert(&ref, key, (int)i);
+                hmap_cii_insert(&map, key, (int)i);
+                break;
+            case 1:
+                ASSERT_EQ(hmap_ii_erase(&ref, key), hmap_cii_erase(&map, key));
+                break;
+            case 2: {
+                const hmap_ii_value* r = hmap_ii_get(&ref, key);
+                const hmap_cii_value* v = hmap_cii_get(&map, key);
+                ASSERT_EQ(r == NULL, v == NULL);
+                if (r) ASSERT_EQ(r->second, v->second);
+            }
+        }
+    }
+    ASSERT_EQ(hmap_ii_size(&ref), hmap_cii_size(&map));
+    c_foreach (i, hmap_cii, map)
+        ASSERT_EQ(*hmap_ii_at(&ref, i.ref->first), i.ref->second);
+
+    hmap_cii_reserve(&map, 100000); // not rounded up to a power of 2
+    ASSERT_TRUE(hmap_cii_bucket_count(&map) < 100000/0.8 + 16);
+    ASSERT_TRUE(hmap_cii_bucket_count(&map) & (hmap_cii_bucket_count(&map) - 1));
+    ASSERT_EQ(hmap_ii_size(&ref), hmap_cii_size(&map));
+
+    FILE* fp = tmpfile();
+    ASSERT_TRUE(fp != NULL);
+    ASSERT_TRUE(hmap_cii_write(&map, fp));
+    const long size = ftell(fp);
+    void* mem = malloc(size);
+    rewind(fp);
+    ASSERT_EQ(1, fread(mem, size, 1, fp));
+    fclose(fp);
+    hmap_cii view;
+    ASSERT_TRUE(hmap_cii_map_view(&view, mem, size));
+    c_foreach (i, hmap_ii, ref)
+        ASSERT_EQ(i.ref->second, *hmap_cii_at(&view, i.ref->first));
+    free(mem);
+
+    hmap_ii_drop(&ref);
+    hmap_cii_drop(&map);
+}
+
+CTEST(hmap, copy)
+{
+    hmap_ii map = {0};
+    c_forrange (i, 5000)
+        hmap_ii_insert(&map, (int)i*3, (int)i);
+    hmap_ii copy = hmap_ii_clone(map);
+    ASSERT_TRUE(hmap_ii_eq(&map, &copy));
+
+    c_forrange (i, 1000)
+        hmap_ii_erase(&map, (int)i*3);
+    hmap_ii_insert(&map, -1, -1);
+    const hmap_ii_value* table = copy.table;
+    hmap_ii_copy(&copy, &map); // same bucket count: buffers are reused
+    ASSERT_TRUE(copy.table == table);
+    ASSERT_EQ(hmap_ii_size(&map), hmap_ii_size(&copy));
+    c_foreach (i, hmap_ii, map)
+        ASSERT_EQ(i.ref->second, *hmap_ii_at(&copy, i.ref->first));
+
+    hmap_ii_drop(&map);
+    hmap_ii_drop(&copy);
+}
+
+static bool even_mapped(const hmap_rci_value* val, void* ctx)
+    { (void)ctx; return !(val->second & 1); }
+
+static bool take_short(hmap_hsi_value* val, void* ctx) {
+    cstr* out = (cstr*)ctx; // take ownership of keys shorter than 5
+    if (cstr_size(&val->first) >= 5) return false;
+    out[val->second] = val->first;
+    return true;
+}
+
+CTEST(hmap, retain)
+{
+    hmap_ii ref = {0};
+    hmap_rci map = {0}; // robin hood, colliding hashes, incremental
+    crand_t rng = crand_init(99);
+    c_forrange (i, 20) {
+        c_forrange (j, 2000) {
+            int key = (int)(crand_u64(&rng) % 4000), val = (int)(crand_u64(&rng) % 1000);
+            hmap_ii_insert_or_assign(&ref, key, val);
+            hmap_rci_insert_or_assign(&map, key, val);
+        }
+        intptr_t n = hmap_ii_size(&ref);
+        c_erase_if(hmap_ii, &ref, value->second & 1);
+        ASSERT_EQ(n - hmap_ii_size(&ref), hmap_rci_retain(&map, even_mapped, NULL));
+        ASSERT_EQ(hmap_ii_size(&ref), hmap_rci_size(&map));
+        c_foreach (k, hmap_ii, ref)
+            ASSERT_EQ(k.ref->second, *hmap_rci_at(&map, k.ref->first));
+    }
+
+    hmap_hsi smap = {0};
+    cstr taken[1000] = {0};
+    char buf[16];
+    c_forrange (i, 1000) {
+        snprintf(buf, sizeof buf, "%d", (int)i*17);
+        hmap_hsi_insert(&smap, cstr_from(buf), (int)i);
+    }
+    ASSERT_EQ(589, hmap_hsi_drain_if(&smap, take_short, taken)); // 17*i < 10000
+    ASSERT_EQ(411, hmap_hsi_size(&smap));
+    ASSERT_STREQ("9996", cstr_str(&taken[588]));
+    ASSERT_FALSE(hmap_hsi_contains(&smap, "9996"));
+    ASSERT_TRUE(hmap_hsi_contains(&smap, "10013"));
+    c_forrange (i, 1000) cstr_drop(&taken[i]);
+
+    hmap_ii_drop(&ref);
+    hmap_rci_drop(&map);
+    hmap_hsi_drop(&smap);
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include "stc/crand.h"
+#include "stc/cstr.h"
+#include "ctest.h"
+
+#define i_TYPE imap_ii, int, int
+#include "stc/imap.h"
+
+#define i_TYPE hmap_ii3, int, int
+#include "stc/hmap.h"
+
+#define i_key_str
+#define i_val_str
+#include "stc/imap.h"
+
+
+CTEST(imap, random_ops)
+{
+    hmap_ii3 ref = {0};
+    imap_ii map = {0};
+    crand_t rng = crand_init(11);
+
+    c_forrange (i, 100000) {
+        int key = (int)(crand_u64(&rng) % 2000);
+        switch (crand_u64(&rng) % 4) {
+            case 0: case 1:
+                ASSERT_EQ(hmap_ii3_insert(&ref, key, (int)i).inserted,
+                          imap_ii_insert(&map, key, (int)i).inserted);
+                break;
+            case 2:
+                ASSERT_EQ(hmap_ii3_erase(&ref, key), imap_ii_erase(&map, key));
+                break;
+            case 3:
+                ASSERT_EQ(hmap_ii3_erase(&ref, key), imap_ii_swap_erase(&map, key));
+        }
+    }
+    ASSERT_EQ(hmap_ii3_size(&ref), imap_ii_size(&map));
+    c_foreach (i, hmap_ii3, ref)
+        ASSERT_EQ(i.ref->second, *imap_ii_at(&map, i.ref->first));
+
+    imap_ii_shrink_to_fit(&map);
+    ASSERT_EQ(imap_ii_size(&map), imap_ii_capacity(&map));
+    c_foreach (i, imap_ii, map)
+        ASSERT_EQ(i.ref - map.data, imap_ii_index_of(&map, i.ref->first));
+
+    hmap_ii3_drop(&ref);
+    imap_ii_drop(&map);
+}
+
+CTEST(imap, insertion_order)
+{
+    imap_ii map = {0};
+    c_forrange (i, 10)
+        imap_ii_insert(&map, 100 - (int)i, (int)i);
+    imap_ii_insert(&map, 95, -1); // exists: no change
+
+    imap_ii_erase(&map, 98);      // order preserving
+    imap_ii_swap_erase(&map, 93); // 91 takes its place
+    int expect[] = {100, 99, 97, 96, 95, 94, 91, 92};
+    int n = 0;
+    c_foreach (i, imap_ii, map)
+        ASSERT_EQ(expect[n++], i.ref->first);
+    ASSERT_EQ(8, n);
+
+    // erase odd keys while iterating, in both modes
+    for (imap_ii_iter it = imap_ii_begin(&map); it.ref; ) {
+        if (it.ref->first & 1) it = imap_ii_erase_at(&map, it);
+        else imap_ii_next(&it);
+    }
+    int even[] = {100, 96, 94, 92};
+    n = 0;
+    c_foreach (i, imap_ii, map)
+        ASSERT_EQ(even[n++], i.ref->first);
+    ASSERT_EQ(4, n);
+    imap_ii_drop(&map);
+
+    imap_str smap = {0};
+    imap_str_emplace(&smap, "one", "1");
+    imap_str_emplace(&smap, "two", "2");
+    imap_str_emplace_or_assign(&smap, "one", "ONE");
+    imap_str clone = imap_str_clone(smap);
+    imap_str_swap_erase(&smap, "one");
+    ASSERT_STREQ("two", cstr_str(&smap.data[0].first));
+    ASSERT_STREQ("ONE", cstr_str(imap_str_at(&clone, "one")));
+    ASSERT_TRUE(imap_str_get(&smap, "one") == NULL);
+    imap_str_drop(&clone);
+    imap_str_drop(&smap);
+}
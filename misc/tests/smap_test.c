@@ -0,0 +1,446 @@
+#include <stdio.h>
+#include "stc/crand.h"
+#include "stc/cstr.h"
+#include "stc/algo/utility.h"
+#include "ctest.h"
+
+#define i_TYPE smap_int, int, int
+#include "stc/smap.h"
+
+#define i_TYPE smap_rk, int, int
+#define i_ranked
+#include "stc/smap.h"
+
+#define i_TYPE smap_par, int, int
+#define i_parent
+#define i_ranked
+#include "stc/smap.h"
+
+static long smap_ncmp; // compares made by smap_cnt
+#define i_TYPE smap_cnt, int, int
+#define i_cmp(x, y) (++smap_ncmp, c_default_cmp(x, y))
+#define i_parent
+#include "stc/smap.h"
+
+#define i_TYPE smap_cow, int, int
+#define i_cow
+#define i_ranked
+#include "stc/smap.h"
+
+#define i_TYPE smap_iv, int, int
+#define i_interval
+#include "stc/smap.h"
+
+typedef struct { long long sum; } smap_sum_aug;
+#define i_TYPE smap_sum, int, int
+#define i_aug smap_sum_aug // sum of the mapped values in the subtree
+#define i_augment(out, val, l, r) ((out)->sum = (val)->second + ((l) ? (l)->sum : 0) + ((r) ? (r)->sum : 0))
+#include "stc/smap.h"
+
+#define i_TYPE smap_csum, int, int
+#define i_cow
+#define i_aug smap_sum_aug
+#define i_augment(out, val, l, r) ((out)->sum = (val)->second + ((l) ? (l)->sum : 0) + ((r) ? (r)->sum : 0))
+#include "stc/smap.h"
+
+#define i_key_str
+#include "stc/sset.h"
+
+// Check the AA-tree rules below node tn, and return the number of nodes.
+static intptr_t smap_int_check(const smap_int* m, int32_t tn) {
+    const smap_int_node* d = m->nodes;
+    if (tn == 0) return 0;
+    const int32_t l = d[tn].link[0], r = d[tn].link[1];
+    if (d[l].level != d[tn].level - 1) return -1000000;
+    if (d[r].level != d[tn].level && d[r].level != d[tn].level - 1) return -1000000;
+    if (d[d[r].link[1]].level == d[tn].level) return -1000000;
+    if (d[tn].level > 1 && (l == 0 || r == 0)) return -1000000;
+    return smap_int_check(m, l) + 1 + smap_int_check(m, r);
+}
+
+
+CTEST(smap, from_sorted)
+{
+    c_forrange (n, 0, 300) {
+        smap_int_raw raw[300];
+        c_forrange (i, n) raw[i] = (smap_int_raw){(int)i*2, (int)i};
+        smap_int map = smap_int_from_sorted_n(raw, n);
+        ASSERT_EQ(n, smap_int_size(&map));
+        ASSERT_EQ(n, smap_int_check(&map, map.root));
+        int k = 0;
+        c_foreach (i, smap_int, map)
+            ASSERT_EQ(k*2, i.ref->first), ++k;
+        ASSERT_EQ(n, k);
+
+        c_forrange (i, n) // normal inserts and erases afterwards
+            ASSERT_TRUE(smap_int_insert(&map, (int)i*2 + 1, 0).inserted);
+        c_forrange (i, 0, n, 3)
+            ASSERT_EQ(1, smap_int_erase(&map, (int)i));
+        ASSERT_EQ(2*n - (n + 2)/3, smap_int_size(&map));
+        ASSERT_EQ(smap_int_size(&map), smap_int_check(&map, map.root));
+        smap_int_drop(&map);
+    }
+
+    const char* words[] = {"apple", "banana", "banana", "cherry", "date", "date", "date", "fig"};
+    sset_str set = sset_str_from_sorted_n(words, c_arraylen(words));
+    ASSERT_EQ(5, sset_str_size(&set));
+    ASSERT_TRUE(sset_str_contains(&set, "date"));
+    ASSERT_STREQ("fig", cstr_str(sset_str_back(&set)));
+    sset_str_drop(&set);
+}
+
+CTEST(smap, ranked)
+{
+    smap_rk map = {0};
+    crand_t rng = crand_init(17);
+    c_forrange (i, 30000) {
+        int key = (int)(crand_u64(&rng) % 4000);
+        if (crand_u64(&rng) % 3) smap_rk_insert(&map, key, (int)i);
+        else smap_rk_erase(&map, key);
+    }
+    intptr_t k = 0;
+    c_foreach (i, smap_rk, map) {
+        ASSERT_EQ(k, smap_rk_rank(&map, i.ref->first));
+        ASSERT_EQ(i.ref->first, smap_rk_select(&map, k).ref->first);
+        ++k;
+    }
+    ASSERT_EQ(smap_rk_size(&map), k);
+    ASSERT_EQ(k, map.nodes[map.root].count);
+    ASSERT_TRUE(smap_rk_select(&map, k).ref == NULL);
+    ASSERT_TRUE(smap_rk_select(&map, -1).ref == NULL);
+
+    smap_rk_iter it = smap_rk_select(&map, 100); // continues in order
+    smap_rk_next(&it);
+    ASSERT_EQ(smap_rk_select(&map, 101).ref->first, it.ref->first);
+
+    intptr_t n = 0;
+    c_foreach (i, smap_rk, map)
+        n += (i.ref->first >= 1000 && i.ref->first < 2500);
+    ASSERT_EQ(n, smap_rk_count_range(&map, 1000, 2500));
+    ASSERT_EQ(0, smap_rk_count_range(&map, 2500, 1000));
+
+    smap_rk_iter a = smap_rk_lower_bound(&map, 1000), b = smap_rk_lower_bound(&map, 2500);
+    smap_rk_erase_range(&map, a, b);
+    ASSERT_EQ(0, smap_rk_count_range(&map, 1000, 2500));
+    ASSERT_EQ(k - n, smap_rk_size(&map));
+    ASSERT_EQ(k - n, map.nodes[map.root].count);
+
+    smap_rk_raw raw[1000];
+    c_forrange (i, 1000) raw[i] = (smap_rk_raw){(int)i, (int)i};
+    smap_rk clone = smap_rk_clone(map), sorted = smap_rk_from_sorted_n(raw, 1000);
+    ASSERT_EQ(k - n, clone.nodes[clone.root].count);
+    ASSERT_EQ(500, smap_rk_select(&sorted, 500).ref->first);
+    ASSERT_EQ(999, smap_rk_rank(&sorted, 999));
+    smap_rk_drop(&sorted);
+    smap_rk_drop(&clone);
+    smap_rk_drop(&map);
+}
+
+// Check the parent links and counts below node tn, and return the number of nodes.
+static intptr_t smap_par_check(const smap_par* m, int32_t tn) {
+    const smap_par_node* d = m->nodes;
+    if (tn == 0) return 0;
+    const int32_t l = d[tn].link[0], r = d[tn].link[1];
+    if ((l && d[l].parent != tn) || (r && d[r].parent != tn)) return -1000000;
+    if (d[tn].count != d[l].count + d[r].count + 1) return -1000000;
+    return smap_par_check(m, l) + 1 + smap_par_check(m, r);
+}
+
+CTEST(smap, parent)
+{
+    smap_par map = {0};
+    smap_int ref = {0};
+    crand_t rng = crand_init(19);
+    ASSERT_TRUE(sizeof(smap_par_iter) < sizeof(smap_int_iter)/4);
+
+    c_forrange (i, 40000) {
+        int key = (int)(crand_u64(&rng) % 3000);
+        if (crand_u64(&rng) % 3)
+            smap_int_insert(&ref, key, (int)i), smap_par_insert(&map, key, (int)i);
+        else
+            ASSERT_EQ(smap_int_erase(&ref, key), smap_par_erase(&map, key));
+    }
+    ASSERT_EQ(smap_par_size(&map), smap_par_check(&map, map.root));
+    ASSERT_EQ(0, map.nodes[map.root].parent);
+
+    smap_par_iter j = smap_par_begin(&map);
+    c_foreach (i, smap_int, ref)
+        ASSERT_EQ(i.ref->first, j.ref->first), smap_par_next(&j);
+    ASSERT_TRUE(j.ref == NULL);
+
+    intptr_t n = smap_par_size(&map);
+    c_foreach_reverse (i, smap_par, map) {
+        ASSERT_EQ(--n, smap_par_rank(&map, i.ref->first));
+        smap_par_iter k = i;
+        smap_par_next(&k);
+        if (k.ref) smap_par_prev(&k), ASSERT_EQ(i.ref->first, k.ref->first);
+    }
+    ASSERT_EQ(0, n);
+
+    smap_par_iter lb = smap_par_lower_bound(&map, 1500);
+    smap_int_iter lr = smap_int_lower_bound(&ref, 1500);
+    ASSERT_EQ(lr.ref->first, lb.ref->first);
+    smap_par_erase_range(&map, lb, smap_par_lower_bound(&map, 2000));
+    c_erase_if(smap_int, &ref, value->first >= 1500 && value->first < 2000);
+    ASSERT_EQ(smap_int_size(&ref), smap_par_check(&map, map.root));
+    ASSERT_EQ(smap_int_back(&ref)->first, smap_par_rbegin(&map).ref->first);
+
+    smap_par clone = smap_par_clone(map);
+    ASSERT_EQ(smap_par_size(&map), smap_par_check(&clone, clone.root));
+    smap_par_drop(&clone);
+    smap_par_drop(&map);
+    smap_int_drop(&ref);
+}
+
+CTEST(smap, set_operations)
+{
+    sset_str a = {0}, b = {0};
+    char buf[16];
+    c_forrange (i, 3000) {
+        snprintf(buf, sizeof buf, "%05d", (int)i);
+        if (i % 2) sset_str_emplace(&a, buf);
+        if (i % 3) sset_str_emplace(&b, buf);
+    }
+    sset_str u = sset_str_union(&a, &b);
+    sset_str n = sset_str_intersection(&a, &b);
+    sset_str d = sset_str_difference(&a, &b);
+    ASSERT_EQ(3000 - 500, sset_str_size(&u));  // i not divisible by 6
+    ASSERT_EQ(1000, sset_str_size(&n));        // i % 6 in {1, 5}
+    ASSERT_EQ(500, sset_str_size(&d));         // i % 6 == 3
+    c_foreach (i, sset_str, u) {
+        const int k = atoi(cstr_str(i.ref));
+        ASSERT_TRUE(k % 6 != 0);
+        ASSERT_EQ(k % 6 == 1 || k % 6 == 5, sset_str_contains(&n, cstr_str(i.ref)));
+        ASSERT_EQ(k % 6 == 3, sset_str_contains(&d, cstr_str(i.ref)));
+    }
+    sset_str_emplace(&n, "x"); // the results are normal sets
+    ASSERT_STREQ("x", cstr_str(sset_str_back(&n)));
+
+    smap_int m1 = {0}, m2 = {0}, small = {0};
+    c_forrange (i, 2000) smap_int_insert(&m1, (int)i*2, 1);
+    c_forrange (i, 1500) smap_int_insert(&m2, (int)i*3, 2);
+    c_forrange (i, 10) smap_int_insert(&small, (int)i*1001, 3);
+    smap_int_merge_into(&m1, &m2);   // O(n + m) rebuild
+    ASSERT_EQ(2000 + 1500 - 667, smap_int_size(&m1));
+    ASSERT_EQ(smap_int_size(&m1), smap_int_check(&m1, m1.root));
+    ASSERT_EQ(1, *smap_int_at(&m1, 6));  // already in self: kept
+    ASSERT_EQ(2, *smap_int_at(&m1, 9));
+    smap_int_merge_into(&m1, &small); // inserts
+    ASSERT_EQ(2000 + 1500 - 667 + 7, smap_int_size(&m1)); // 0, 2002, 3003 were in m1
+    ASSERT_EQ(3, *smap_int_at(&m1, 1001));
+    ASSERT_EQ(smap_int_size(&m1), smap_int_check(&m1, m1.root));
+
+    c_drop(sset_str, &a, &b, &u, &n, &d);
+    c_drop(smap_int, &m1, &m2, &small);
+}
+
+CTEST(smap, compact)
+{
+    smap_par map = {0};
+    c_forrange (i, 10000) smap_par_insert(&map, (int)((i*7919) % 10000), (int)i);
+    c_forrange (i, 0, 10000, 10) c_forrange (j, 1, 10) smap_par_erase(&map, (int)(i + j));
+    ASSERT_EQ(1000, smap_par_size(&map));
+    ASSERT_TRUE(smap_par_capacity(&map) >= 10000);
+
+    smap_par_compact(&map);
+    ASSERT_EQ(1000, smap_par_capacity(&map));
+    ASSERT_EQ(1000, smap_par_check(&map, map.root));
+    int k = 0;
+    c_foreach (i, smap_par, map) { // nodes are numbered in key order
+        ASSERT_TRUE(i.ref == &map.nodes[k + 1].value);
+        ASSERT_EQ(k*10, i.ref->first);
+        ++k;
+    }
+    ASSERT_EQ(500, smap_par_select(&map, 50).ref->first);
+    smap_par_insert(&map, 5, 0);
+    ASSERT_EQ(1001, smap_par_check(&map, map.root));
+
+    smap_par_clear(&map);
+    smap_par_insert(&map, 1, 1);
+    smap_par_erase(&map, 1);
+    smap_par_shrink_to_fit(&map);
+    ASSERT_EQ(0, smap_par_capacity(&map));
+    ASSERT_TRUE(smap_par_begin(&map).ref == NULL);
+    smap_par_drop(&map);
+}
+
+CTEST(smap, snapshot)
+{
+    smap_cow map = {0}, snap[4] = {0};
+    smap_int ref = {0}, sref[4] = {0};
+    crand_t rng = crand_init(22);
+
+    c_forrange (i, 60000) {
+        int key = (int)(crand_u64(&rng) % 3000), op = (int)(crand_u64(&rng) % 1000);
+        if (op < 600)
+            smap_cow_insert_or_assign(&map, key, (int)i), smap_int_insert_or_assign(&ref, key, (int)i);
+        else if (op < 995)
+            ASSERT_EQ(smap_int_erase(&ref, key), smap_cow_erase(&map, key));
+        else { // replace a snapshot, and keep a full copy to compare with
+            int s = (int)(crand_u64(&rng) % 4);
+            smap_cow_drop(&snap[s]); smap_int_drop(&sref[s]);
+            snap[s] = smap_cow_snapshot(&map); sref[s] = smap_int_clone(ref);
+            if (op == 999) smap_cow_compact(&map);
+        }
+    }
+    c_forrange (s, 5) {
+        const smap_cow* m = s < 4 ? &snap[s] : &map;
+        const smap_int* r = s < 4 ? &sref[s] : &ref;
+        ASSERT_EQ(smap_int_size(r), smap_cow_size(m));
+        ASSERT_EQ(smap_cow_size(m), m->nodes[m->root].count);
+        smap_cow_iter j = smap_cow_begin(m);
+        c_foreach (i, smap_int, *r) {
+            ASSERT_EQ(i.ref->first, j.ref->first);
+            ASSERT_EQ(i.ref->second, j.ref->second);
+            smap_cow_next(&j);
+        }
+    }
+    c_drop(smap_cow, &snap[0], &snap[1], &snap[2], &snap[3], &map);
+    c_drop(smap_int, &sref[0], &sref[1], &sref[2], &sref[3], &ref);
+
+    map = smap_cow_init(); // restore a snapshot that shares the node array with its map
+    smap_cow_reserve(&map, 1000);
+    c_forrange (i, 10) smap_cow_insert(&map, (int)i, (int)i);
+    snap[0] = smap_cow_snapshot(&map);
+    smap_cow_erase(&map, 3); smap_cow_erase(&map, 7);
+    smap_cow_copy(&map, &snap[0]);
+    ASSERT_EQ(10, smap_cow_size(&map));
+    smap_cow_erase(&map, 3); smap_cow_erase(&map, 7);
+    smap_cow_merge_into(&map, &snap[0]);
+    ASSERT_EQ(10, smap_cow_size(&map));
+    ASSERT_TRUE(smap_cow_contains(&map, 3) && smap_cow_contains(&map, 7));
+    ASSERT_EQ(10, smap_cow_size(&snap[0]));
+    c_drop(smap_cow, &snap[0], &map);
+}
+
+CTEST(smap, hint_and_ranges)
+{
+    smap_par map = {0};
+    smap_int ref = {0};
+    crand_t rng = crand_init(23);
+    smap_par_iter hint = smap_par_end(&map);
+    c_forrange (i, 20000) { // mostly increasing keys, with the last position as hint
+        int key = (int)(i/2 + crand_u64(&rng) % 8);
+        if (i % 100 == 0) hint = smap_par_select(&map, (intptr_t)(crand_u64(&rng) % (i + 1)));
+        hint = smap_par_insert_hint(&map, hint, key, (int)i);
+        ASSERT_EQ(key, hint.ref->first);
+        smap_int_insert(&ref, key, (int)i);
+    }
+    ASSERT_EQ(smap_int_size(&ref), smap_par_check(&map, map.root));
+    ASSERT_EQ(smap_int_size(&ref), smap_int_check(&ref, ref.root));
+
+    smap_cnt cnt = {0}; // one compare with the end hint, two with a hint and its neighbour
+    smap_cnt_insert(&cnt, 0, 0);
+    smap_ncmp = 0;
+    c_forrange (i, 1, 1000) smap_cnt_insert_hint(&cnt, smap_cnt_end(&cnt), (int)i*2, 0);
+    ASSERT_EQ(999, smap_ncmp);
+    c_forrange (i, 1, 1000) {
+        smap_cnt_iter hint = smap_cnt_find(&cnt, (int)i*2);
+        smap_ncmp = 0;
+        smap_cnt_insert_hint(&cnt, hint, (int)i*2 - 1, 0);
+        ASSERT_EQ(2, smap_ncmp);
+    }
+    ASSERT_EQ(1999, smap_cnt_size(&cnt));
+    smap_cnt_drop(&cnt);
+
+    smap_par_iter j = smap_par_begin(&map);
+    c_foreach (i, smap_int, ref)
+        ASSERT_EQ(i.ref->second, j.ref->second), smap_par_next(&j);
+
+    smap_int_iter ub = smap_int_upper_bound(&ref, 5000);
+    smap_int_range er = smap_int_equal_range(&ref, 5000);
+    ASSERT_EQ(5001, ub.ref->first);
+    ASSERT_EQ(5000, er.first.ref->first);
+    ASSERT_TRUE(er.second.ref == ub.ref);
+
+    // A short range is erased by single erases, a long range by a rebuild of the tree.
+    intptr_t n = smap_int_erase_key_range(&ref, 2000, 2010);
+    ASSERT_EQ(n, smap_par_erase_key_range(&map, 2000, 2010));
+    n = smap_int_erase_key_range(&ref, 5000, 10000);
+    ASSERT_TRUE(n > 4000);
+    ASSERT_EQ(n, smap_par_erase_key_range(&map, 5000, 10000));
+    ASSERT_EQ(0, smap_int_erase_key_range(&ref, 5000, 10000));
+    ASSERT_EQ(smap_int_size(&ref), smap_par_check(&map, map.root));
+    ASSERT_EQ(smap_int_size(&ref), smap_int_check(&ref, ref.root));
+    ASSERT_EQ(smap_int_back(&ref)->first, smap_par_rbegin(&map).ref->first);
+
+    smap_int_iter a = smap_int_lower_bound(&ref, 100), b = smap_int_lower_bound(&ref, 4000);
+    const int bkey = b.ref->first;
+    n = smap_int_size(&ref);
+    c_foreach (i, smap_int, a, b) --n;
+    ASSERT_EQ(bkey, smap_int_erase_range(&ref, a, b).ref->first);
+    ASSERT_EQ(n, smap_int_size(&ref));
+    ASSERT_EQ(n, smap_int_check(&ref, ref.root));
+    smap_par_drop(&map);
+    smap_int_drop(&ref);
+}
+
+// Check the max hi of the subtrees below node tn, and return the number of nodes.
+static intptr_t smap_iv_check(const smap_iv* m, int32_t tn) {
+    const smap_iv_node* d = m->nodes;
+    if (tn == 0) return 0;
+    const int32_t l = d[tn].link[0], r = d[tn].link[1];
+    int hi = d[tn].value.first.hi;
+    if (l && d[l].aug > hi) hi = d[l].aug;
+    if (r && d[r].aug > hi) hi = d[r].aug;
+    if (d[tn].aug != hi) return -1000000;
+    return smap_iv_check(m, l) + 1 + smap_iv_check(m, r);
+}
+
+CTEST(smap, augment)
+{
+    smap_iv map = {0};
+    crand_t rng = crand_init(24);
+    c_forrange (i, 30000) {
+        const int lo = (int)(crand_u64(&rng) % 10000);
+        const smap_iv_key key = {lo, lo + (int)(crand_u64(&rng) % 200)};
+        if (crand_u64(&rng) % 3)
+            smap_iv_insert(&map, key, (int)i);
+        else {
+            smap_iv_iter it = smap_iv_lower_bound(&map, key);
+            if (it.ref) smap_iv_erase(&map, it.ref->first);
+        }
+    }
+    ASSERT_EQ(smap_iv_size(&map), smap_iv_check(&map, map.root));
+
+    c_forrange (q, 200) { // the same intervals in the same order as a full scan
+        const int lo = (int)q*50 - 100, hi = lo + (int)(crand_u64(&rng) % 300);
+        smap_iv_iter j = smap_iv_find_overlapping(&map, lo, hi);
+        c_foreach (i, smap_iv, map) {
+            if (i.ref->first.lo <= hi && lo <= i.ref->first.hi) {
+                ASSERT_TRUE(j.ref == i.ref);
+                smap_iv_next_overlapping(&j, lo, hi);
+            }
+        }
+        ASSERT_TRUE(j.ref == NULL);
+    }
+    smap_iv_erase_key_range(&map, c_LITERAL(smap_iv_key){2000, 0}, c_LITERAL(smap_iv_key){8000, 0});
+    ASSERT_EQ(smap_iv_size(&map), smap_iv_check(&map, map.root));
+    ASSERT_TRUE(smap_iv_find_overlapping(&map, 2300, 7800).ref == NULL);
+    smap_iv_drop(&map);
+
+    smap_sum sums = {0};
+    long long total = 0;
+    c_forrange (i, 1000) smap_sum_insert_or_assign(&sums, (int)(i*7 % 1000), (int)i);
+    c_forrange (i, 0, 1000, 3) smap_sum_erase(&sums, (int)i);
+    c_foreach (i, smap_sum, sums) total += i.ref->second;
+    ASSERT_EQ(total, sums.nodes[sums.root].aug.sum);
+    *smap_sum_at_mut(&sums, 1) += 1000;
+    smap_sum_reaugment(&sums, 1);
+    ASSERT_EQ(total + 1000, sums.nodes[sums.root].aug.sum);
+    smap_sum_drop(&sums);
+
+    smap_csum csums = {0}, snap = {0}; // the returned refs stay valid when the nodes are copied
+    total = 0;
+    c_forrange (i, 1000) {
+        if (i % 100 == 50) { smap_csum_drop(&snap); snap = smap_csum_snapshot(&csums); }
+        smap_csum_result r = smap_csum_insert_or_assign(&csums, (int)(i*7 % 1000), (int)i);
+        ASSERT_EQ((int)(i*7 % 1000), r.ref->first);
+        ASSERT_TRUE(r.ref == smap_csum_get(&csums, r.ref->first));
+        r = smap_csum_insert(&csums, 1000 + (int)i, 1);
+        ASSERT_TRUE(r.ref == smap_csum_get(&csums, 1000 + (int)i));
+        total += (int)i + 1;
+    }
+    ASSERT_EQ(total, csums.nodes[csums.root].aug.sum);
+    c_drop(smap_csum, &snap, &csums);
+}
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include "stc/crand.h"
+#include "ctest.h"
+
+#define i_TYPE vec_i, int
+#define i_use_cmp
+#include "stc/vec.h"
+
+#define i_TYPE deq_i, int
+#define i_use_cmp
+#include "stc/deq.h"
+
+#define i_TYPE list_i, int
+#define i_use_cmp
+#include "stc/list.h"
+
+typedef struct { int key, id; } sort_pair;
+static int sort_pair_cmp(const sort_pair* a, const sort_pair* b) { return c_default_cmp(&a->key, &b->key); }
+#define i_TYPE vec_p, sort_pair
+#define i_cmp sort_pair_cmp // not the default less: no branchless partition
+#include "stc/vec.h"
+
+static int sort_int_cmp(const void* a, const void* b) { return c_default_cmp((const int*)a, (const int*)b); }
+
+// Inputs that defeat plain quicksorts: sorted, reversed, equal, organ pipe, few values, random.
+static int sort_input(crand_t* rng, int pattern, int i, int n) {
+    switch (pattern) {
+        case 0: return i;
+        case 1: return n - i;
+        case 2: return 7;
+        case 3: return i < n/2 ? i : n - i;
+        case 4: return (int)(crand_u64(rng) % 16);
+        case 5: return i % 64 ? i : (int)(crand_u64(rng) % 100000);
+    }
+    return (int)crand_u64(rng);
+}
+
+CTEST(sort, containers)
+{
+    crand_t rng = crand_init(25);
+    c_forrange (round, 140) {
+        const int n = round < 70 ? (int)round : (int)(crand_u64(&rng) % 30000);
+        const int pattern = (int)round % 7;
+        vec_i v = {0}; deq_i d = {0}; list_i l = {0}; vec_p p = {0};
+        int* ref = (int*)malloc(sizeof(int)*(size_t)(n + 1));
+        c_forrange (i, n) {
+            const int x = sort_input(&rng, pattern, (int)i, n);
+            ref[i] = x;
+            vec_i_push(&v, x);
+            list_i_push_back(&l, x);
+            vec_p_push(&p, c_LITERAL(sort_pair){x, (int)i});
+            if (i % 3) deq_i_push_back(&d, x); else deq_i_push_front(&d, x); // wraps the ring buffer
+        }
+        qsort(ref, (size_t)n, sizeof *ref, sort_int_cmp);
+        vec_i_sort(&v); deq_i_sort(&d); list_i_sort(&l); vec_p_sort(&p);
+
+        int k = 0;
+        c_foreach (i, vec_i, v) ASSERT_EQ(ref[k++], *i.ref);
+        k = 0;
+        c_foreach (i, deq_i, d) ASSERT_EQ(ref[k++], *i.ref);
+        k = 0;
+        c_foreach (i, list_i, l) ASSERT_EQ(ref[k++], *i.ref);
+        k = 0;
+        c_foreach (i, vec_p, p) ASSERT_EQ(ref[k++], i.ref->key);
+        ASSERT_EQ(n, k);
+        free(ref);
+        vec_i_drop(&v); deq_i_drop(&d); list_i_drop(&l); vec_p_drop(&p);
+    }
+}
+
+CTEST(sort, heapsort_fallback)
+{
+    crand_t rng = crand_init(26);
+    vec_i v = {0};
+    c_forrange (i, 5000) vec_i_push(&v, (int)(crand_u64(&rng) % 1000));
+    vec_i_heap_sort_(v.data, vec_i_size(&v)); // used after log2(n) unbalanced partitions
+    c_forrange (i, 1, vec_i_size(&v)) ASSERT_TRUE(v.data[i - 1] <= v.data[i]);
+    vec_i_drop(&v);
+}